@@ -0,0 +1,288 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+// Headless benchmark of the rasterizers in draw_utils.c, rendering into an
+// offscreen buffer. Results are written as CSV to stdout; the checksum column
+// hashes the framebuffer so optimisations can be checked for identical output.
+//
+// Usage: bench_draw [--quick]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <cairo.h>
+
+#include "../profiler.h"
+#include "../draw_utils.h"
+
+#define NUM_RUNS 10
+// each run repeats the measured function for at least this long (ns)
+#define RUN_TIME 20000000
+#define QUICK_RUN_TIME 2000000
+#define DB_RANGE 70
+#define BARS_BANDS 132
+#define MAX_SOLID_BANDS 7680
+#define NUM_GRADIENT_COLORS 6
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+
+enum DRAW_STYLE { STYLE_BARS = 0, STYLE_SOLID = 1, NUM_STYLES };
+
+static const int resolutions[][2] = {{800, 200}, {1920, 300}, {3840, 600}, {7680, 1000}};
+static const char *style_names[] = {"bars", "solid"};
+static const char *orientation_names[] = {"vertical", "horizontal"};
+
+#define NUM_RESOLUTIONS (int)(sizeof (resolutions) / sizeof (resolutions[0]))
+
+// same colors as the default config
+static const draw_color_t gradient_colors[NUM_GRADIENT_COLORS] = {
+    {0.25, 0.86, 0.95}, {0.36, 0.81, 0.54}, {0.68, 0.86, 0.40},
+    {0.98, 0.87, 0.36}, {0.99, 0.61, 0.27}, {1.00, 0.32, 0.27}
+};
+
+typedef struct {
+    double mean;
+    double stddev;
+} result_t;
+
+typedef struct {
+    draw_params_t params;
+    uint32_t colors[GRADIENT_TABLE_SIZE];
+    float bars[MAX_SOLID_BANDS];
+    float peaks[MAX_SOLID_BANDS];
+    uint8_t *data;
+    uint8_t *background;
+    int stride;
+    cairo_surface_t *surf;
+    cairo_t *cr;
+} bench_t;
+
+typedef void (*bench_func_t) (bench_t *b);
+
+static int64_t run_time = RUN_TIME;
+
+static void
+bench_static (bench_t *b)
+{
+    draw_static_content (b->background, b->stride, &b->params);
+}
+
+static void
+bench_bars_frame (bench_t *b)
+{
+    memcpy (b->data, b->background, b->stride * b->params.height);
+    draw_bars (b->data, b->stride, b->bars, b->peaks, &b->params);
+}
+
+static void
+bench_solid_frame (bench_t *b)
+{
+    draw_spectrum_cairo (b->cr, b->bars, &b->params);
+}
+
+// Returns mean and standard deviation of the time per call in ns over NUM_RUNS runs.
+static result_t
+measure (bench_func_t func, bench_t *b)
+{
+    // find an iteration count that fills one run
+    int64_t iterations = 1;
+    for (;;) {
+        const int64_t start = profiler_now ();
+        for (int64_t i = 0; i < iterations; i++) {
+            func (b);
+        }
+        const int64_t elapsed = profiler_now () - start;
+        if (elapsed >= run_time / 4) {
+            iterations = iterations * run_time / elapsed + 1;
+            break;
+        }
+        iterations *= 2;
+    }
+
+    // Welford's online mean and variance
+    double mean = 0;
+    double m2 = 0;
+    for (int run = 1; run <= NUM_RUNS; run++) {
+        const int64_t start = profiler_now ();
+        for (int64_t i = 0; i < iterations; i++) {
+            func (b);
+        }
+        const double ns = (double)(profiler_now () - start) / iterations;
+        const double delta = ns - mean;
+        mean += delta / run;
+        m2 += delta * (ns - mean);
+    }
+    result_t r = {mean, sqrt (m2 / (NUM_RUNS - 1))};
+    return r;
+}
+
+// FNV-1a over the visible pixels, padding at the end of a row is skipped
+static uint64_t
+checksum (const uint8_t *data, int stride, int width, int height)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = data + y * stride;
+        for (int x = 0; x < width * 4; x++) {
+            hash ^= row[x];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+static void
+print_result (bench_t *b, int style, const char *stage, result_t r, uint64_t hash)
+{
+    const draw_params_t *p = &b->params;
+    const double fps = 1e9 / r.mean;
+    printf ("%s,%s,%d,%d,%d,%d,%d,%s,%.0f,%.0f,%.1f,%.1f,%016llx\n",
+            style_names[style], orientation_names[p->gradient_orientation], p->bar_mode, p->gaps,
+            p->width, p->height, p->bands, stage,
+            fps, r.mean, 100 * r.stddev / r.mean, (double)b->stride * p->height * fps / 1e6,
+            (unsigned long long)hash);
+}
+
+static void
+create_gradient (uint32_t *dest)
+{
+    const int segments = NUM_GRADIENT_COLORS - 1;
+    for (int i = 0; i < GRADIENT_TABLE_SIZE; i++) {
+        const double pos = (double)i / (GRADIENT_TABLE_SIZE - 1) * segments;
+        const int seg = pos >= segments ? segments - 1 : (int)pos;
+        const double t = pos - seg;
+        const draw_color_t *c0 = &gradient_colors[seg];
+        const draw_color_t *c1 = &gradient_colors[seg + 1];
+        const int r = (int)((c0->red + t * (c1->red - c0->red)) * 255);
+        const int g = (int)((c0->green + t * (c1->green - c0->green)) * 255);
+        const int bl = (int)((c0->blue + t * (c1->blue - c0->blue)) * 255);
+        // table is indexed from the top of the widget
+        dest[GRADIENT_TABLE_SIZE - 1 - i] = (r << 16) | (g << 8) | bl;
+    }
+}
+
+// deterministic frame with bars over the whole range and peaks above them
+static void
+fill_frame (bench_t *b)
+{
+    for (int i = 0; i < MAX_SOLID_BANDS; i++) {
+        b->bars[i] = (i * 37) % DB_RANGE;
+        b->peaks[i] = b->bars[i] + (i * 13) % 10;
+    }
+}
+
+static void
+init_params (draw_params_t *p, const uint32_t *colors)
+{
+    memset (p, 0, sizeof (draw_params_t));
+    p->db_range = DB_RANGE;
+    // center alignment
+    p->alignment = 2;
+    p->fill_spectrum = 1;
+    p->enable_hgrid = 1;
+    p->enable_vgrid = 1;
+    p->enable_octave_grid = 1;
+    p->octaves = 11;
+    p->colors = colors;
+    p->color_bg32 = 0x222222;
+    p->color_vgrid32 = 0x000000;
+    p->color_hgrid32 = 0x666666;
+    p->color_octave_grid32 = 0x444444;
+    p->gradient_colors = gradient_colors;
+    p->num_colors = NUM_GRADIENT_COLORS;
+    p->color_bg = (draw_color_t){0x22/255.0, 0x22/255.0, 0x22/255.0};
+    p->color_hgrid = (draw_color_t){0x66/255.0, 0x66/255.0, 0x66/255.0};
+    p->color_octave_grid = (draw_color_t){0x44/255.0, 0x44/255.0, 0x44/255.0};
+}
+
+static void
+bench_resolution (bench_t *b, int width, int height)
+{
+    b->surf = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+    b->cr = cairo_create (b->surf);
+    b->stride = cairo_image_surface_get_stride (b->surf);
+    b->data = cairo_image_surface_get_data (b->surf);
+    b->background = malloc (b->stride * height);
+    b->params.width = width;
+    b->params.height = height;
+
+    for (int style = 0; style < NUM_STYLES; style++) {
+        b->params.bands = style == STYLE_BARS ? BARS_BANDS : MIN (width, MAX_SOLID_BANDS);
+        // the solid style ignores bar mode and gaps
+        const int variants = style == STYLE_BARS ? 2 : 1;
+        for (int orientation = 0; orientation < 2; orientation++) {
+            for (int bar_mode = 0; bar_mode < variants; bar_mode++) {
+                for (int gaps = 0; gaps < variants; gaps++) {
+                    b->params.gradient_orientation = orientation;
+                    b->params.bar_mode = bar_mode;
+                    b->params.gaps = gaps;
+
+                    if (style == STYLE_BARS) {
+                        result_t r = measure (bench_static, b);
+                        print_result (b, style, "static", r, checksum (b->background, b->stride, width, height));
+
+                        r = measure (bench_bars_frame, b);
+                        bench_bars_frame (b);
+                        print_result (b, style, "frame", r, checksum (b->data, b->stride, width, height));
+                    }
+                    else {
+                        result_t r = measure (bench_solid_frame, b);
+                        bench_solid_frame (b);
+                        cairo_surface_flush (b->surf);
+                        print_result (b, style, "frame", r, checksum (b->data, b->stride, width, height));
+                    }
+                }
+            }
+        }
+    }
+
+    free (b->background);
+    cairo_destroy (b->cr);
+    cairo_surface_destroy (b->surf);
+}
+
+int
+main (int argc, char *argv[])
+{
+    if (argc > 1 && strcmp (argv[1], "--quick") == 0) {
+        run_time = QUICK_RUN_TIME;
+    }
+
+    bench_t *b = calloc (1, sizeof (bench_t));
+    create_gradient (b->colors);
+    init_params (&b->params, b->colors);
+    fill_frame (b);
+
+    printf ("style,orientation,bar_mode,gaps,width,height,bands,stage,frames_per_s,ns_per_frame,stddev_pct,mb_per_s,checksum\n");
+    for (int i = 0; i < NUM_RESOLUTIONS; i++) {
+        bench_resolution (b, resolutions[i][0], resolutions[i][1]);
+    }
+
+    free (b);
+    return 0;
+}
@@ -0,0 +1,465 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+// Headless benchmark of the analysis pipeline: window + FFT, band mapping and
+// bar animation, using the same code as the plugin. "fft 2ch" is the batched
+// transform of two channels, compare it to twice "fft". "goertzel" computes the
+// bins column of narrow display ranges without the transform, dsp_fft_range picks
+// it over "fft" by the cost model in dsp/pruned.c. "zoom" filters and decimates one
+// block for the zoom transform of 80-120 Hz, the bars column is the decimation. "sdft"
+// updates the sliding DFT of all bands with one block and "sdft read" reads them out,
+// the bars column is the band count, windows are up to 8192 samples. "filters" runs the 1/1 to 1/12 octave filter bank
+// over one block, the bars column is the band count. "reassign" is "fft" with the
+// second transform and the instantaneous frequencies of frequency reassignment. "multires" runs the 32768, 8192
+// and 2048 point transforms of one multi-resolution frame in turn, "multires p" runs
+// them on the worker pool, which needs a build with FFTW_THREADS=1 and several cores.
+// "tapers" computes the multitaper estimate of an 8192 point block, the bars column is
+// the taper count. "exp avg" and "welch" average one spectrum into the time average,
+// the bars column is the number of frames the Welch average holds.
+// The downmix stages convert one block of interleaved audio as the tap does.
+//
+// Usage: bench_dsp [--quick]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fftw3.h>
+
+#include "../profiler.h"
+#include "../dsp/dsp.h"
+
+#define SAMPLERATE 44100
+#define NUM_RUNS 10
+// each run repeats the measured function for at least this long (ns)
+#define RUN_TIME 20000000
+#define QUICK_RUN_TIME 2000000
+
+static const int fft_sizes[] = {512, 1024, 2048, 4096, 8192, 16384, 32768, 65536, 131072, 262144};
+static const int bar_counts[] = {132, 264, 528, 1000, 2000, 4000, 8000};
+
+#define NUM_FFT_SIZES (int)(sizeof (fft_sizes) / sizeof (fft_sizes[0]))
+#define NUM_BAR_COUNTS (int)(sizeof (bar_counts) / sizeof (bar_counts[0]))
+#define MAX_BENCH_FFT_SIZE 262144
+#define MAX_BENCH_BARS 8000
+// frames per audio callback and channel counts of the downmix stages
+#define BLOCK_FRAMES 512
+static const int channel_counts[] = {1, 2, 6, 8};
+static const char *downmix_names[] = {"mid", "side", "left", "right", "max-abs", "rms"};
+#define NUM_CHANNEL_COUNTS (int)(sizeof (channel_counts) / sizeof (channel_counts[0]))
+#define NUM_DOWNMIX_MODES (int)(sizeof (downmix_names) / sizeof (downmix_names[0]))
+// bins of the goertzel stage
+#define GOERTZEL_FIRST_BIN 100
+#define GOERTZEL_BINS 8
+#define MULTIRES_FFT_SIZE 32768
+#define MULTIRES_LEVELS 3
+#define TAPERS_FFT_SIZE 8192
+
+typedef struct {
+    double mean;
+    double stddev;
+} result_t;
+
+// One transform of the multires stages.
+typedef struct {
+    int fft_size;
+    double *window;
+    double *fft_in;
+    fftw_complex *fft_out;
+    fftw_plan plan;
+    double *spectrum;
+} level_t;
+
+typedef struct {
+    int fft_size;
+    int bars;
+    double *samples;
+    double *window;
+    double *fft_in;
+    fftw_complex *fft_out;
+    fftw_plan plan;
+    // plan_2ch: batched plan of two channels, buffers hold two channels
+    fftw_plan plan_2ch;
+    double *spectrum;
+    // deriv_*, bin_freq: of the reassign stage
+    double *deriv_window;
+    double *deriv_in;
+    fftw_complex *deriv_out;
+    fftw_plan deriv_plan;
+    float *bin_freq;
+    float freq[MAX_BENCH_BARS + 1];
+    int keys[MAX_BENCH_BARS + 1];
+    int low_res_end;
+    float values[2][MAX_BENCH_BARS + 1];
+    float bars_data[MAX_BENCH_BARS + 1];
+    float peaks[MAX_BENCH_BARS + 1];
+    int delay_bars[MAX_BENCH_BARS + 1];
+    int delay_peaks[MAX_BENCH_BARS + 1];
+    dsp_animation_t anim;
+    int frame;
+    // frames: BLOCK_FRAMES interleaved frames of up to DSP_MAX_CHANNELS channels
+    float frames[BLOCK_FRAMES * DSP_MAX_CHANNELS];
+    int channels;
+    int downmix;
+    dsp_zoom_t *zoom;
+    dsp_sliding_t *sliding;
+    dsp_filter_bank_t *filter_bank;
+    level_t levels[MULTIRES_LEVELS];
+    const dsp_tapers_t *tapers;
+    double *taper_in;
+    fftw_complex *taper_out;
+    dsp_average_t *average;
+} bench_t;
+
+typedef void (*bench_func_t) (bench_t *b);
+
+static int64_t run_time = RUN_TIME;
+
+static void
+bench_fft (bench_t *b)
+{
+    dsp_fft (b->samples, b->window, b->fft_in, b->fft_out, b->plan, b->spectrum, b->fft_size);
+}
+
+static void
+bench_fft_2ch (bench_t *b)
+{
+    dsp_fft_many (b->samples, 0, b->window, b->fft_in, b->fft_out, b->plan_2ch, b->spectrum, b->fft_size, 2);
+}
+
+static void
+bench_reassign (bench_t *b)
+{
+    dsp_fft_reassign (b->samples, 0, b->window, b->deriv_window, b->fft_in, b->fft_out, b->plan, b->deriv_in, b->deriv_out, b->deriv_plan,
+            b->spectrum, b->bin_freq, b->fft_size, 1, SAMPLERATE, 0, b->fft_size/2 - 1);
+}
+
+static void
+bench_goertzel (bench_t *b)
+{
+    dsp_goertzel (b->fft_in, b->fft_size, GOERTZEL_FIRST_BIN, GOERTZEL_FIRST_BIN + GOERTZEL_BINS - 1, b->spectrum);
+}
+
+static void
+bench_zoom (bench_t *b)
+{
+    dsp_zoom_feed (b->zoom, 0, b->samples, BLOCK_FRAMES);
+}
+
+static void
+bench_sliding (bench_t *b)
+{
+    dsp_sliding_feed (b->sliding, 0, b->samples, BLOCK_FRAMES);
+}
+
+static void
+bench_sliding_read (bench_t *b)
+{
+    dsp_sliding_update (b->sliding);
+}
+
+static void
+bench_filter_bank (bench_t *b)
+{
+    dsp_filter_bank_feed (b->filter_bank, 0, b->samples, BLOCK_FRAMES);
+}
+
+static void
+bench_level (void *arg, int index)
+{
+    bench_t *b = arg;
+    level_t *l = &b->levels[index];
+    dsp_fft (b->samples, l->window, l->fft_in, l->fft_out, l->plan, l->spectrum, l->fft_size);
+}
+
+static void
+bench_multires (bench_t *b)
+{
+    dsp_pool_run (bench_level, b, MULTIRES_LEVELS);
+}
+
+static void
+bench_tapers (bench_t *b)
+{
+    const int n = TAPERS_FFT_SIZE;
+    // even like the stride of the context, so every transform is aligned for the plan
+    const int stride = (n/2 + 2) & ~1;
+    for (int k = 0; k < b->tapers->count; k++) {
+        dsp_apply_window (b->samples, 0, b->tapers->table + k * n, b->taper_in + k * n, n, 1);
+        fftw_execute_dft_r2c (b->plan, b->taper_in + k * n, b->taper_out + k * stride);
+    }
+    dsp_taper_average (b->taper_out, stride, b->tapers->count, b->spectrum, n, 1, 0, n/2 - 1);
+}
+
+static void
+bench_average (bench_t *b)
+{
+    dsp_average_update (b->average, b->spectrum, 0.1f);
+}
+
+static void
+bench_downmix (bench_t *b)
+{
+    dsp_downmix (b->frames, BLOCK_FRAMES, b->channels, b->downmix, b->samples);
+}
+
+static void
+bench_bands (bench_t *b)
+{
+    dsp_map_bands (b->spectrum, b->keys, b->low_res_end, b->bars, 7, 70, b->values[0]);
+}
+
+static void
+bench_animation (bench_t *b)
+{
+    // alternate between two frames so bars keep rising and falling
+    dsp_animate (b->values[b->frame & 1], b->bars_data, b->peaks, b->delay_bars, b->delay_peaks, b->bars, &b->anim);
+    b->frame++;
+}
+
+// Returns mean and standard deviation of the time per call in ns over NUM_RUNS runs.
+static result_t
+measure (bench_func_t func, bench_t *b)
+{
+    // find an iteration count that fills one run
+    int64_t iterations = 1;
+    for (;;) {
+        const int64_t start = profiler_now ();
+        for (int64_t i = 0; i < iterations; i++) {
+            func (b);
+        }
+        const int64_t elapsed = profiler_now () - start;
+        if (elapsed >= run_time / 4) {
+            iterations = iterations * run_time / elapsed + 1;
+            break;
+        }
+        iterations *= 2;
+    }
+
+    // Welford's online mean and variance
+    double mean = 0;
+    double m2 = 0;
+    for (int run = 1; run <= NUM_RUNS; run++) {
+        const int64_t start = profiler_now ();
+        for (int64_t i = 0; i < iterations; i++) {
+            func (b);
+        }
+        const double ns = (double)(profiler_now () - start) / iterations;
+        const double delta = ns - mean;
+        mean += delta / run;
+        m2 += delta * (ns - mean);
+    }
+    result_t r = {mean, sqrt (m2 / (NUM_RUNS - 1))};
+    return r;
+}
+
+static void
+print_result (const char *stage, int fft_size, int bars, result_t r, double items, const char *unit)
+{
+    const double fps = 1e9 / r.mean;
+    printf ("%-10s %8d %6d %12.0f %9.1f%% %12.0f %10.2f %s\n",
+            stage, fft_size, bars, r.mean, 100 * r.stddev / r.mean, fps, items * fps / 1e6, unit);
+}
+
+static void
+fill_signal (double *samples, int n)
+{
+    uint32_t seed = 12345;
+    for (int i = 0; i < n; i++) {
+        const double t = (double)i / SAMPLERATE;
+        seed = seed * 1664525 + 1013904223;
+        const double noise = (seed >> 8) / (double)(1 << 24) - 0.5;
+        samples[i] = 0.5 * sin (2 * M_PI * 55 * t) + 0.25 * sin (2 * M_PI * 440 * t) + 0.1 * sin (2 * M_PI * 3520 * t) + 0.01 * noise;
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+    if (argc > 1 && strcmp (argv[1], "--quick") == 0) {
+        run_time = QUICK_RUN_TIME;
+    }
+
+    bench_t *b = calloc (1, sizeof (bench_t));
+    b->samples = fftw_malloc (sizeof (double) * MAX_BENCH_FFT_SIZE * 2);
+    b->window = fftw_malloc (sizeof (double) * MAX_BENCH_FFT_SIZE);
+    b->fft_in = fftw_malloc (sizeof (double) * MAX_BENCH_FFT_SIZE * 2);
+    b->fft_out = fftw_malloc (sizeof (fftw_complex) * (MAX_BENCH_FFT_SIZE + 2));
+    b->spectrum = fftw_malloc (sizeof (double) * (MAX_BENCH_FFT_SIZE + 2));
+    b->deriv_window = fftw_malloc (sizeof (double) * MAX_BENCH_FFT_SIZE);
+    b->deriv_in = fftw_malloc (sizeof (double) * MAX_BENCH_FFT_SIZE);
+    b->deriv_out = fftw_malloc (sizeof (fftw_complex) * (MAX_BENCH_FFT_SIZE/2 + 1));
+    b->bin_freq = fftw_malloc (sizeof (float) * (MAX_BENCH_FFT_SIZE/2 + 1));
+    fill_signal (b->samples, MAX_BENCH_FFT_SIZE * 2);
+
+    printf ("%-10s %8s %6s %12s %10s %12s %10s\n", "stage", "fft_size", "bars", "ns/frame", "stddev", "frames/s", "throughput");
+
+    for (int i = 0; i < NUM_FFT_SIZES; i++) {
+        b->fft_size = fft_sizes[i];
+        b->plan = dsp_fft_plan (b->fft_size, b->fft_in, b->fft_out);
+        b->plan_2ch = dsp_fft_plan_many (b->fft_size, 2, b->fft_in, b->fft_out);
+        b->deriv_plan = dsp_fft_plan (b->fft_size, b->deriv_in, b->deriv_out);
+        dsp_window_table (b->window, b->fft_size, DSP_WINDOW_BLACKMAN_HARRIS, 0);
+        dsp_window_derivative (b->window, b->deriv_window, b->fft_size);
+
+        print_result ("fft", b->fft_size, 0, measure (bench_fft, b), b->fft_size, "Msamples/s");
+        print_result ("fft 2ch", b->fft_size, 0, measure (bench_fft_2ch, b), 2 * b->fft_size, "Msamples/s");
+        print_result ("reassign", b->fft_size, 0, measure (bench_reassign, b), b->fft_size, "Msamples/s");
+        print_result ("goertzel", b->fft_size, GOERTZEL_BINS, measure (bench_goertzel, b), b->fft_size, "Msamples/s");
+
+        for (int j = 0; j < NUM_BAR_COUNTS; j++) {
+            b->bars = bar_counts[j];
+            b->low_res_end = dsp_frequency_table (b->freq, b->keys, b->bars, b->fft_size, SAMPLERATE);
+            print_result ("bands", b->fft_size, b->bars, measure (bench_bands, b), b->bars, "Mbands/s");
+        }
+        fftw_destroy_plan (b->plan);
+        fftw_destroy_plan (b->plan_2ch);
+        fftw_destroy_plan (b->deriv_plan);
+    }
+
+    // animation only depends on the bar count, feed it two different frames
+    b->anim.bar_falloff = 0.5;
+    b->anim.peak_falloff = 2.25;
+    b->anim.bar_delay = 0;
+    b->anim.peak_delay = 20;
+    b->anim.db_range = 70;
+    for (int i = 0; i <= MAX_BENCH_BARS; i++) {
+        b->values[0][i] = (i * 37) % 70;
+        b->values[1][i] = (i * 53) % 70;
+    }
+    for (int j = 0; j < NUM_BAR_COUNTS; j++) {
+        b->bars = bar_counts[j];
+        print_result ("animation", 0, b->bars, measure (bench_animation, b), b->bars, "Mbands/s");
+    }
+
+    // downmix rows show the channel count in the bars column
+    for (int i = 0; i < BLOCK_FRAMES * DSP_MAX_CHANNELS; i++) {
+        b->frames[i] = b->samples[i];
+    }
+    for (int i = 0; i < NUM_CHANNEL_COUNTS; i++) {
+        b->channels = channel_counts[i];
+        for (int j = 0; j < NUM_DOWNMIX_MODES; j++) {
+            b->downmix = j;
+            print_result (downmix_names[j], BLOCK_FRAMES, b->channels, measure (bench_downmix, b), BLOCK_FRAMES, "Mframes/s");
+        }
+    }
+
+    b->zoom = dsp_zoom_new (SAMPLERATE, 80, 120, 2048, 1);
+    if (b->zoom) {
+        print_result ("zoom", BLOCK_FRAMES, dsp_zoom_decimation (SAMPLERATE, 80, 120, 2048), measure (bench_zoom, b), BLOCK_FRAMES, "Mframes/s");
+        dsp_zoom_free (b->zoom);
+    }
+
+    // the bands per octave of the plugin and two coarser grids
+    static const int sliding_fractions[] = {6, 12, DSP_MAX_BANDS_PER_OCTAVE};
+    for (int i = 0; i < 3; i++) {
+        b->sliding = dsp_sliding_new (SAMPLERATE, DSP_DEFAULT_MIN_FREQ, DSP_DEFAULT_MAX_FREQ, sliding_fractions[i], 8192, 1);
+        if (b->sliding) {
+            const int bands = dsp_sliding_bands (b->sliding);
+            print_result ("sdft", BLOCK_FRAMES, bands, measure (bench_sliding, b), BLOCK_FRAMES, "Mframes/s");
+            print_result ("sdft read", 0, bands, measure (bench_sliding_read, b), bands, "Mbands/s");
+            dsp_sliding_free (b->sliding);
+        }
+    }
+
+    static const int octave_fractions[] = {1, 3, 6, 12};
+    for (int i = 0; i < 4; i++) {
+        b->filter_bank = dsp_filter_bank_new (SAMPLERATE, DSP_DEFAULT_MIN_FREQ, DSP_DEFAULT_MAX_FREQ, octave_fractions[i], 1);
+        if (b->filter_bank) {
+            print_result ("filters", BLOCK_FRAMES, dsp_filter_bank_bands (b->filter_bank), measure (bench_filter_bank, b), BLOCK_FRAMES, "Mframes/s");
+            dsp_filter_bank_free (b->filter_bank);
+        }
+    }
+
+    for (int i = 0; i < MULTIRES_LEVELS; i++) {
+        level_t *l = &b->levels[i];
+        l->fft_size = MULTIRES_FFT_SIZE >> (2 * i);
+        l->window = fftw_malloc (sizeof (double) * l->fft_size);
+        l->fft_in = fftw_malloc (sizeof (double) * l->fft_size);
+        l->fft_out = fftw_malloc (sizeof (fftw_complex) * (l->fft_size/2 + 1));
+        l->spectrum = fftw_malloc (sizeof (double) * (l->fft_size/2 + 1));
+        l->plan = dsp_fft_plan (l->fft_size, l->fft_in, l->fft_out);
+        dsp_window_table (l->window, l->fft_size, DSP_WINDOW_BLACKMAN_HARRIS, 0);
+    }
+    print_result ("multires", MULTIRES_FFT_SIZE, MULTIRES_LEVELS, measure (bench_multires, b), MULTIRES_FFT_SIZE, "Msamples/s");
+    dsp_pool_acquire ();
+    print_result ("multires p", MULTIRES_FFT_SIZE, MULTIRES_LEVELS, measure (bench_multires, b), MULTIRES_FFT_SIZE, "Msamples/s");
+    dsp_pool_release ();
+    for (int i = 0; i < MULTIRES_LEVELS; i++) {
+        level_t *l = &b->levels[i];
+        fftw_destroy_plan (l->plan);
+        fftw_free (l->window);
+        fftw_free (l->fft_in);
+        fftw_free (l->fft_out);
+        fftw_free (l->spectrum);
+    }
+
+    // the transforms share one plan like in the context
+    b->taper_in = fftw_malloc (sizeof (double) * TAPERS_FFT_SIZE * DSP_MAX_TAPERS);
+    b->taper_out = fftw_malloc (sizeof (fftw_complex) * (TAPERS_FFT_SIZE/2 + 2) * DSP_MAX_TAPERS);
+    b->plan = dsp_fft_plan (TAPERS_FFT_SIZE, b->taper_in, b->taper_out);
+    static const int taper_counts[] = {3, 5, 7};
+    for (int i = 0; i < 3; i++) {
+        b->tapers = dsp_tapers_acquire (TAPERS_FFT_SIZE, taper_counts[i], DSP_DEFAULT_TIME_BANDWIDTH);
+        if (b->tapers) {
+            print_result ("tapers", TAPERS_FFT_SIZE, taper_counts[i], measure (bench_tapers, b), TAPERS_FFT_SIZE, "Msamples/s");
+            dsp_tapers_release (b->tapers);
+        }
+    }
+    fftw_destroy_plan (b->plan);
+    fftw_free (b->taper_in);
+    fftw_free (b->taper_out);
+
+    // the cost per frame should not depend on the frames held
+    static const int average_sizes[] = {8192, 65536};
+    static const int average_frames[] = {8, 64};
+    for (int i = 0; i < 2; i++) {
+        const int bins = average_sizes[i]/2 + 1;
+        b->average = dsp_average_new (DSP_AVERAGING_EXPONENTIAL, bins, 0);
+        if (b->average) {
+            print_result ("exp avg", average_sizes[i], 0, measure (bench_average, b), bins, "Mbins/s");
+            dsp_average_free (b->average);
+        }
+        for (int j = 0; j < 2; j++) {
+            b->average = dsp_average_new (DSP_AVERAGING_WELCH, bins, average_frames[j]);
+            if (b->average) {
+                print_result ("welch", average_sizes[i], average_frames[j], measure (bench_average, b), bins, "Mbins/s");
+                dsp_average_free (b->average);
+            }
+        }
+    }
+
+    fftw_free (b->samples);
+    fftw_free (b->window);
+    fftw_free (b->fft_in);
+    fftw_free (b->fft_out);
+    fftw_free (b->spectrum);
+    fftw_free (b->deriv_window);
+    fftw_free (b->deriv_in);
+    fftw_free (b->deriv_out);
+    fftw_free (b->bin_freq);
+    free (b);
+    return 0;
+}
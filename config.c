@@ -34,6 +34,8 @@
 
 #include "spectrum.h"
 #include "config.h"
+#include "governor.h"
+#include "utils.h"
 
 int CONFIG_REFRESH_INTERVAL = 25;
 int CONFIG_DB_RANGE = 70;
@@ -51,11 +53,30 @@ int CONFIG_GRADIENT_ORIENTATION = 0;
 int CONFIG_NUM_COLORS = 6;
 int CONFIG_FFT_SIZE = 8192;
 int CONFIG_WINDOW = 0;
+float CONFIG_WINDOW_PARAM = 0;
+float CONFIG_MIN_FREQ = DSP_DEFAULT_MIN_FREQ;
+float CONFIG_MAX_FREQ = DSP_DEFAULT_MAX_FREQ;
+int CONFIG_ENGINE = DSP_ENGINE_FFT;
+int CONFIG_BANDS_PER_OCTAVE = 3;
+int CONFIG_DETECTOR = DSP_DETECTOR_RMS;
+int CONFIG_RESOLUTIONS = 1;
+int CONFIG_REASSIGN = 0;
+int CONFIG_TAPERS = 1;
+float CONFIG_TIME_BANDWIDTH = DSP_DEFAULT_TIME_BANDWIDTH;
+int CONFIG_AVERAGING = DSP_AVERAGING_NONE;
+float CONFIG_AVERAGE_TIME = 1;
+int CONFIG_AVERAGE_FRAMES = 8;
+int CONFIG_CHANNEL_LAYOUT = CHANNELS_COMBINED;
+int CONFIG_NUM_CHANNELS = 2;
+int CONFIG_DOWNMIX = DSP_DOWNMIX_MID;
 int CONFIG_NUM_BARS = 132;
 int CONFIG_BAR_W = 0;
 int CONFIG_GAPS = TRUE;
 int CONFIG_DRAW_STYLE = FALSE;
 int CONFIG_FILL_SPECTRUM = TRUE;
+int CONFIG_GOVERNOR = TRUE;
+int CONFIG_GOVERNOR_BUDGET = 30;
+int CONFIG_GOVERNOR_ORDER[NUM_KNOBS] = {KNOB_REFRESH, KNOB_OVERLAP, KNOB_BARS, KNOB_FFT};
 GdkColor CONFIG_COLOR_BG;
 GdkColor CONFIG_COLOR_VGRID;
 GdkColor CONFIG_COLOR_HGRID;
@@ -67,6 +88,72 @@ uint32_t CONFIG_COLOR_HGRID32 = 0xff666666;
 uint32_t CONFIG_COLOR_OCTAVE_GRID32 = 0xff666666;
 
 int FFT_INDEX = 4;
+uint32_t CONFIG_SERIAL = 0;
+
+// settings tracked for changes and the group that has to be rebuilt for them
+static const struct {
+    const void *value;
+    size_t size;
+    uint32_t group;
+} config_values[] = {
+    { &CONFIG_FFT_SIZE,             sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_WINDOW,               sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_WINDOW_PARAM,         sizeof (float),                 CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_MIN_FREQ,             sizeof (float),                 CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_MAX_FREQ,             sizeof (float),                 CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_ENGINE,               sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_BANDS_PER_OCTAVE,     sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_DETECTOR,             sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_RESOLUTIONS,          sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_REASSIGN,             sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_TAPERS,               sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_TIME_BANDWIDTH,       sizeof (float),                 CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_AVERAGING,            sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_AVERAGE_TIME,         sizeof (float),                 CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_AVERAGE_FRAMES,       sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_CHANNEL_LAYOUT,       sizeof (int),                   CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_NUM_CHANNELS,         sizeof (int),                   CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_DOWNMIX,              sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_BAR_FALLOFF,          sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_BAR_DELAY,            sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_PEAK_FALLOFF,         sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_PEAK_DELAY,           sizeof (int),                   CONFIG_CHANGED_ANALYSIS },
+    { &CONFIG_DB_RANGE,             sizeof (int),                   CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_NUM_BARS,             sizeof (int),                   CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_BAR_W,                sizeof (int),                   CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_GAPS,                 sizeof (int),                   CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_DRAW_STYLE,           sizeof (int),                   CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_REFRESH_INTERVAL,     sizeof (int),                   CONFIG_CHANGED_REFRESH },
+    { &CONFIG_GOVERNOR,             sizeof (int),                   CONFIG_CHANGED_GOVERNOR },
+    { &CONFIG_GOVERNOR_BUDGET,      sizeof (int),                   CONFIG_CHANGED_GOVERNOR },
+    { CONFIG_GOVERNOR_ORDER,        sizeof (int) * NUM_KNOBS,       CONFIG_CHANGED_GOVERNOR },
+    { &CONFIG_NUM_COLORS,           sizeof (int),                   CONFIG_CHANGED_GRADIENT },
+    { CONFIG_GRADIENT_COLORS,       sizeof (GdkColor) * MAX_NUM_COLORS, CONFIG_CHANGED_GRADIENT },
+    { &CONFIG_ENABLE_HGRID,         sizeof (int),                   CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_ENABLE_VGRID,         sizeof (int),                   CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_ENABLE_OCTAVE_GRID,   sizeof (int),                   CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_ALIGNMENT,            sizeof (int),                   CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_ENABLE_BAR_MODE,      sizeof (int),                   CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_DISPLAY_OCTAVES,      sizeof (int),                   CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_GRADIENT_ORIENTATION, sizeof (int),                   CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_FILL_SPECTRUM,        sizeof (int),                   CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_COLOR_BG32,           sizeof (uint32_t),              CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_COLOR_VGRID32,        sizeof (uint32_t),              CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_COLOR_HGRID32,        sizeof (uint32_t),              CONFIG_CHANGED_LAYOUT },
+    { &CONFIG_COLOR_OCTAVE_GRID32,  sizeof (uint32_t),              CONFIG_CHANGED_LAYOUT },
+};
+
+// applied: copy of config_values as of the last commit
+static unsigned char applied[512];
+static int applied_valid;
+// changed_serial: value of CONFIG_SERIAL when each group last changed
+static uint32_t changed_serial[NUM_CONFIG_CHANGES];
+
+// snapshot: published with an atomic exchange, replaced snapshots are put on the
+// retired list and freed as soon as no reader holds any snapshot
+static config_snapshot_t *snapshot;
+static config_snapshot_t *retired;
+static int readers;
 
 static char *default_colors[] = {"65535 0 0",
                                  "65535 32896 0",
@@ -75,6 +162,31 @@ static char *default_colors[] = {"65535 0 0",
                                  "0 38036 41120",
                                  "0 8224 25700" };
 
+static const char *default_governor_order = "0 1 2 3";
+
+static void
+parse_governor_order (const char *str)
+{
+    int order[NUM_KNOBS];
+    int used[NUM_KNOBS] = {0};
+    if (sscanf (str, "%d %d %d %d", &order[0], &order[1], &order[2], &order[3]) == NUM_KNOBS) {
+        int valid = 1;
+        for (int i = 0; i < NUM_KNOBS && valid; i++) {
+            if (order[i] < 0 || order[i] >= NUM_KNOBS || used[order[i]]) {
+                valid = 0;
+            }
+            else {
+                used[order[i]] = 1;
+            }
+        }
+        if (valid) {
+            memcpy (CONFIG_GOVERNOR_ORDER, order, sizeof (order));
+            return;
+        }
+    }
+    sscanf (default_governor_order, "%d %d %d %d", &CONFIG_GOVERNOR_ORDER[0], &CONFIG_GOVERNOR_ORDER[1], &CONFIG_GOVERNOR_ORDER[2], &CONFIG_GOVERNOR_ORDER[3]);
+}
+
 void
 save_config (void)
 {
@@ -98,9 +210,29 @@ save_config (void)
     deadbeef->conf_set_int (CONFSTR_MS_PEAK_DELAY,                  CONFIG_PEAK_DELAY);
     deadbeef->conf_set_int (CONFSTR_MS_GRADIENT_ORIENTATION,        CONFIG_GRADIENT_ORIENTATION);
     deadbeef->conf_set_int (CONFSTR_MS_WINDOW,                      CONFIG_WINDOW);
+    deadbeef->conf_set_float (CONFSTR_MS_WINDOW_PARAM,              CONFIG_WINDOW_PARAM);
+    deadbeef->conf_set_float (CONFSTR_MS_MIN_FREQ,                  CONFIG_MIN_FREQ);
+    deadbeef->conf_set_float (CONFSTR_MS_MAX_FREQ,                  CONFIG_MAX_FREQ);
+    deadbeef->conf_set_int (CONFSTR_MS_ENGINE,                      CONFIG_ENGINE);
+    deadbeef->conf_set_int (CONFSTR_MS_BANDS_PER_OCTAVE,            CONFIG_BANDS_PER_OCTAVE);
+    deadbeef->conf_set_int (CONFSTR_MS_DETECTOR,                    CONFIG_DETECTOR);
+    deadbeef->conf_set_int (CONFSTR_MS_RESOLUTIONS,                 CONFIG_RESOLUTIONS);
+    deadbeef->conf_set_int (CONFSTR_MS_REASSIGN,                    CONFIG_REASSIGN);
+    deadbeef->conf_set_int (CONFSTR_MS_TAPERS,                      CONFIG_TAPERS);
+    deadbeef->conf_set_float (CONFSTR_MS_TIME_BANDWIDTH,            CONFIG_TIME_BANDWIDTH);
+    deadbeef->conf_set_int (CONFSTR_MS_AVERAGING,                   CONFIG_AVERAGING);
+    deadbeef->conf_set_float (CONFSTR_MS_AVERAGE_TIME,              CONFIG_AVERAGE_TIME);
+    deadbeef->conf_set_int (CONFSTR_MS_AVERAGE_FRAMES,              CONFIG_AVERAGE_FRAMES);
+    deadbeef->conf_set_int (CONFSTR_MS_CHANNEL_LAYOUT,              CONFIG_CHANNEL_LAYOUT);
+    deadbeef->conf_set_int (CONFSTR_MS_NUM_CHANNELS,                CONFIG_NUM_CHANNELS);
+    deadbeef->conf_set_int (CONFSTR_MS_DOWNMIX,                     CONFIG_DOWNMIX);
     deadbeef->conf_set_int (CONFSTR_MS_NUM_COLORS,                  CONFIG_NUM_COLORS);
+    deadbeef->conf_set_int (CONFSTR_MS_GOVERNOR,                    CONFIG_GOVERNOR);
+    deadbeef->conf_set_int (CONFSTR_MS_GOVERNOR_BUDGET,             CONFIG_GOVERNOR_BUDGET);
     char color[100];
     char conf_str[100];
+    snprintf (conf_str, sizeof (conf_str), "%d %d %d %d", CONFIG_GOVERNOR_ORDER[0], CONFIG_GOVERNOR_ORDER[1], CONFIG_GOVERNOR_ORDER[2], CONFIG_GOVERNOR_ORDER[3]);
+    deadbeef->conf_set_str (CONFSTR_MS_GOVERNOR_ORDER, conf_str);
     for (int i = 0; i < CONFIG_NUM_COLORS; i++) {
         snprintf (color, sizeof (color), "%d %d %d", CONFIG_GRADIENT_COLORS[i].red, CONFIG_GRADIENT_COLORS[i].green, CONFIG_GRADIENT_COLORS[i].blue);
         snprintf (conf_str, sizeof (conf_str), "%s%02d", CONFSTR_MS_COLOR_GRADIENT, i);
@@ -116,12 +248,206 @@ save_config (void)
     deadbeef->conf_set_str (CONFSTR_MS_COLOR_OCTAVE_GRID, color);
 }
 
+// compares the settings to the last commit and records the groups that changed
+static uint32_t
+commit_config (void)
+{
+    uint32_t changes = 0;
+    size_t offset = 0;
+    for (size_t i = 0; i < G_N_ELEMENTS (config_values); i++) {
+        assert (offset + config_values[i].size <= sizeof (applied));
+        if (!applied_valid || memcmp (applied + offset, config_values[i].value, config_values[i].size)) {
+            memcpy (applied + offset, config_values[i].value, config_values[i].size);
+            changes |= config_values[i].group;
+        }
+        offset += config_values[i].size;
+    }
+    applied_valid = 1;
+
+    if (changes) {
+        // read by the widgets without the lock, the groups are stored before the serial
+        // and both before the snapshot of this serial is published
+        const uint32_t serial = __atomic_load_n (&CONFIG_SERIAL, __ATOMIC_RELAXED) + 1;
+        for (int i = 0; i < NUM_CONFIG_CHANGES; i++) {
+            if (changes & (1 << i)) {
+                __atomic_store_n (&changed_serial[i], serial, __ATOMIC_RELEASE);
+            }
+        }
+        __atomic_store_n (&CONFIG_SERIAL, serial, __ATOMIC_RELEASE);
+    }
+    return changes;
+}
+
+static draw_color_t
+draw_color (const GdkColor *color)
+{
+    draw_color_t c = { color->red/65535.f, color->green/65535.f, color->blue/65535.f };
+    return c;
+}
+
+static config_snapshot_t *
+config_snapshot_new (void)
+{
+    config_snapshot_t *s = calloc (1, sizeof (config_snapshot_t));
+    if (!s) {
+        return NULL;
+    }
+    s->serial = __atomic_load_n (&CONFIG_SERIAL, __ATOMIC_RELAXED);
+    s->refresh_interval = MAX (CONFIG_REFRESH_INTERVAL, 1);
+    s->fft_size = CONFIG_FFT_SIZE;
+    s->window = CLAMP (CONFIG_WINDOW, 0, DSP_NUM_WINDOWS - 1);
+    s->window_param = MAX (CONFIG_WINDOW_PARAM, 0);
+    s->engine = CLAMP (CONFIG_ENGINE, 0, DSP_NUM_ENGINES - 1);
+    s->bands_per_octave = CLAMP (CONFIG_BANDS_PER_OCTAVE, 1, DSP_MAX_BANDS_PER_OCTAVE);
+    s->detector = CLAMP (CONFIG_DETECTOR, DSP_DETECTOR_RMS, DSP_DETECTOR_PEAK);
+    s->resolutions = CLAMP (CONFIG_RESOLUTIONS, 1, DSP_MAX_RESOLUTIONS);
+    s->reassign = CONFIG_REASSIGN;
+    s->tapers = CLAMP (CONFIG_TAPERS, 1, DSP_MAX_TAPERS);
+    s->time_bandwidth = CLAMP (CONFIG_TIME_BANDWIDTH, 1, DSP_MAX_TIME_BANDWIDTH);
+    s->averaging = CLAMP (CONFIG_AVERAGING, DSP_AVERAGING_NONE, DSP_NUM_AVERAGING_MODES - 1);
+    s->average_time = CLAMP (CONFIG_AVERAGE_TIME, 0.01f, DSP_MAX_AVERAGE_TIME);
+    s->average_frames = CLAMP (CONFIG_AVERAGE_FRAMES, 2, DSP_MAX_AVERAGE_FRAMES);
+    s->min_freq = MAX (CONFIG_MIN_FREQ, 1);
+    s->max_freq = CONFIG_MAX_FREQ > s->min_freq ? CONFIG_MAX_FREQ : 2 * s->min_freq;
+    s->channel_layout = CLAMP (CONFIG_CHANNEL_LAYOUT, CHANNELS_COMBINED, CHANNELS_OVERLAID);
+    s->num_channels = CLAMP (CONFIG_NUM_CHANNELS, 1, DSP_MAX_CHANNELS);
+    s->downmix = CLAMP (CONFIG_DOWNMIX, DSP_DOWNMIX_MID, DSP_DOWNMIX_RMS);
+    s->db_range = MAX (CONFIG_DB_RANGE, 1);
+    s->num_bars = CONFIG_NUM_BARS;
+    s->bar_w = CONFIG_BAR_W;
+    s->gaps = CONFIG_GAPS;
+    s->draw_style = CONFIG_DRAW_STYLE;
+    s->fill_spectrum = CONFIG_FILL_SPECTRUM;
+    s->enable_hgrid = CONFIG_ENABLE_HGRID;
+    s->enable_vgrid = CONFIG_ENABLE_VGRID;
+    s->enable_octave_grid = CONFIG_ENABLE_OCTAVE_GRID;
+    s->enable_bar_mode = CONFIG_ENABLE_BAR_MODE;
+    s->display_octaves = CONFIG_DISPLAY_OCTAVES;
+    s->alignment = CONFIG_ALIGNMENT;
+    s->gradient_orientation = CONFIG_GRADIENT_ORIENTATION;
+    s->bar_falloff = CONFIG_BAR_FALLOFF;
+    s->bar_delay = CONFIG_BAR_DELAY;
+    s->peak_falloff = CONFIG_PEAK_FALLOFF;
+    s->peak_delay = CONFIG_PEAK_DELAY;
+    s->governor = CONFIG_GOVERNOR;
+    s->governor_budget = CONFIG_GOVERNOR_BUDGET;
+    memcpy (s->governor_order, CONFIG_GOVERNOR_ORDER, sizeof (s->governor_order));
+    s->num_colors = CLAMP (CONFIG_NUM_COLORS, 1, MAX_NUM_COLORS);
+    s->color_bg32 = CONFIG_COLOR_BG32;
+    s->color_vgrid32 = CONFIG_COLOR_VGRID32;
+    s->color_hgrid32 = CONFIG_COLOR_HGRID32;
+    s->color_octave_grid32 = CONFIG_COLOR_OCTAVE_GRID32;
+
+    s->bar_falloff_per_ms = s->bar_falloff != -1 ? s->bar_falloff/1000.f : -1;
+    s->peak_falloff_per_ms = s->peak_falloff != -1 ? s->peak_falloff/1000.f : -1;
+    s->amplitude_offset = s->db_range;
+    s->bar_step = s->bar_w > 0 ? s->bar_w + (s->gaps ? 1 : 0) : 0;
+    switch (s->channel_layout) {
+    case CHANNELS_COMBINED:
+        s->channels = 1;
+        break;
+    case CHANNELS_MIRRORED:
+        s->channels = 2;
+        break;
+    default:
+        s->channels = s->num_channels;
+        break;
+    }
+    create_gradient_table (s->colors, CONFIG_GRADIENT_COLORS, s->num_colors);
+    for (int i = 0; i < s->num_colors; i++) {
+        s->gradient_colors[i] = draw_color (&CONFIG_GRADIENT_COLORS[i]);
+    }
+    s->color_bg = draw_color (&CONFIG_COLOR_BG);
+    s->color_hgrid = draw_color (&CONFIG_COLOR_HGRID);
+    s->color_octave_grid = draw_color (&CONFIG_COLOR_OCTAVE_GRID);
+    return s;
+}
+
+// frees the retired snapshots if no reader can still hold one of them
+static void
+config_reclaim (void)
+{
+    config_snapshot_t *list = __atomic_exchange_n (&retired, NULL, __ATOMIC_SEQ_CST);
+    if (!list) {
+        return;
+    }
+    // readers arriving after the exchange can only see the current snapshot
+    if (__atomic_load_n (&readers, __ATOMIC_SEQ_CST) == 0) {
+        while (list) {
+            config_snapshot_t *next = list->next;
+            free (list);
+            list = next;
+        }
+        return;
+    }
+    config_snapshot_t *tail = list;
+    while (tail->next) {
+        tail = tail->next;
+    }
+    tail->next = __atomic_load_n (&retired, __ATOMIC_SEQ_CST);
+    while (!__atomic_compare_exchange_n (&retired, &tail->next, list, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+}
+
+static void
+config_publish (config_snapshot_t *s)
+{
+    config_snapshot_t *old = __atomic_exchange_n (&snapshot, s, __ATOMIC_SEQ_CST);
+    if (old) {
+        old->next = __atomic_load_n (&retired, __ATOMIC_SEQ_CST);
+        while (!__atomic_compare_exchange_n (&retired, &old->next, old, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+    }
+    config_reclaim ();
+}
+
+const config_snapshot_t *
+config_acquire (void)
+{
+    __atomic_add_fetch (&readers, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n (&snapshot, __ATOMIC_SEQ_CST);
+}
+
 void
+config_release (const config_snapshot_t *s)
+{
+    if (__atomic_sub_fetch (&readers, 1, __ATOMIC_SEQ_CST) == 0) {
+        config_reclaim ();
+    }
+}
+
+uint32_t
+config_changes_since (uint32_t serial)
+{
+    uint32_t changes = 0;
+    for (int i = 0; i < NUM_CONFIG_CHANGES; i++) {
+        if (__atomic_load_n (&changed_serial[i], __ATOMIC_ACQUIRE) > serial) {
+            changes |= 1 << i;
+        }
+    }
+    return changes;
+}
+
+uint32_t
 load_config (void)
 {
     deadbeef->conf_lock ();
     CONFIG_GRADIENT_ORIENTATION = deadbeef->conf_get_int (CONFSTR_MS_GRADIENT_ORIENTATION,   0);
     CONFIG_WINDOW = deadbeef->conf_get_int (CONFSTR_MS_WINDOW,                 BLACKMAN_HARRIS);
+    CONFIG_WINDOW_PARAM = deadbeef->conf_get_float (CONFSTR_MS_WINDOW_PARAM,                 0);
+    CONFIG_MIN_FREQ = deadbeef->conf_get_float (CONFSTR_MS_MIN_FREQ,      DSP_DEFAULT_MIN_FREQ);
+    CONFIG_MAX_FREQ = deadbeef->conf_get_float (CONFSTR_MS_MAX_FREQ,      DSP_DEFAULT_MAX_FREQ);
+    CONFIG_ENGINE = deadbeef->conf_get_int (CONFSTR_MS_ENGINE,                 DSP_ENGINE_FFT);
+    CONFIG_BANDS_PER_OCTAVE = deadbeef->conf_get_int (CONFSTR_MS_BANDS_PER_OCTAVE,           3);
+    CONFIG_DETECTOR = deadbeef->conf_get_int (CONFSTR_MS_DETECTOR,           DSP_DETECTOR_RMS);
+    CONFIG_RESOLUTIONS = deadbeef->conf_get_int (CONFSTR_MS_RESOLUTIONS,                     1);
+    CONFIG_REASSIGN = deadbeef->conf_get_int (CONFSTR_MS_REASSIGN,                           0);
+    CONFIG_TAPERS = deadbeef->conf_get_int (CONFSTR_MS_TAPERS,                               1);
+    CONFIG_TIME_BANDWIDTH = deadbeef->conf_get_float (CONFSTR_MS_TIME_BANDWIDTH, DSP_DEFAULT_TIME_BANDWIDTH);
+    CONFIG_AVERAGING = deadbeef->conf_get_int (CONFSTR_MS_AVERAGING,        DSP_AVERAGING_NONE);
+    CONFIG_AVERAGE_TIME = deadbeef->conf_get_float (CONFSTR_MS_AVERAGE_TIME,                 1);
+    CONFIG_AVERAGE_FRAMES = deadbeef->conf_get_int (CONFSTR_MS_AVERAGE_FRAMES,               8);
+    CONFIG_CHANNEL_LAYOUT = deadbeef->conf_get_int (CONFSTR_MS_CHANNEL_LAYOUT, CHANNELS_COMBINED);
+    CONFIG_NUM_CHANNELS = deadbeef->conf_get_int (CONFSTR_MS_NUM_CHANNELS,                   2);
+    CONFIG_DOWNMIX = deadbeef->conf_get_int (CONFSTR_MS_DOWNMIX,              DSP_DOWNMIX_MID);
     CONFIG_FFT_SIZE = deadbeef->conf_get_int (CONFSTR_MS_FFT_SIZE,                        8192);
     FFT_INDEX = log2 (CONFIG_FFT_SIZE) - 9;
     CONFIG_DB_RANGE = deadbeef->conf_get_int (CONFSTR_MS_DB_RANGE,                          70);
@@ -142,6 +468,9 @@ load_config (void)
     CONFIG_PEAK_FALLOFF = deadbeef->conf_get_int (CONFSTR_MS_PEAK_FALLOFF,                  90);
     CONFIG_PEAK_DELAY = deadbeef->conf_get_int (CONFSTR_MS_PEAK_DELAY,                     500);
     CONFIG_NUM_COLORS = deadbeef->conf_get_int (CONFSTR_MS_NUM_COLORS,                       6);
+    CONFIG_GOVERNOR = deadbeef->conf_get_int (CONFSTR_MS_GOVERNOR,                        TRUE);
+    CONFIG_GOVERNOR_BUDGET = deadbeef->conf_get_int (CONFSTR_MS_GOVERNOR_BUDGET,            30);
+    parse_governor_order (deadbeef->conf_get_str_fast (CONFSTR_MS_GOVERNOR_ORDER, default_governor_order));
     const char *color;
     char conf_str[100];
     color = deadbeef->conf_get_str_fast (CONFSTR_MS_COLOR_BG,                   "8738 8738 8738");
@@ -178,6 +507,17 @@ load_config (void)
     CONFIG_COLOR_OCTAVE_GRID32 = ((uint32_t)(CONFIG_COLOR_OCTAVE_GRID.red * scale) & 0xFF) << 16 |
                         ((uint32_t)(CONFIG_COLOR_OCTAVE_GRID.green * scale) & 0xFF) << 8 |
                         ((uint32_t)(CONFIG_COLOR_OCTAVE_GRID.blue * scale) & 0xFF) << 0;
+    // the config dialog sets the globals before saving, so changes are found against the last commit
+    const uint32_t changes = commit_config ();
+    // the snapshot is taken under the lock too, the dialog or another reload could
+    // otherwise rewrite the globals halfway through it
+    if (changes || !__atomic_load_n (&snapshot, __ATOMIC_SEQ_CST)) {
+        config_snapshot_t *s = config_snapshot_new ();
+        if (s) {
+            config_publish (s);
+        }
+    }
     deadbeef->conf_unlock ();
+    return changes;
 }
 
@@ -25,6 +25,11 @@
 #ifndef CONFIG_HEADER
 #define CONFIG_HEADER
 
+#include <stdint.h>
+
+#include "draw_utils.h"
+#include "governor.h"
+
 #define     CONFSTR_MS_REFRESH_INTERVAL       "musical_spectrum.refresh_interval"
 #define     CONFSTR_MS_FFT_SIZE               "musical_spectrum.fft_size"
 #define     CONFSTR_MS_DB_RANGE               "musical_spectrum.db_range"
@@ -45,12 +50,31 @@
 #define     CONFSTR_MS_GRADIENT_ORIENTATION   "musical_spectrum.gradient_orientation"
 #define     CONFSTR_MS_ALIGNMENT              "musical_spectrum.alignment"
 #define     CONFSTR_MS_WINDOW                 "musical_spectrum.window"
+#define     CONFSTR_MS_WINDOW_PARAM           "musical_spectrum.window_param"
+#define     CONFSTR_MS_MIN_FREQ               "musical_spectrum.min_freq"
+#define     CONFSTR_MS_MAX_FREQ               "musical_spectrum.max_freq"
+#define     CONFSTR_MS_ENGINE                 "musical_spectrum.engine"
+#define     CONFSTR_MS_BANDS_PER_OCTAVE       "musical_spectrum.bands_per_octave"
+#define     CONFSTR_MS_DETECTOR               "musical_spectrum.detector"
+#define     CONFSTR_MS_RESOLUTIONS            "musical_spectrum.resolutions"
+#define     CONFSTR_MS_REASSIGN               "musical_spectrum.reassign"
+#define     CONFSTR_MS_TAPERS                 "musical_spectrum.tapers"
+#define     CONFSTR_MS_TIME_BANDWIDTH         "musical_spectrum.time_bandwidth"
+#define     CONFSTR_MS_AVERAGING              "musical_spectrum.averaging"
+#define     CONFSTR_MS_AVERAGE_TIME           "musical_spectrum.average_time"
+#define     CONFSTR_MS_AVERAGE_FRAMES         "musical_spectrum.average_frames"
+#define     CONFSTR_MS_CHANNEL_LAYOUT         "musical_spectrum.channel_layout"
+#define     CONFSTR_MS_NUM_CHANNELS           "musical_spectrum.num_channels"
+#define     CONFSTR_MS_DOWNMIX                "musical_spectrum.downmix"
 #define     CONFSTR_MS_COLOR_BG               "musical_spectrum.color.background"
 #define     CONFSTR_MS_COLOR_VGRID            "musical_spectrum.color.vgrid"
 #define     CONFSTR_MS_COLOR_HGRID            "musical_spectrum.color.hgrid"
 #define     CONFSTR_MS_COLOR_OCTAVE_GRID      "musical_spectrum.color.octave_grid"
 #define     CONFSTR_MS_NUM_COLORS             "musical_spectrum.num_colors"
 #define     CONFSTR_MS_COLOR_GRADIENT         "musical_spectrum.color.gradient_"
+#define     CONFSTR_MS_GOVERNOR               "musical_spectrum.governor"
+#define     CONFSTR_MS_GOVERNOR_BUDGET        "musical_spectrum.governor.budget"
+#define     CONFSTR_MS_GOVERNOR_ORDER         "musical_spectrum.governor.order"
 
 #define MAX_NUM_COLORS 16
 #define NUM_DEFAULT_COLORS 6
@@ -71,11 +95,30 @@ extern int CONFIG_GRADIENT_ORIENTATION;
 extern int CONFIG_NUM_COLORS;
 extern int CONFIG_FFT_SIZE;
 extern int CONFIG_WINDOW;
+extern float CONFIG_WINDOW_PARAM;
+extern float CONFIG_MIN_FREQ;
+extern float CONFIG_MAX_FREQ;
+extern int CONFIG_ENGINE;
+extern int CONFIG_BANDS_PER_OCTAVE;
+extern int CONFIG_DETECTOR;
+extern int CONFIG_RESOLUTIONS;
+extern int CONFIG_REASSIGN;
+extern int CONFIG_TAPERS;
+extern float CONFIG_TIME_BANDWIDTH;
+extern int CONFIG_AVERAGING;
+extern float CONFIG_AVERAGE_TIME;
+extern int CONFIG_AVERAGE_FRAMES;
+extern int CONFIG_CHANNEL_LAYOUT;
+extern int CONFIG_NUM_CHANNELS;
+extern int CONFIG_DOWNMIX;
 extern int CONFIG_NUM_BARS;
 extern int CONFIG_BAR_W;
 extern int CONFIG_GAPS;
 extern int CONFIG_DRAW_STYLE;
 extern int CONFIG_FILL_SPECTRUM;
+extern int CONFIG_GOVERNOR;
+extern int CONFIG_GOVERNOR_BUDGET;
+extern int CONFIG_GOVERNOR_ORDER[];
 extern GdkColor CONFIG_COLOR_BG;
 extern GdkColor CONFIG_COLOR_VGRID;
 extern GdkColor CONFIG_COLOR_HGRID;
@@ -87,13 +130,122 @@ extern uint32_t CONFIG_COLOR_HGRID32;
 extern uint32_t CONFIG_COLOR_OCTAVE_GRID32;
 
 extern int FFT_INDEX;
+// CONFIG_SERIAL: incremented by every load_config that changed a value
+extern uint32_t CONFIG_SERIAL;
 
-enum WINDOW { BLACKMAN_HARRIS = 0, HANNING = 1 };
+// same values as enum DSP_WINDOW
+enum WINDOW { BLACKMAN_HARRIS = 0, HANNING = 1, HAMMING = 2, BLACKMAN_HARRIS_7 = 3, NUTTALL = 4, FLAT_TOP = 5, KAISER = 6, GAUSSIAN = 7 };
 enum ALIGNMENT { LEFT = 0, RIGHT = 1, CENTER = 2 };
+// COMBINED: one spectrum of all channels, MIRRORED: first two channels, the second one upside down
+// below the first, STACKED: one strip per channel, OVERLAID: all channels on top of each other
+enum CHANNEL_LAYOUT { CHANNELS_COMBINED = 0, CHANNELS_MIRRORED = 1, CHANNELS_STACKED = 2, CHANNELS_OVERLAID = 3 };
 
-void
+// groups of settings, by what has to be rebuilt when one of them changes
+enum CONFIG_CHANGES {
+    CONFIG_CHANGED_ANALYSIS = 1 << 0,   // fft, window, bar count, animation
+    CONFIG_CHANGED_REFRESH  = 1 << 1,   // refresh interval
+    CONFIG_CHANGED_GOVERNOR = 1 << 2,   // governor switch, budget and order
+    CONFIG_CHANGED_GRADIENT = 1 << 3,   // gradient colors
+    CONFIG_CHANGED_LAYOUT   = 1 << 4,   // grids, background and bar geometry
+};
+#define NUM_CONFIG_CHANGES 5
+
+// Immutable copy of the settings, taken by load_config whenever something changed.
+// Drawing and analysis read it once per frame instead of the CONFIG_* globals,
+// which the config dialog and load_config may rewrite at any time.
+typedef struct config_snapshot_s {
+    // serial: CONFIG_SERIAL this snapshot was taken at
+    uint32_t serial;
+    int refresh_interval;
+    int fft_size;
+    int window;
+    float window_param;
+    // min_freq, max_freq: configured range, max_freq is above min_freq. Widgets zoomed into
+    // a band show that instead, see get_range.
+    float min_freq;
+    float max_freq;
+    // engine: enum DSP_ENGINE
+    int engine;
+    // bands_per_octave, detector: of the filter bank
+    int bands_per_octave;
+    int detector;
+    // resolutions: transform sizes combined per band, see dsp_config_t
+    int resolutions;
+    // reassign: frequency reassignment of the bass bands, see dsp_config_t
+    int reassign;
+    // tapers, time_bandwidth: multitaper estimate, see dsp_config_t
+    int tapers;
+    float time_bandwidth;
+    // averaging, average_time, average_frames: time average of the spectra, see dsp_config_t
+    int averaging;
+    float average_time;
+    int average_frames;
+    int channel_layout;
+    int num_channels;
+    int downmix;
+    int db_range;
+    int num_bars;
+    int bar_w;
+    int gaps;
+    int draw_style;
+    int fill_spectrum;
+    int enable_hgrid;
+    int enable_vgrid;
+    int enable_octave_grid;
+    int enable_bar_mode;
+    int display_octaves;
+    int alignment;
+    int gradient_orientation;
+    int bar_falloff;
+    int bar_delay;
+    int peak_falloff;
+    int peak_delay;
+    int governor;
+    int governor_budget;
+    int governor_order[NUM_KNOBS];
+    int num_colors;
+    uint32_t color_bg32;
+    uint32_t color_vgrid32;
+    uint32_t color_hgrid32;
+    uint32_t color_octave_grid32;
+
+    // derived values
+    // bar_falloff_per_ms, peak_falloff_per_ms: dB per ms, -1 if falloff is disabled
+    float bar_falloff_per_ms;
+    float peak_falloff_per_ms;
+    // amplitude_offset: puts 0 dB, a full scale sine, at the top of the spectrum
+    int amplitude_offset;
+    // channels: spectra analysed and drawn, 1 for the combined layout
+    int channels;
+    // bar_step: bar width plus gap when the bar width is fixed, 0 otherwise
+    int bar_step;
+    uint32_t colors[GRADIENT_TABLE_SIZE];
+    draw_color_t gradient_colors[MAX_NUM_COLORS];
+    draw_color_t color_bg;
+    draw_color_t color_hgrid;
+    draw_color_t color_octave_grid;
+
+    // next: retired snapshots waiting for their readers to finish
+    struct config_snapshot_s *next;
+} config_snapshot_t;
+
+// returns the groups changed since the previous load, none when only foreign keys changed,
+// and publishes a new snapshot if there were changes
+uint32_t
 load_config (void);
 
+// Returns the current snapshot, valid until the matching config_release.
+// Safe to call from any thread, returns NULL before the first load_config.
+const config_snapshot_t *
+config_acquire (void);
+
+void
+config_release (const config_snapshot_t *snapshot);
+
+// returns the groups changed after CONFIG_SERIAL had the given value
+uint32_t
+config_changes_since (uint32_t serial);
+
 void
 save_config (void);
 
@@ -37,6 +37,7 @@
 #include "config_dialog.h"
 #include "draw_utils.h"
 #include "utils.h"
+#include "governor.h"
 #include "spectrum.h"
 
 #define     STR_GRADIENT_VERTICAL "Vertical"
@@ -46,11 +47,28 @@
 #define     STR_ALIGNMENT_LEFT "Left"
 #define     STR_ALIGNMENT_RIGHT "Right"
 #define     STR_ALIGNMENT_CENTER "Center"
-#define     STR_WINDOW_BLACKMANN_HARRIS "Blackmann-Harris"
-#define     STR_WINDOW_HANNING "Hanning"
-
-static char *fft_sizes[] = {"512", "1024", "2048", "4096", "8192", "16384", "32768"};
-static int fft_sizses_size = 7;
+#define     STR_CHANNELS_COMBINED "Combined"
+#define     STR_CHANNELS_MIRRORED "Mirrored"
+#define     STR_CHANNELS_STACKED "Stacked"
+#define     STR_CHANNELS_OVERLAID "Overlaid"
+
+// in the order of enum WINDOW
+static char *window_names[] = {"Blackmann-Harris", "Hanning", "Hamming", "Blackman-Harris (7 term)", "Nuttall", "Flat top", "Kaiser", "Gaussian"};
+// combined channels, in the order of enum DSP_DOWNMIX
+static char *downmix_modes[] = {"Mid", "Side", "Left", "Right", "Loudest", "RMS"};
+static char *engine_names[] = {"FFT", "Sliding DFT", "Filter bank"};
+static char *octave_fractions[] = {"1/1 octave", "1/3 octave", "1/6 octave", "1/12 octave"};
+static const int octave_fraction_bands[] = {1, 3, 6, 12};
+static char *detector_names[] = {"RMS", "Peak"};
+// index + 1 transforms, see dsp_config_t.resolutions
+static char *resolution_names[] = {"Single FFT", "2 FFT sizes", "3 FFT sizes", "4 FFT sizes"};
+// index + 1 tapers, see dsp_config_t.tapers
+// in the order of enum DSP_AVERAGING
+static char *averaging_names[] = {"Off", "Exponential", "Welch"};
+static char *taper_names[] = {"Window", "2 tapers", "3 tapers", "4 tapers", "5 tapers", "6 tapers", "7 tapers", "8 tapers"};
+
+static char *fft_sizes[] = {"512", "1024", "2048", "4096", "8192", "16384", "32768", "65536", "131072", "262144"};
+static int fft_sizses_size = 10;
 static GdkColor gradient_colors_temp[MAX_NUM_COLORS];
 static uint32_t colors_temp[GRADIENT_TABLE_SIZE];
 
@@ -186,6 +204,29 @@ on_bar_width_changed (GtkSpinButton *spin, gpointer user_data)
 }
 
 
+static GtkWidget *governor_status;
+
+static gboolean
+update_governor_status (gpointer user_data)
+{
+    w_spectrum_t *w = user_data;
+    char text[200];
+    if (!CONFIG_GOVERNOR) {
+        snprintf (text, sizeof (text), "Governor disabled");
+    }
+    else {
+        const governor_t *g = &w->governor;
+        snprintf (text, sizeof (text), "CPU load: %.0f%%\nRefresh interval: %d ms\nMax. overlap: %d%%\nNumber of bars: %d\nFFT size: %d",
+                  g->load * 100,
+                  w->refresh_interval,
+                  governor_max_overlap (g),
+                  dsp_context_get_config (w->dsp)->num_bars,
+                  dsp_context_get_config (w->dsp)->fft_size);
+    }
+    gtk_label_set_text (GTK_LABEL (governor_status), text);
+    return TRUE;
+}
+
 void
 on_button_config (GtkMenuItem *menuitem, gpointer user_data)
 {
@@ -240,9 +281,42 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
     GtkWidget *display_octaves;
     GtkWidget *fft_label;
     GtkWidget *fft;
+    GtkWidget *engine_label;
+    GtkWidget *engine;
+    GtkWidget *hbox_resolutions;
+    GtkWidget *resolutions_label;
+    GtkWidget *resolutions;
+    GtkWidget *reassign;
+    GtkWidget *hbox_tapers;
+    GtkWidget *tapers_label;
+    GtkWidget *tapers;
+    GtkWidget *time_bandwidth_label;
+    GtkWidget *time_bandwidth;
+    GtkWidget *hbox_averaging;
+    GtkWidget *averaging_label;
+    GtkWidget *averaging;
+    GtkWidget *average_time_label;
+    GtkWidget *average_time;
+    GtkWidget *average_frames_label;
+    GtkWidget *average_frames;
+    GtkWidget *hbox_filter_bank;
+    GtkWidget *filter_bank_label;
+    GtkWidget *octave_fraction;
+    GtkWidget *detector;
     GtkWidget *hbox04;
     GtkWidget *window_label;
     GtkWidget *window;
+    GtkWidget *window_param;
+    GtkWidget *hbox_range;
+    GtkWidget *range_label;
+    GtkWidget *min_freq;
+    GtkWidget *max_freq;
+    GtkWidget *hbox_channels;
+    GtkWidget *channel_layout_label;
+    GtkWidget *channel_layout;
+    GtkWidget *num_channels;
+    GtkWidget *downmix_label;
+    GtkWidget *downmix;
     GtkWidget *hbox05;
     GtkWidget *hbox_draw_style;
     GtkWidget *draw_style_frame;
@@ -258,6 +332,15 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
     GtkWidget *hbox06;
     GtkWidget *alignment_label;
     GtkWidget *alignment;
+    GtkWidget *performance_label;
+    GtkWidget *performance_frame;
+    GtkWidget *vbox08;
+    GtkWidget *hbox10;
+    GtkWidget *governor;
+    GtkWidget *governor_budget_label;
+    GtkWidget *governor_budget;
+    GtkWidget *governor_order_label;
+    GtkWidget *governor_order[NUM_KNOBS];
     GtkWidget *dialog_action_area13;
     GtkWidget *applybutton1;
     GtkWidget *cancelbutton1;
@@ -466,6 +549,120 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
         gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(fft), fft_sizes[i]);
     }
 
+    engine_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (engine_label),"Analysis:");
+    gtk_widget_show (engine_label);
+    gtk_box_pack_start (GTK_BOX (hbox07), engine_label, FALSE, TRUE, 0);
+
+    engine = gtk_combo_box_text_new ();
+    gtk_widget_show (engine);
+    gtk_box_pack_start (GTK_BOX (hbox07), engine, TRUE, TRUE, 0);
+    for (int i = 0; i < (int)G_N_ELEMENTS (engine_names); i++) {
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(engine), engine_names[i]);
+    }
+
+    hbox_resolutions = gtk_hbox_new (FALSE, 8);
+    gtk_widget_show (hbox_resolutions);
+    gtk_box_pack_start (GTK_BOX (vbox06), hbox_resolutions, FALSE, FALSE, 0);
+
+    resolutions_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (resolutions_label),"Resolutions:");
+    gtk_widget_show (resolutions_label);
+    gtk_box_pack_start (GTK_BOX (hbox_resolutions), resolutions_label, FALSE, TRUE, 0);
+
+    resolutions = gtk_combo_box_text_new ();
+    gtk_widget_show (resolutions);
+    gtk_box_pack_start (GTK_BOX (hbox_resolutions), resolutions, TRUE, TRUE, 0);
+    for (int i = 0; i < (int)G_N_ELEMENTS (resolution_names); i++) {
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(resolutions), resolution_names[i]);
+    }
+
+    reassign = gtk_check_button_new_with_label ("Reassign bass");
+    gtk_widget_show (reassign);
+    gtk_box_pack_start (GTK_BOX (hbox_resolutions), reassign, FALSE, FALSE, 0);
+
+    hbox_tapers = gtk_hbox_new (FALSE, 8);
+    gtk_widget_show (hbox_tapers);
+    gtk_box_pack_start (GTK_BOX (vbox06), hbox_tapers, FALSE, FALSE, 0);
+
+    tapers_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (tapers_label),"Multitaper:");
+    gtk_widget_show (tapers_label);
+    gtk_box_pack_start (GTK_BOX (hbox_tapers), tapers_label, FALSE, TRUE, 0);
+
+    tapers = gtk_combo_box_text_new ();
+    gtk_widget_show (tapers);
+    gtk_box_pack_start (GTK_BOX (hbox_tapers), tapers, TRUE, TRUE, 0);
+    for (int i = 0; i < (int)G_N_ELEMENTS (taper_names); i++) {
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(tapers), taper_names[i]);
+    }
+
+    time_bandwidth_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (time_bandwidth_label),"NW:");
+    gtk_widget_show (time_bandwidth_label);
+    gtk_box_pack_start (GTK_BOX (hbox_tapers), time_bandwidth_label, FALSE, TRUE, 0);
+
+    time_bandwidth = gtk_spin_button_new_with_range (1,DSP_MAX_TIME_BANDWIDTH,0.5);
+    gtk_widget_show (time_bandwidth);
+    gtk_box_pack_start (GTK_BOX (hbox_tapers), time_bandwidth, FALSE, TRUE, 0);
+
+    hbox_averaging = gtk_hbox_new (FALSE, 8);
+    gtk_widget_show (hbox_averaging);
+    gtk_box_pack_start (GTK_BOX (vbox06), hbox_averaging, FALSE, FALSE, 0);
+
+    averaging_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (averaging_label),"Averaging:");
+    gtk_widget_show (averaging_label);
+    gtk_box_pack_start (GTK_BOX (hbox_averaging), averaging_label, FALSE, TRUE, 0);
+
+    averaging = gtk_combo_box_text_new ();
+    gtk_widget_show (averaging);
+    gtk_box_pack_start (GTK_BOX (hbox_averaging), averaging, TRUE, TRUE, 0);
+    for (int i = 0; i < (int)G_N_ELEMENTS (averaging_names); i++) {
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(averaging), averaging_names[i]);
+    }
+
+    average_time_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (average_time_label),"Time (s):");
+    gtk_widget_show (average_time_label);
+    gtk_box_pack_start (GTK_BOX (hbox_averaging), average_time_label, FALSE, TRUE, 0);
+
+    average_time = gtk_spin_button_new_with_range (0.1,DSP_MAX_AVERAGE_TIME,0.1);
+    gtk_widget_show (average_time);
+    gtk_box_pack_start (GTK_BOX (hbox_averaging), average_time, FALSE, TRUE, 0);
+
+    average_frames_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (average_frames_label),"Frames:");
+    gtk_widget_show (average_frames_label);
+    gtk_box_pack_start (GTK_BOX (hbox_averaging), average_frames_label, FALSE, TRUE, 0);
+
+    average_frames = gtk_spin_button_new_with_range (2,DSP_MAX_AVERAGE_FRAMES,1);
+    gtk_widget_show (average_frames);
+    gtk_box_pack_start (GTK_BOX (hbox_averaging), average_frames, FALSE, TRUE, 0);
+
+    hbox_filter_bank = gtk_hbox_new (FALSE, 8);
+    gtk_widget_show (hbox_filter_bank);
+    gtk_box_pack_start (GTK_BOX (vbox06), hbox_filter_bank, FALSE, FALSE, 0);
+
+    filter_bank_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (filter_bank_label),"Filter bank:");
+    gtk_widget_show (filter_bank_label);
+    gtk_box_pack_start (GTK_BOX (hbox_filter_bank), filter_bank_label, FALSE, TRUE, 0);
+
+    octave_fraction = gtk_combo_box_text_new ();
+    gtk_widget_show (octave_fraction);
+    gtk_box_pack_start (GTK_BOX (hbox_filter_bank), octave_fraction, TRUE, TRUE, 0);
+    for (int i = 0; i < (int)G_N_ELEMENTS (octave_fractions); i++) {
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(octave_fraction), octave_fractions[i]);
+    }
+
+    detector = gtk_combo_box_text_new ();
+    gtk_widget_show (detector);
+    gtk_box_pack_start (GTK_BOX (hbox_filter_bank), detector, TRUE, TRUE, 0);
+    for (int i = 0; i < (int)G_N_ELEMENTS (detector_names); i++) {
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(detector), detector_names[i]);
+    }
+
     hbox04 = gtk_hbox_new (FALSE, 8);
     gtk_widget_show (hbox04);
     gtk_box_pack_start (GTK_BOX (vbox06), hbox04, FALSE, FALSE, 0);
@@ -478,8 +675,65 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
     window = gtk_combo_box_text_new ();
     gtk_widget_show (window);
     gtk_box_pack_start (GTK_BOX (hbox04), window, TRUE, TRUE, 0);
-    gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(window), STR_WINDOW_BLACKMANN_HARRIS);
-    gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(window), STR_WINDOW_HANNING);
+    for (int i = 0; i < (int)G_N_ELEMENTS (window_names); i++) {
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(window), window_names[i]);
+    }
+
+    // beta of the Kaiser and sigma of the Gaussian window, 0 for the default
+    window_param = gtk_spin_button_new_with_range (0,20,0.1);
+    gtk_widget_show (window_param);
+    gtk_box_pack_start (GTK_BOX (hbox04), window_param, FALSE, TRUE, 0);
+
+    hbox_range = gtk_hbox_new (FALSE, 8);
+    gtk_widget_show (hbox_range);
+    gtk_box_pack_start (GTK_BOX (vbox06), hbox_range, FALSE, FALSE, 0);
+
+    range_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (range_label),"Frequency range (Hz):");
+    gtk_widget_show (range_label);
+    gtk_box_pack_start (GTK_BOX (hbox_range), range_label, FALSE, TRUE, 0);
+
+    min_freq = gtk_spin_button_new_with_range (1,96000,0.01);
+    gtk_widget_show (min_freq);
+    gtk_box_pack_start (GTK_BOX (hbox_range), min_freq, TRUE, TRUE, 0);
+
+    max_freq = gtk_spin_button_new_with_range (1,96000,0.01);
+    gtk_widget_show (max_freq);
+    gtk_box_pack_start (GTK_BOX (hbox_range), max_freq, TRUE, TRUE, 0);
+
+    hbox_channels = gtk_hbox_new (FALSE, 8);
+    gtk_widget_show (hbox_channels);
+    gtk_box_pack_start (GTK_BOX (vbox06), hbox_channels, FALSE, FALSE, 0);
+
+    channel_layout_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (channel_layout_label),"Channels:");
+    gtk_widget_show (channel_layout_label);
+    gtk_box_pack_start (GTK_BOX (hbox_channels), channel_layout_label, FALSE, TRUE, 0);
+
+    channel_layout = gtk_combo_box_text_new ();
+    gtk_widget_show (channel_layout);
+    gtk_box_pack_start (GTK_BOX (hbox_channels), channel_layout, TRUE, TRUE, 0);
+    gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(channel_layout), STR_CHANNELS_COMBINED);
+    gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(channel_layout), STR_CHANNELS_MIRRORED);
+    gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(channel_layout), STR_CHANNELS_STACKED);
+    gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(channel_layout), STR_CHANNELS_OVERLAID);
+
+    // channels shown by the stacked and overlaid layouts
+    num_channels = gtk_spin_button_new_with_range (1,DSP_MAX_CHANNELS,1);
+    gtk_widget_show (num_channels);
+    gtk_box_pack_start (GTK_BOX (hbox_channels), num_channels, FALSE, TRUE, 0);
+
+    downmix_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (downmix_label),"Downmix:");
+    gtk_widget_show (downmix_label);
+    gtk_box_pack_start (GTK_BOX (hbox_channels), downmix_label, FALSE, TRUE, 0);
+
+    downmix = gtk_combo_box_text_new ();
+    gtk_widget_show (downmix);
+    gtk_box_pack_start (GTK_BOX (hbox_channels), downmix, TRUE, TRUE, 0);
+    for (int i = 0; i < (int)G_N_ELEMENTS (downmix_modes); i++) {
+        gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT(downmix), downmix_modes[i]);
+    }
 
     style_label = gtk_label_new (NULL);
     gtk_label_set_markup (GTK_LABEL (style_label),"<b>Style</b>");
@@ -561,7 +815,7 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
     gtk_widget_show (num_bars_label);
     gtk_box_pack_start (GTK_BOX (hbox_num_bars), num_bars_label, FALSE, TRUE, 0);
 
-    num_bars = gtk_spin_button_new_with_range (2,2000,1);
+    num_bars = gtk_spin_button_new_with_range (2,16384,1);
     gtk_widget_show (num_bars);
     gtk_box_pack_start (GTK_BOX (hbox_num_bars), num_bars, TRUE, TRUE, 0);
 
@@ -631,6 +885,58 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
     gtk_widget_show (display_octaves);
     gtk_box_pack_start (GTK_BOX (vbox07), display_octaves, FALSE, FALSE, 0);
 
+    performance_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (performance_label),"<b>Performance</b>");
+    gtk_widget_show (performance_label);
+
+    performance_frame = gtk_frame_new ("Performance");
+    gtk_frame_set_label_widget ((GtkFrame *)performance_frame, performance_label);
+    gtk_frame_set_shadow_type ((GtkFrame *)performance_frame, GTK_SHADOW_IN);
+    gtk_widget_show (performance_frame);
+    gtk_box_pack_start (GTK_BOX (vbox02), performance_frame, TRUE, TRUE, 0);
+
+    vbox08 = gtk_vbox_new (FALSE, 8);
+    gtk_widget_show (vbox08);
+    gtk_container_add (GTK_CONTAINER (performance_frame), vbox08);
+    gtk_container_set_border_width (GTK_CONTAINER (vbox08), 12);
+
+    governor = gtk_check_button_new_with_label ("Reduce quality when over CPU budget");
+    gtk_widget_show (governor);
+    gtk_box_pack_start (GTK_BOX (vbox08), governor, FALSE, FALSE, 0);
+
+    hbox10 = gtk_hbox_new (FALSE, 8);
+    gtk_widget_show (hbox10);
+    gtk_box_pack_start (GTK_BOX (vbox08), hbox10, FALSE, FALSE, 0);
+
+    governor_budget_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (governor_budget_label),"CPU budget (%):");
+    gtk_widget_show (governor_budget_label);
+    gtk_box_pack_start (GTK_BOX (hbox10), governor_budget_label, FALSE, TRUE, 0);
+
+    governor_budget = gtk_spin_button_new_with_range (1,100,1);
+    gtk_widget_show (governor_budget);
+    gtk_box_pack_start (GTK_BOX (hbox10), governor_budget, TRUE, TRUE, 0);
+
+    governor_order_label = gtk_label_new (NULL);
+    gtk_label_set_markup (GTK_LABEL (governor_order_label),"Reduce in this order:");
+    gtk_widget_show (governor_order_label);
+    gtk_box_pack_start (GTK_BOX (vbox08), governor_order_label, FALSE, FALSE, 0);
+
+    for (int i = 0; i < NUM_KNOBS; i++) {
+        governor_order[i] = gtk_combo_box_text_new ();
+        gtk_widget_show (governor_order[i]);
+        gtk_box_pack_start (GTK_BOX (vbox08), governor_order[i], FALSE, FALSE, 0);
+        for (int j = 0; j < NUM_KNOBS; j++) {
+            gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (governor_order[i]), governor_knob_name (j));
+        }
+    }
+
+    governor_status = gtk_label_new (NULL);
+    gtk_widget_show (governor_status);
+    gtk_box_pack_start (GTK_BOX (vbox08), governor_status, FALSE, FALSE, 0);
+    update_governor_status (user_data);
+    guint governor_status_timer = g_timeout_add (500, update_governor_status, user_data);
+
     dialog_action_area13 = gtk_dialog_get_action_area (GTK_DIALOG (spectrum_properties));
     gtk_widget_show (dialog_action_area13);
     gtk_button_box_set_layout (GTK_BUTTON_BOX (dialog_action_area13), GTK_BUTTONBOX_END);
@@ -670,6 +976,27 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (fill_spectrum), CONFIG_FILL_SPECTRUM);
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (display_octaves), CONFIG_DISPLAY_OCTAVES);
     gtk_combo_box_set_active (GTK_COMBO_BOX (window), CONFIG_WINDOW);
+    gtk_combo_box_set_active (GTK_COMBO_BOX (engine), CONFIG_ENGINE);
+    gtk_combo_box_set_active (GTK_COMBO_BOX (resolutions), CLAMP (CONFIG_RESOLUTIONS, 1, DSP_MAX_RESOLUTIONS) - 1);
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (reassign), CONFIG_REASSIGN);
+    gtk_combo_box_set_active (GTK_COMBO_BOX (tapers), CLAMP (CONFIG_TAPERS, 1, DSP_MAX_TAPERS) - 1);
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (time_bandwidth), CONFIG_TIME_BANDWIDTH);
+    gtk_combo_box_set_active (GTK_COMBO_BOX (averaging), CONFIG_AVERAGING);
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (average_time), CONFIG_AVERAGE_TIME);
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (average_frames), CONFIG_AVERAGE_FRAMES);
+    // fractions not in the list select the next finer one, or the finest one
+    int fraction = G_N_ELEMENTS (octave_fraction_bands) - 1;
+    while (fraction > 0 && octave_fraction_bands[fraction-1] >= CONFIG_BANDS_PER_OCTAVE) {
+        fraction--;
+    }
+    gtk_combo_box_set_active (GTK_COMBO_BOX (octave_fraction), fraction);
+    gtk_combo_box_set_active (GTK_COMBO_BOX (detector), CONFIG_DETECTOR);
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (window_param), CONFIG_WINDOW_PARAM);
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (min_freq), CONFIG_MIN_FREQ);
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (max_freq), CONFIG_MAX_FREQ);
+    gtk_combo_box_set_active (GTK_COMBO_BOX (channel_layout), CONFIG_CHANNEL_LAYOUT);
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (num_channels), CONFIG_NUM_CHANNELS);
+    gtk_combo_box_set_active (GTK_COMBO_BOX (downmix), CONFIG_DOWNMIX);
     gtk_combo_box_set_active (GTK_COMBO_BOX (fft), FFT_INDEX);
     gtk_combo_box_set_active (GTK_COMBO_BOX (gradient_orientation), CONFIG_GRADIENT_ORIENTATION);
     gtk_combo_box_set_active (GTK_COMBO_BOX (alignment), CONFIG_ALIGNMENT);
@@ -679,11 +1006,18 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
     gtk_color_button_set_color (GTK_COLOR_BUTTON (color_vgrid), &CONFIG_COLOR_VGRID);
     gtk_color_button_set_color (GTK_COLOR_BUTTON (color_hgrid), &CONFIG_COLOR_HGRID);
     gtk_color_button_set_color (GTK_COLOR_BUTTON (color_ogrid), &CONFIG_COLOR_OCTAVE_GRID);
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (governor), CONFIG_GOVERNOR);
+    gtk_spin_button_set_value (GTK_SPIN_BUTTON (governor_budget), CONFIG_GOVERNOR_BUDGET);
+    for (int i = 0; i < NUM_KNOBS; i++) {
+        gtk_combo_box_set_active (GTK_COMBO_BOX (governor_order[i]), CONFIG_GOVERNOR_ORDER[i]);
+    }
 
     char text[100];
     for (;;) {
         int response = gtk_dialog_run (GTK_DIALOG (spectrum_properties));
         if (response == GTK_RESPONSE_OK || response == GTK_RESPONSE_APPLY) {
+            // load_config reads the globals under the same lock
+            deadbeef->conf_lock ();
             gtk_color_button_get_color (GTK_COLOR_BUTTON (color_bg), &CONFIG_COLOR_BG);
             gtk_color_button_get_color (GTK_COLOR_BUTTON (color_vgrid), &CONFIG_COLOR_VGRID);
             gtk_color_button_get_color (GTK_COLOR_BUTTON (color_hgrid), &CONFIG_COLOR_HGRID);
@@ -702,7 +1036,24 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
             CONFIG_DISPLAY_OCTAVES = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (display_octaves));
             CONFIG_DB_RANGE = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (db_range));
             CONFIG_NUM_COLORS = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (num_colors));
-
+            CONFIG_GOVERNOR = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (governor));
+            CONFIG_GOVERNOR_BUDGET = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (governor_budget));
+
+            // knobs picked twice keep their first position, the remaining ones are appended
+            int used[NUM_KNOBS] = {0};
+            int num_used = 0;
+            for (int i = 0; i < NUM_KNOBS; i++) {
+                const int knob = gtk_combo_box_get_active (GTK_COMBO_BOX (governor_order[i]));
+                if (knob >= 0 && knob < NUM_KNOBS && !used[knob]) {
+                    used[knob] = 1;
+                    CONFIG_GOVERNOR_ORDER[num_used++] = knob;
+                }
+            }
+            for (int knob = 0; knob < NUM_KNOBS; knob++) {
+                if (!used[knob]) {
+                    CONFIG_GOVERNOR_ORDER[num_used++] = knob;
+                }
+            }
             if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (draw_style_bars_radio)) == TRUE) {
                 CONFIG_DRAW_STYLE = 0;
             }
@@ -710,15 +1061,6 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
                 CONFIG_DRAW_STYLE = 1;
             }
 
-            for (int i = 0; i < MAX_NUM_COLORS && color_gradients[i]; i++) {
-                if (i < CONFIG_NUM_COLORS) {
-                    gtk_widget_show (color_gradients[i]);
-                }
-                else if (color_gradients[i]) {
-                    gtk_widget_hide (color_gradients[i]);
-                }
-            }
-
             snprintf (text, sizeof (text), "%s", gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (gradient_orientation)));
             if (strcmp (text, STR_GRADIENT_VERTICAL) == 0) {
                 CONFIG_GRADIENT_ORIENTATION = 0;
@@ -744,16 +1086,36 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
                 CONFIG_ALIGNMENT = -1;
             }
 
-            snprintf (text, sizeof (text), "%s", gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (window)));
-            if (strcmp (text, STR_WINDOW_BLACKMANN_HARRIS) == 0) {
-                CONFIG_WINDOW = BLACKMAN_HARRIS;
+            CONFIG_WINDOW = MAX (gtk_combo_box_get_active (GTK_COMBO_BOX (window)), BLACKMAN_HARRIS);
+            CONFIG_WINDOW_PARAM = gtk_spin_button_get_value (GTK_SPIN_BUTTON (window_param));
+            CONFIG_ENGINE = MAX (gtk_combo_box_get_active (GTK_COMBO_BOX (engine)), DSP_ENGINE_FFT);
+            CONFIG_RESOLUTIONS = MAX (gtk_combo_box_get_active (GTK_COMBO_BOX (resolutions)), 0) + 1;
+            CONFIG_REASSIGN = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (reassign));
+            CONFIG_TAPERS = MAX (gtk_combo_box_get_active (GTK_COMBO_BOX (tapers)), 0) + 1;
+            CONFIG_TIME_BANDWIDTH = gtk_spin_button_get_value (GTK_SPIN_BUTTON (time_bandwidth));
+            CONFIG_AVERAGING = MAX (gtk_combo_box_get_active (GTK_COMBO_BOX (averaging)), DSP_AVERAGING_NONE);
+            CONFIG_AVERAGE_TIME = gtk_spin_button_get_value (GTK_SPIN_BUTTON (average_time));
+            CONFIG_AVERAGE_FRAMES = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (average_frames));
+            CONFIG_BANDS_PER_OCTAVE = octave_fraction_bands[MAX (gtk_combo_box_get_active (GTK_COMBO_BOX (octave_fraction)), 0)];
+            CONFIG_DETECTOR = MAX (gtk_combo_box_get_active (GTK_COMBO_BOX (detector)), DSP_DETECTOR_RMS);
+            CONFIG_MIN_FREQ = gtk_spin_button_get_value (GTK_SPIN_BUTTON (min_freq));
+            CONFIG_MAX_FREQ = gtk_spin_button_get_value (GTK_SPIN_BUTTON (max_freq));
+
+            snprintf (text, sizeof (text), "%s", gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (channel_layout)));
+            if (strcmp (text, STR_CHANNELS_MIRRORED) == 0) {
+                CONFIG_CHANNEL_LAYOUT = CHANNELS_MIRRORED;
             }
-            else if (strcmp (text, STR_WINDOW_HANNING) == 0) {
-                CONFIG_WINDOW = HANNING;
+            else if (strcmp (text, STR_CHANNELS_STACKED) == 0) {
+                CONFIG_CHANNEL_LAYOUT = CHANNELS_STACKED;
+            }
+            else if (strcmp (text, STR_CHANNELS_OVERLAID) == 0) {
+                CONFIG_CHANNEL_LAYOUT = CHANNELS_OVERLAID;
             }
             else {
-                CONFIG_GRADIENT_ORIENTATION = -1;
+                CONFIG_CHANNEL_LAYOUT = CHANNELS_COMBINED;
             }
+            CONFIG_NUM_CHANNELS = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (num_channels));
+            CONFIG_DOWNMIX = MAX (gtk_combo_box_get_active (GTK_COMBO_BOX (downmix)), DSP_DOWNMIX_MID);
 
             snprintf (text, sizeof (text), "%s", gtk_combo_box_text_get_active_text (GTK_COMBO_BOX_TEXT (fft)));
             for (int i = 0; i < fft_sizses_size; i++) {
@@ -764,13 +1126,31 @@ on_button_config (GtkMenuItem *menuitem, gpointer user_data)
             }
 
             save_config ();
+            // copies for the dialog, its signal handlers run without the lock
+            int order[NUM_KNOBS];
+            memcpy (order, CONFIG_GOVERNOR_ORDER, sizeof (order));
+            const int num_colors = CONFIG_NUM_COLORS;
+            deadbeef->conf_unlock ();
             deadbeef->sendmessage (DB_EV_CONFIGCHANGED, 0, 0, 0);
+
+            for (int i = 0; i < NUM_KNOBS; i++) {
+                gtk_combo_box_set_active (GTK_COMBO_BOX (governor_order[i]), order[i]);
+            }
+            for (int i = 0; i < MAX_NUM_COLORS && color_gradients[i]; i++) {
+                if (i < num_colors) {
+                    gtk_widget_show (color_gradients[i]);
+                }
+                else if (color_gradients[i]) {
+                    gtk_widget_hide (color_gradients[i]);
+                }
+            }
         }
         if (response == GTK_RESPONSE_APPLY) {
             continue;
         }
         break;
     }
+    g_source_remove (governor_status_timer);
     gtk_widget_destroy (spectrum_properties);
 #pragma GCC diagnostic pop
     return;
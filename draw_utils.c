@@ -24,15 +24,42 @@
 
 #include <sys/types.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include <fcntl.h>
-#include <gtk/gtk.h>
+#include <cairo.h>
 
 #include "fastftoi.h"
 #include "draw_utils.h"
-#include "spectrum.h"
-#include "utils.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef CLAMP
+#define CLAMP(x,low,high) (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
+#endif
+
+// values match enum ALIGNMENT in config.h
+enum { ALIGN_LEFT = 0, ALIGN_RIGHT = 1, ALIGN_CENTER = 2 };
+
+void
+_memset_pattern (char *data, const void* pattern, size_t data_len, size_t pattern_len)
+{
+    memmove ((char *)data, pattern, pattern_len);
+    char *start = (char *)data;
+    char *current = (char *)data + pattern_len;
+    char *end = start + data_len;
+    while(current + pattern_len < end) {
+        memmove (current, start, pattern_len);
+        current += pattern_len;
+        pattern_len *= 2;
+    }
+    memmove (current, start, end-current);
+}
 
 void
 _draw_vline (uint8_t *data, int stride, int x0, int y0, int y1, uint32_t color) {
@@ -92,7 +119,7 @@ _draw_bar (uint8_t *data, int stride, int x0, int y0, int w, int h, uint32_t col
 }
 
 void
-_draw_bar_gradient_v (uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_h) {
+_draw_bar_gradient_v (const uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_h) {
     int y1 = y0+h-1;
     int x1 = x0+w-1;
     uint32_t *ptr = (uint32_t*)&data[y0*stride+x0*4];
@@ -109,7 +136,7 @@ _draw_bar_gradient_v (uint32_t *colors, uint8_t *data, int stride, int x0, int y
 }
 
 void
-_draw_bar_gradient_h (uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_w) {
+_draw_bar_gradient_h (const uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_w) {
     int y1 = y0+h-1;
     int x1 = x0+w-1;
     uint32_t *ptr = (uint32_t*)&data[y0*stride+x0*4];
@@ -126,7 +153,7 @@ _draw_bar_gradient_h (uint32_t *colors, uint8_t *data, int stride, int x0, int y
 }
 
 void
-_draw_bar_gradient_bar_mode_v (uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_h) {
+_draw_bar_gradient_bar_mode_v (const uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_h) {
     int y1 = y0+h-1;
     int x1 = x0+w-1;
     y0 -= y0 % 2;
@@ -144,7 +171,7 @@ _draw_bar_gradient_bar_mode_v (uint32_t *colors, uint8_t *data, int stride, int
 }
 
 void
-_draw_bar_gradient_bar_mode_h (uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_w) {
+_draw_bar_gradient_bar_mode_h (const uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_w) {
     int y1 = y0+h-1;
     int x1 = x0+w-1;
     y0 -= y0 % 2;
@@ -161,3 +188,290 @@ _draw_bar_gradient_bar_mode_h (uint32_t *colors, uint8_t *data, int stride, int
     }
 }
 
+int
+draw_get_align_pos (int alignment, int width, int bands, int bar_width)
+{
+    int left = 0;
+    switch (alignment) {
+        case ALIGN_LEFT:
+            left = 0;
+            break;
+        case ALIGN_RIGHT:
+            left = MIN (width, width - (bar_width * bands));
+            break;
+        case ALIGN_CENTER:
+            left = MAX (0, (width - (bar_width * bands))/2);
+            break;
+        default:
+            left = 0;
+            break;
+    }
+    return left;
+}
+
+int
+draw_get_bar_width (const draw_params_t *p)
+{
+    if (p->gaps || p->bar_w > 1)
+        return CLAMP (p->width / p->bands, 2, 20);
+    else
+        return CLAMP (p->width / p->bands, 2, 20) - 1;
+}
+
+// Returns whether band is a whole number of octaves away from the band under the mouse.
+static int
+_draw_same_note (const draw_params_t *p, int left, int barw, int band)
+{
+    const float octave_bars = p->bands / p->octaves;
+    const int hovered = floorf ((p->highlight_x - left) / barw);
+    return fabsf (remainderf (band - hovered, octave_bars)) < 0.5f;
+}
+
+void
+draw_static_content (uint8_t *data, int stride, const draw_params_t *p)
+{
+    if (!data) {
+        return;
+    }
+    const int width = p->width;
+    const int height = p->height;
+    const int bands = p->bands;
+
+    memset (data, 0, height * stride);
+
+    const int barw = draw_get_bar_width (p);
+    const int left = draw_get_align_pos (p->alignment, width, bands, barw);
+
+    //draw background
+    _draw_background (data, width, height, p->color_bg32);
+    // draw vertical grid
+    if (p->enable_vgrid && p->gaps) {
+        const int num_lines = MIN (width/barw, bands);
+        for (int i = 0; i < num_lines; i++) {
+            _draw_vline (data, stride, left + barw * i, 0, height-1, p->color_vgrid32);
+        }
+    }
+
+    // draw octave grid
+    if (p->enable_octave_grid) {
+        const int spectrum_width = MIN (barw * bands, width);
+        const float octave_width = CLAMP ((spectrum_width / p->octaves), 1, spectrum_width);
+        for (float i = left + p->octave_start * octave_width; i < spectrum_width - 1 && i < width - 1; i += octave_width) {
+            int x = ftoi (i) + (p->gaps ? (ftoi (i) % barw) : 0);
+            _draw_vline (data, stride, x, 0, height-1, p->color_octave_grid32);
+        }
+    }
+
+    const int hgrid_num = p->db_range/10;
+    // draw horizontal grid
+    if (p->enable_hgrid && height > 2*hgrid_num && width > 1) {
+        for (int i = 1; i < hgrid_num; i++) {
+            _draw_hline (data, stride, 0, ftoi (i/(float)hgrid_num * height), width-1, p->color_hgrid32);
+        }
+    }
+}
+
+void
+draw_bars (uint8_t *data, int stride, const float *bars, const float *peaks, const draw_params_t *p)
+{
+    const int width = p->width;
+    const int height = p->height;
+    const int bands = p->bands;
+    const float base_s = (height / (float)p->db_range);
+
+    const int barw = draw_get_bar_width (p);
+    const int left = draw_get_align_pos (p->alignment, width, bands, barw);
+
+    for (int i = 0; i < bands; i++)
+    {
+        int x = left + barw * i;
+        int octave_enabled = 0;
+        if (p->highlight_octaves) {
+            octave_enabled = _draw_same_note (p, left, barw, i);
+        }
+        int y = CLAMP (height - ftoi (bars[i] * base_s), 0, height);
+        int bw;
+
+        if (p->gaps) {
+            bw = barw -1;
+            x += 1;
+        }
+        else {
+            bw = barw;
+        }
+
+        if (x + bw >= width) {
+            bw = width-x-1;
+        }
+
+        if ((y >= 0 && y < height - 1) || octave_enabled) {
+            if (p->gradient_orientation == 0) {
+                if (p->bar_mode == 0) {
+                    _draw_bar_gradient_v (p->colors, data, stride, x, y, bw, height-y, height);
+                }
+                else {
+                    _draw_bar_gradient_bar_mode_v (p->colors, data, stride, x, y, bw, height-y, height);
+                }
+            }
+            else {
+                if (p->bar_mode == 0) {
+                    _draw_bar_gradient_h (p->colors, data, stride, x, y, bw, height-y, width);
+                }
+                else {
+                    _draw_bar_gradient_bar_mode_h (p->colors, data, stride, x, y, bw, height-y, width);
+                }
+            }
+            if (octave_enabled) {
+                _draw_bar (data, stride, x, y, bw, height - y, 0xFF0000);
+                _draw_bar (data, stride, x, 0, bw, y, 0x888888);
+            }
+        }
+        y = height - peaks[i] * base_s;
+        if (y > 0 && y < height-1) {
+            if (p->gradient_orientation == 0) {
+                _draw_bar_gradient_v (p->colors, data, stride, x, y, bw, 1, height);
+            }
+            else {
+                _draw_bar_gradient_h (p->colors, data, stride, x, y, bw, 1, width);
+            }
+            if (octave_enabled) {
+                _draw_bar (data, stride, x, y, bw, 1, 0xFF0000);
+            }
+        }
+    }
+}
+
+void
+draw_flip_rows (uint8_t *data, int stride, int rows)
+{
+    uint8_t tmp[256];
+    for (int top = 0, bottom = rows - 1; top < bottom; top++, bottom--) {
+        uint8_t *a = data + top * stride;
+        uint8_t *b = data + bottom * stride;
+        // swapped in chunks, rows can be wider than tmp
+        for (int x = 0; x < stride; x += sizeof (tmp)) {
+            const size_t n = MIN ((size_t)(stride - x), sizeof (tmp));
+            memcpy (tmp, a + x, n);
+            memcpy (a + x, b + x, n);
+            memcpy (b + x, tmp, n);
+        }
+    }
+}
+
+void
+draw_spectrum_cairo (cairo_t *cr, const float *bars, const draw_params_t *p)
+{
+    const int width = p->width;
+    const int height = p->height;
+    const int bands = p->bands;
+    const float base_s = (height / (float)p->db_range);
+    const int barw = CLAMP (width / bands, 2, 20) - 1;
+    const int left = draw_get_align_pos (p->alignment, width, bands, barw);
+
+    // draw background
+    if (!p->overlay) {
+        cairo_set_source_rgb (cr, p->color_bg.red, p->color_bg.green, p->color_bg.blue);
+        cairo_rectangle (cr, 0, 0, width, height);
+        cairo_fill (cr);
+    }
+
+    // create gradient
+    cairo_pattern_t *pat;
+    if (p->gradient_orientation == 0) {
+        pat = cairo_pattern_create_linear (0, 0, 0, height);
+    }
+    else {
+        pat = cairo_pattern_create_linear (0, 0, width, 0);
+    }
+
+    if (p->num_colors > 1) {
+        const float step = 1.0/(p->num_colors - 1);
+        float grad_pos = 0;
+        for (int i = 0; i < p->num_colors; i++) {
+            cairo_pattern_add_color_stop_rgb (pat, grad_pos, p->gradient_colors[i].red, p->gradient_colors[i].green, p->gradient_colors[i].blue);
+            grad_pos += step;
+        }
+        cairo_set_source (cr, pat);
+    }
+    else {
+        cairo_set_source_rgb (cr, p->gradient_colors[0].red, p->gradient_colors[0].green, p->gradient_colors[0].blue);
+    }
+
+    // draw spectrum
+    if (bars) {
+        if (p->overlay) {
+            cairo_push_group (cr);
+        }
+        cairo_set_line_width (cr, 1);
+        cairo_line_to (cr, 0, height);
+        float py = height - base_s * bars[0];
+        cairo_line_to (cr, 0, py);
+        for (int i = 0; i < bands; i++)
+        {
+            const float x = left + barw * i;
+            const float y = height - base_s * bars[i];
+
+            if (!p->fill_spectrum) {
+                cairo_move_to (cr, x - 0.5, py);
+            }
+            cairo_line_to (cr, x + 0.5, y);
+            py = y;
+        }
+        if (p->fill_spectrum) {
+            cairo_move_to (cr, left + barw * bands, 0);
+            cairo_line_to (cr, 0, height);
+
+            cairo_close_path (cr);
+            cairo_fill (cr);
+        }
+        else {
+            cairo_stroke (cr);
+        }
+        if (p->overlay) {
+            cairo_pop_group_to_source (cr);
+            cairo_paint_with_alpha (cr, 0.6);
+        }
+    }
+    cairo_pattern_destroy(pat);
+    if (p->overlay) {
+        // grids were drawn with the first channel
+        return;
+    }
+
+    // draw octave grid
+    if (p->enable_octave_grid) {
+        cairo_set_source_rgba (cr, p->color_octave_grid.red, p->color_octave_grid.green, p->color_octave_grid.blue, 0.2);
+        const int spectrum_width = MIN (barw * bands, width);
+        const float octave_width = CLAMP ((spectrum_width / p->octaves), 1, spectrum_width);
+        for (float i = left + p->octave_start * octave_width; i < spectrum_width - 1 && i < width - 1; i += octave_width) {
+            cairo_move_to (cr, i, 0);
+            cairo_line_to (cr, i, height);
+            cairo_stroke (cr);
+        }
+    }
+
+    // draw horizontal grid
+    const int hgrid_num = p->db_range/10;
+    if (p->enable_hgrid && height > 2*hgrid_num && width > 1) {
+        cairo_set_source_rgba (cr, p->color_hgrid.red, p->color_hgrid.green, p->color_hgrid.blue, 0.2);
+        for (int i = 1; i < hgrid_num; i++) {
+            cairo_move_to (cr, 0, i/(float)hgrid_num * height);
+            cairo_line_to (cr, width, i/(float)hgrid_num * height);
+            cairo_stroke (cr);
+        }
+    }
+
+    // draw octave grid on hover
+    if (p->highlight_octaves) {
+        cairo_set_source_rgba (cr, 1, 0, 0, 0.5);
+        for (int i = 0; i < bands; i++) {
+            const int octave_enabled = _draw_same_note (p, left, barw, i);
+            const float x = left + barw * i;
+            if (octave_enabled) {
+                cairo_move_to (cr, x, 0);
+                cairo_line_to (cr, x, height);
+                cairo_stroke (cr);
+            }
+        }
+    }
+}
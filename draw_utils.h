@@ -28,6 +28,55 @@
 #include <sys/types.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <cairo.h>
+
+#define GRADIENT_TABLE_SIZE 1024
+
+typedef struct {
+    double red;
+    double green;
+    double blue;
+} draw_color_t;
+
+// Everything the rasterizers need to draw one frame, filled from the config by the widget.
+typedef struct {
+    int width;
+    int height;
+    int bands;
+    int db_range;
+    int alignment;
+    int gaps;
+    int bar_w;
+    int bar_mode;
+    int gradient_orientation;
+    int fill_spectrum;
+    int enable_hgrid;
+    int enable_vgrid;
+    int enable_octave_grid;
+    // octaves: octaves spanned by the bands, octave_start: octaves from the left edge to the first C
+    float octaves;
+    float octave_start;
+    // colors of the pixel based bars style
+    const uint32_t *colors;
+    uint32_t color_bg32;
+    uint32_t color_vgrid32;
+    uint32_t color_hgrid32;
+    uint32_t color_octave_grid32;
+    // colors of the cairo based solid style
+    const draw_color_t *gradient_colors;
+    int num_colors;
+    draw_color_t color_bg;
+    draw_color_t color_hgrid;
+    draw_color_t color_octave_grid;
+    // highlight_octaves: mouse position highlights all bars of the same note
+    int highlight_octaves;
+    double highlight_x;
+    // overlay: cairo style only draws the spectrum, translucent on top of an earlier channel
+    int overlay;
+} draw_params_t;
+
+void
+_memset_pattern (char *data, const void* pattern, size_t data_len, size_t pattern_len);
 
 void
 _draw_vline (uint8_t *data, int stride, int x0, int y0, int y1, uint32_t color);
@@ -42,15 +91,35 @@ void
 _draw_bar (uint8_t *data, int stride, int x0, int y0, int w, int h, uint32_t color);
 
 void
-_draw_bar_gradient_v (uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_h);
+_draw_bar_gradient_v (const uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_h);
+
+void
+_draw_bar_gradient_h (const uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_w);
+
+void
+_draw_bar_gradient_bar_mode_v (const uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_h);
+
+void
+_draw_bar_gradient_bar_mode_h (const uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_w);
+
+int
+draw_get_align_pos (int alignment, int width, int bands, int bar_width);
+
+int
+draw_get_bar_width (const draw_params_t *p);
+
+void
+draw_static_content (uint8_t *data, int stride, const draw_params_t *p);
 
 void
-_draw_bar_gradient_h (uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_w);
+draw_bars (uint8_t *data, int stride, const float *bars, const float *peaks, const draw_params_t *p);
 
+// mirrors rows pixel rows upside down
 void
-_draw_bar_gradient_bar_mode_v (uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_h);
+draw_flip_rows (uint8_t *data, int stride, int rows);
 
+// bars may be NULL to draw only the background and grids
 void
-_draw_bar_gradient_bar_mode_h (uint32_t *colors, uint8_t *data, int stride, int x0, int y0, int w, int h, int total_w);
+draw_spectrum_cairo (cairo_t *cr, const float *bars, const draw_params_t *p);
 
 #endif
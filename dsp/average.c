@@ -0,0 +1,150 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+
+// Time averaged power spectra. Both modes update their state once per transform in time
+// linear in the spectrum size: the exponential average moves towards every new frame, the
+// Welch average keeps the last frames in a ring together with their running sum.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dsp.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+
+struct dsp_average_s {
+    int mode;
+    int size;
+    int frames;
+    // avg: exponential average, or the running sum of the ring with DSP_AVERAGING_WELCH
+    double *avg;
+    // ring: the last frames spectra of size entries with DSP_AVERAGING_WELCH, next: the slot
+    // of the oldest one, count: frames held so far, resum: first bin of the running sum
+    // summed anew on the next update
+    double *ring;
+    int next;
+    int count;
+    int resum;
+};
+
+dsp_average_t *
+dsp_average_new (int mode, int size, int frames)
+{
+    dsp_average_t *a = calloc (1, sizeof (dsp_average_t));
+    if (!a) {
+        return NULL;
+    }
+    a->mode = mode;
+    a->size = size;
+    a->frames = mode == DSP_AVERAGING_WELCH ? frames : 1;
+    a->avg = fftw_malloc (size * sizeof (double));
+    if (mode == DSP_AVERAGING_WELCH) {
+        a->ring = fftw_malloc ((size_t)size * frames * sizeof (double));
+    }
+    if (!a->avg || (mode == DSP_AVERAGING_WELCH && !a->ring)) {
+        dsp_average_free (a);
+        return NULL;
+    }
+    dsp_average_reset (a);
+    return a;
+}
+
+void
+dsp_average_free (dsp_average_t *a)
+{
+    if (!a) {
+        return;
+    }
+    if (a->avg) {
+        fftw_free (a->avg);
+    }
+    if (a->ring) {
+        fftw_free (a->ring);
+    }
+    free (a);
+}
+
+void
+dsp_average_reset (dsp_average_t *a)
+{
+    memset (a->avg, 0, a->size * sizeof (double));
+    a->next = 0;
+    a->count = 0;
+    a->resum = 0;
+}
+
+void
+dsp_average_update (dsp_average_t *a, double *spectrum, float alpha)
+{
+    const int size = a->size;
+    double *avg = a->avg;
+    if (a->mode == DSP_AVERAGING_EXPONENTIAL) {
+        // the first frame starts the average, no fade in from silence
+        if (a->count == 0) {
+            alpha = 1;
+            a->count = 1;
+        }
+        for (int i = 0; i < size; i++) {
+            avg[i] += alpha * (spectrum[i] - avg[i]);
+            spectrum[i] = avg[i];
+        }
+        return;
+    }
+    double *slot = a->ring + (size_t)a->next * size;
+    if (a->count < a->frames) {
+        a->count++;
+        for (int i = 0; i < size; i++) {
+            avg[i] += spectrum[i];
+            slot[i] = spectrum[i];
+        }
+    }
+    else {
+        for (int i = 0; i < size; i++) {
+            avg[i] += spectrum[i] - slot[i];
+            slot[i] = spectrum[i];
+        }
+    }
+    a->next = (a->next + 1) % a->frames;
+    // rounding errors of the running sum would pile up, a slice of frames bins each is
+    // summed anew per update, so every bin is rebuilt once per lap in one pass in total
+    const int end = MIN (a->resum + (size + a->frames - 1) / a->frames, size);
+    for (int i = a->resum; i < end; i++) {
+        double sum = 0;
+        for (int f = 0; f < a->count; f++) {
+            sum += a->ring[(size_t)f * size + i];
+        }
+        avg[i] = sum;
+    }
+    a->resum = end < size ? end : 0;
+    const double scale = 1.0 / a->count;
+    for (int i = 0; i < size; i++) {
+        // the sum of power can't be negative, rounding left aside
+        spectrum[i] = fmax (avg[i] * scale, 0);
+    }
+}
@@ -0,0 +1,1145 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+
+#include "dsp.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef CLAMP
+#define CLAMP(x,low,high) (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
+#endif
+
+// Shorter transform of multi-resolution analysis, buffers are laid out like those of the context.
+typedef struct {
+    int fft_size;
+    const dsp_window_t *window;
+    // samples: the newest fft_size samples of each channel in order, copied from the history
+    double *samples;
+    double *fft_in;
+    fftw_complex *fft_out;
+    fftw_plan plan;
+    double *spectrum;
+} dsp_level_t;
+
+struct dsp_context_s {
+    dsp_config_t config;
+    // buffers below are allocated with fftw_malloc for SIMD alignment and sized
+    // to config.fft_size, config.num_bars and config.channels, they only change with those.
+    // Channels follow each other, e.g. the bars of channel c start at bars + c*(num_bars+1).
+    // samples: history of each channel, a ring with the oldest sample at samples[pos]
+    double *samples;
+    // window: shared table of config.window and config.fft_size, from dsp_window_acquire
+    const dsp_window_t *window;
+    double *fft_in;
+    // fft_out: fft_size/2+1 bins per channel
+    fftw_complex *fft_out;
+    // plan: transforms all channels at once
+    fftw_plan plan;
+    // spectrum: power of each bin of the last transform, fft_size/2+1 entries per channel
+    // or fft_size with zoom, see dsp_context_spectrum_stride
+    double *spectrum;
+    // zoom: transform of config's range if config.zoom is set and the range can be zoomed,
+    // it replaces the real transform
+    dsp_zoom_t *zoom;
+    // sliding: bands of the table updated per sample with config.engine DSP_ENGINE_SLIDING_DFT,
+    // it replaces the transforms
+    dsp_sliding_t *sliding;
+    // filter_bank: with config.engine DSP_ENGINE_FILTER_BANK, it replaces the transforms
+    dsp_filter_bank_t *filter_bank;
+    // levels: transforms of fft_size/4, fft_size/16... points with config.resolutions above 1,
+    // run in parallel with the full one by the shared pool
+    dsp_level_t levels[DSP_MAX_RESOLUTIONS - 1];
+    int num_levels;
+    // deriv_*: transform with the derivative of the window for config.reassign, bin_freq: the
+    // reassigned frequency of each bin, laid out like spectrum
+    double *deriv_window;
+    double *deriv_in;
+    fftw_complex *deriv_out;
+    fftw_plan deriv_plan;
+    float *bin_freq;
+    // tapers: DPSS of config.tapers above 1, taper_in and taper_out hold the buffers of each
+    // taper, transformed with plan and taper_stride entries of taper_out apart. tapers is
+    // NULL with the buffers allocated until the set is cached, the window is used meanwhile
+    const dsp_tapers_t *tapers;
+    double *taper_in;
+    fftw_complex *taper_out;
+    int taper_stride;
+    // averages: of the spectrum and the spectra of the levels with config.averaging
+    dsp_average_t *averages[DSP_MAX_RESOLUTIONS];
+    int num_averages;
+    // fft_channels, bar_channels: channels the buffers are allocated for, they only differ
+    // from config.channels after a failed allocation
+    int fft_channels;
+    int bar_channels;
+    // pos: next write position in the sample rings, the same for all channels
+    int pos;
+    int buffered;
+    // fresh: samples received since the last transform
+    int fresh;
+    // table: frequencies and spectrum bins of the bands, shared with other contexts
+    const dsp_band_table_t *table;
+    // level_tables: band tables of the levels. Bands before level_end[0] are read from
+    // the full transform, those from level_end[r] to level_end[r+1] from level r.
+    const dsp_band_table_t *level_tables[DSP_MAX_RESOLUTIONS - 1];
+    int num_level_tables;
+    int level_end[DSP_MAX_RESOLUTIONS];
+    // values: band levels of the current frame, before falloff is applied
+    float *values;
+    float *bars;
+    float *peaks;
+    int *delay_bars;
+    int *delay_peaks;
+};
+
+void
+dsp_config_default (dsp_config_t *config)
+{
+    memset (config, 0, sizeof (dsp_config_t));
+    config->fft_size = 8192;
+    config->num_bars = 132;
+    config->samplerate = 44100;
+    config->min_freq = DSP_DEFAULT_MIN_FREQ;
+    config->max_freq = DSP_DEFAULT_MAX_FREQ;
+    config->window = DSP_WINDOW_BLACKMAN_HARRIS;
+    config->channels = 1;
+    config->downmix = DSP_DOWNMIX_MID;
+    config->hop = 0;
+    config->bands_per_octave = 3;
+    config->resolutions = 1;
+    config->tapers = 1;
+    config->time_bandwidth = DSP_DEFAULT_TIME_BANDWIDTH;
+    config->averaging = DSP_AVERAGING_NONE;
+    config->average_time = 1;
+    config->average_frames = 8;
+    config->amplitude_offset = 70;
+    config->db_range = 70;
+    config->animation.bar_falloff = -1;
+    config->animation.peak_falloff = 2.25;
+    config->animation.bar_delay = 0;
+    config->animation.peak_delay = 20;
+    config->animation.db_range = 70;
+}
+
+static void
+dsp_config_validate (dsp_config_t *config)
+{
+    config->fft_size = CLAMP (config->fft_size, DSP_MIN_FFT_SIZE, DSP_MAX_FFT_SIZE);
+    config->num_bars = MAX (config->num_bars, 1);
+    config->channels = CLAMP (config->channels, 1, DSP_MAX_CHANNELS);
+    config->downmix = CLAMP (config->downmix, DSP_DOWNMIX_MID, DSP_DOWNMIX_RMS);
+    config->window = CLAMP (config->window, 0, DSP_NUM_WINDOWS - 1);
+    config->window_param = MAX (config->window_param, 0);
+    config->engine = CLAMP (config->engine, 0, DSP_NUM_ENGINES - 1);
+    config->bands_per_octave = CLAMP (config->bands_per_octave, 1, DSP_MAX_BANDS_PER_OCTAVE);
+    config->detector = CLAMP (config->detector, DSP_DETECTOR_RMS, DSP_DETECTOR_PEAK);
+    config->resolutions = CLAMP (config->resolutions, 1, DSP_MAX_RESOLUTIONS);
+    config->reassign = config->reassign != 0;
+    config->time_bandwidth = CLAMP (config->time_bandwidth, 1, DSP_MAX_TIME_BANDWIDTH);
+    config->averaging = CLAMP (config->averaging, DSP_AVERAGING_NONE, DSP_NUM_AVERAGING_MODES - 1);
+    config->average_time = CLAMP (config->average_time, 0.01f, DSP_MAX_AVERAGE_TIME);
+    config->average_frames = CLAMP (config->average_frames, 2, DSP_MAX_AVERAGE_FRAMES);
+    // more tapers than 2NW-1 leak outside of the bandwidth
+    config->tapers = CLAMP (config->tapers, 1, MIN (DSP_MAX_TAPERS, MAX ((int)(2 * config->time_bandwidth) - 1, 1)));
+    if (config->samplerate <= 0) {
+        config->samplerate = 44100;
+    }
+    config->min_freq = MAX (config->min_freq, 1);
+    if (!(config->max_freq > config->min_freq)) {
+        config->max_freq = 2 * config->min_freq;
+    }
+    config->hop = CLAMP (config->hop, 0, config->fft_size);
+}
+
+static void
+dsp_free (void *buf)
+{
+    if (buf) {
+        fftw_free (buf);
+    }
+}
+
+// Returns a zeroed buffer of new_size elements holding the first (or with
+// keep_end the last) elements of old.
+static void *
+dsp_resize (const void *old, size_t size, int old_size, int new_size, int keep_end)
+{
+    char *buf = fftw_malloc (size * new_size);
+    if (!buf) {
+        return NULL;
+    }
+    memset (buf, 0, size * new_size);
+    if (old) {
+        const int n = MIN (old_size, new_size);
+        if (keep_end) {
+            memcpy (buf + (new_size - n) * size, (const char *)old + (old_size - n) * size, n * size);
+        }
+        else {
+            memcpy (buf, old, n * size);
+        }
+    }
+    return buf;
+}
+
+// Resizes the fft buffers, the newest samples of each channel are kept at the end
+// of its history. On failure the context is left unchanged.
+static int
+dsp_context_alloc_fft (dsp_context_t *ctx, int old_size, int old_channels, int fft_size, int channels)
+{
+    const int bins = fft_size/2 + 1;
+    double *samples = dsp_resize (NULL, sizeof (double), 0, fft_size * channels, 0);
+    double *fft_in = dsp_resize (NULL, sizeof (double), 0, fft_size * channels, 0);
+    fftw_complex *fft_out = dsp_resize (NULL, sizeof (fftw_complex), 0, bins * channels, 0);
+    // sized for the real transform, dsp_context_alloc_zoom grows it for the zoom transform
+    double *spectrum = dsp_resize (NULL, sizeof (double), 0, bins * channels, 0);
+    fftw_plan plan = NULL;
+    if (fft_in && fft_out) {
+        plan = dsp_fft_plan_many (fft_size, channels, fft_in, fft_out);
+    }
+    if (!samples || !fft_in || !fft_out || !spectrum || !plan) {
+        if (plan) {
+            fftw_destroy_plan (plan);
+        }
+        dsp_free (samples);
+        dsp_free (fft_in);
+        dsp_free (fft_out);
+        dsp_free (spectrum);
+        return -1;
+    }
+
+    if (ctx->samples) {
+        // the newest n samples of the old ring end up in order at the end of the new one
+        const int n = MIN (old_size, fft_size);
+        const int start = (ctx->pos - n + old_size) % old_size;
+        const int first = MIN (n, old_size - start);
+        for (int c = 0; c < MIN (old_channels, channels); c++) {
+            const double *old = ctx->samples + c * old_size;
+            double *dst = samples + c * fft_size + fft_size - n;
+            memcpy (dst, old + start, first * sizeof (double));
+            memcpy (dst + first, old, (n - first) * sizeof (double));
+        }
+    }
+    if (ctx->plan) {
+        fftw_destroy_plan (ctx->plan);
+    }
+    dsp_free (ctx->samples);
+    dsp_free (ctx->fft_in);
+    dsp_free (ctx->fft_out);
+    dsp_free (ctx->spectrum);
+    ctx->plan = plan;
+    ctx->samples = samples;
+    ctx->fft_in = fft_in;
+    ctx->fft_out = fft_out;
+    ctx->spectrum = spectrum;
+    ctx->fft_channels = channels;
+    ctx->pos = 0;
+    // a new channel has no history yet
+    ctx->buffered = channels > old_channels ? 0 : MIN (ctx->buffered, fft_size);
+    ctx->fresh = MIN (ctx->fresh, fft_size);
+    return 0;
+}
+
+// Returns 1 if config c analyses its range with the zoom transform.
+static int
+dsp_config_zooms (const dsp_config_t *c)
+{
+    return c->zoom && c->engine == DSP_ENGINE_FFT && dsp_zoom_decimation (c->samplerate, c->min_freq, c->max_freq, c->fft_size) >= 2;
+}
+
+// Number of multi-resolution levels of config c, the transforms besides the full one.
+static int
+dsp_config_levels (const dsp_config_t *c)
+{
+    if (c->engine != DSP_ENGINE_FFT || dsp_config_zooms (c)) {
+        return 0;
+    }
+    int n = 0;
+    while (n < c->resolutions - 1 && (c->fft_size >> (2 * (n + 1))) >= DSP_MIN_FFT_SIZE) {
+        n++;
+    }
+    return n;
+}
+
+// Rebuilds the zoom transform for config c and sizes the spectrum for it, the fft buffers
+// must have been allocated for it. Returns -1 if the transform can't be allocated.
+static int
+dsp_context_alloc_zoom (dsp_context_t *ctx, const dsp_config_t *c)
+{
+    dsp_zoom_free (ctx->zoom);
+    ctx->zoom = NULL;
+    const int zooms = dsp_config_zooms (c);
+    const int size = zooms ? c->fft_size : c->fft_size/2 + 1;
+    double *spectrum = dsp_resize (NULL, sizeof (double), 0, size * ctx->fft_channels, 0);
+    if (zooms && spectrum) {
+        ctx->zoom = dsp_zoom_new (c->samplerate, c->min_freq, c->max_freq, c->fft_size, ctx->fft_channels);
+    }
+    if (!spectrum || (zooms && !ctx->zoom)) {
+        // the spectrum from dsp_context_alloc_fft or a larger one still fits the real transform
+        dsp_free (spectrum);
+        return zooms ? -1 : 0;
+    }
+    dsp_free (ctx->spectrum);
+    ctx->spectrum = spectrum;
+    return 0;
+}
+
+// Rebuilds the sliding DFT for config c, the fft buffers must have been allocated for it.
+// Its bands don't follow num_bars, the bars are mapped onto them, so the cost per sample
+// stays bounded however wide the spectrum is drawn. Returns -1 if it can't be allocated.
+static int
+dsp_context_alloc_sliding (dsp_context_t *ctx, const dsp_config_t *c)
+{
+    dsp_sliding_free (ctx->sliding);
+    ctx->sliding = NULL;
+    if (c->engine != DSP_ENGINE_SLIDING_DFT) {
+        return 0;
+    }
+    ctx->sliding = dsp_sliding_new (c->samplerate, c->min_freq, c->max_freq, DSP_MAX_BANDS_PER_OCTAVE, c->fft_size, ctx->fft_channels);
+    return ctx->sliding ? 0 : -1;
+}
+
+// Rebuilds the filter bank for config c, the fft buffers must have been allocated for it.
+// Returns -1 if it can't be allocated.
+static int
+dsp_context_alloc_filter_bank (dsp_context_t *ctx, const dsp_config_t *c)
+{
+    dsp_filter_bank_free (ctx->filter_bank);
+    ctx->filter_bank = NULL;
+    if (c->engine != DSP_ENGINE_FILTER_BANK) {
+        return 0;
+    }
+    ctx->filter_bank = dsp_filter_bank_new (c->samplerate, c->min_freq, c->max_freq, c->bands_per_octave, ctx->fft_channels);
+    return ctx->filter_bank ? 0 : -1;
+}
+
+static void
+dsp_level_free (dsp_level_t *level)
+{
+    if (level->plan) {
+        fftw_destroy_plan (level->plan);
+    }
+    dsp_window_release (level->window);
+    dsp_free (level->samples);
+    dsp_free (level->fft_in);
+    dsp_free (level->fft_out);
+    dsp_free (level->spectrum);
+    memset (level, 0, sizeof (dsp_level_t));
+}
+
+static void
+dsp_context_free_levels (dsp_context_t *ctx)
+{
+    for (int r = 0; r < ctx->num_levels; r++) {
+        dsp_level_free (&ctx->levels[r]);
+    }
+    if (ctx->num_levels > 0) {
+        dsp_pool_release ();
+    }
+    ctx->num_levels = 0;
+}
+
+// Rebuilds the multi-resolution levels for config c. Returns -1 if they can't be
+// allocated, the context then has none.
+static int
+dsp_context_alloc_levels (dsp_context_t *ctx, const dsp_config_t *c)
+{
+    dsp_context_free_levels (ctx);
+    const int n = dsp_config_levels (c);
+    dsp_level_t levels[DSP_MAX_RESOLUTIONS - 1];
+    memset (levels, 0, sizeof (levels));
+    for (int r = 0; r < n; r++) {
+        dsp_level_t *level = &levels[r];
+        const int size = c->fft_size >> (2 * (r + 1));
+        const int channels = ctx->fft_channels;
+        level->fft_size = size;
+        level->window = dsp_window_acquire (c->window, c->window_param, size);
+        level->samples = dsp_resize (NULL, sizeof (double), 0, size * channels, 0);
+        level->fft_in = dsp_resize (NULL, sizeof (double), 0, size * channels, 0);
+        level->fft_out = dsp_resize (NULL, sizeof (fftw_complex), 0, (size/2 + 1) * channels, 0);
+        level->spectrum = dsp_resize (NULL, sizeof (double), 0, size * channels, 0);
+        if (level->fft_in && level->fft_out) {
+            level->plan = dsp_fft_plan_many (size, channels, level->fft_in, level->fft_out);
+        }
+        if (!level->window || !level->samples || !level->fft_in || !level->fft_out || !level->spectrum || !level->plan) {
+            for (int i = 0; i <= r; i++) {
+                dsp_level_free (&levels[i]);
+            }
+            return -1;
+        }
+    }
+    memcpy (ctx->levels, levels, sizeof (levels));
+    ctx->num_levels = n;
+    if (n > 0) {
+        dsp_pool_acquire ();
+    }
+    return 0;
+}
+
+static void
+dsp_context_free_reassign (dsp_context_t *ctx)
+{
+    if (ctx->deriv_plan) {
+        fftw_destroy_plan (ctx->deriv_plan);
+    }
+    dsp_free (ctx->deriv_window);
+    dsp_free (ctx->deriv_in);
+    dsp_free (ctx->deriv_out);
+    dsp_free (ctx->bin_freq);
+    ctx->deriv_plan = NULL;
+    ctx->deriv_window = NULL;
+    ctx->deriv_in = NULL;
+    ctx->deriv_out = NULL;
+    ctx->bin_freq = NULL;
+}
+
+// Rebuilds the derivative transform for config c after the window and fft buffers, returns
+// -1 if it can't be allocated, the context then doesn't reassign.
+static int
+dsp_context_alloc_reassign (dsp_context_t *ctx, const dsp_config_t *c)
+{
+    dsp_context_free_reassign (ctx);
+    if (!c->reassign || c->tapers > 1 || c->engine != DSP_ENGINE_FFT || dsp_config_zooms (c)) {
+        return 0;
+    }
+    const int size = c->fft_size;
+    const int bins = size/2 + 1;
+    const int channels = ctx->fft_channels;
+    ctx->deriv_window = dsp_resize (NULL, sizeof (double), 0, size, 0);
+    ctx->deriv_in = dsp_resize (NULL, sizeof (double), 0, size * channels, 0);
+    ctx->deriv_out = dsp_resize (NULL, sizeof (fftw_complex), 0, bins * channels, 0);
+    ctx->bin_freq = dsp_resize (NULL, sizeof (float), 0, bins * channels, 0);
+    if (ctx->deriv_in && ctx->deriv_out) {
+        ctx->deriv_plan = dsp_fft_plan_many (size, channels, ctx->deriv_in, ctx->deriv_out);
+    }
+    if (!ctx->deriv_window || !ctx->bin_freq || !ctx->deriv_plan) {
+        dsp_context_free_reassign (ctx);
+        return -1;
+    }
+    dsp_window_derivative (ctx->window->table, ctx->deriv_window, size);
+    return 0;
+}
+
+static void
+dsp_context_free_tapers (dsp_context_t *ctx)
+{
+    dsp_tapers_release (ctx->tapers);
+    dsp_free (ctx->taper_in);
+    dsp_free (ctx->taper_out);
+    ctx->tapers = NULL;
+    ctx->taper_in = NULL;
+    ctx->taper_out = NULL;
+}
+
+// Rebuilds the taper buffers for config c after the fft buffers, returns -1 if they can't
+// be allocated, the context then uses the window. The tapers are only looked up, they take
+// up to a second to generate and this runs under the locks of the caller.
+static int
+dsp_context_alloc_tapers (dsp_context_t *ctx, const dsp_config_t *c)
+{
+    dsp_context_free_tapers (ctx);
+    if (c->tapers < 2 || c->engine != DSP_ENGINE_FFT || dsp_config_zooms (c)) {
+        return 0;
+    }
+    const int size = c->fft_size;
+    const int channels = ctx->fft_channels;
+    // transforms of all tapers share the plan, an even stride keeps them aligned like fft_out
+    ctx->taper_stride = ((size/2 + 1) * channels + 1) & ~1;
+    ctx->taper_in = dsp_resize (NULL, sizeof (double), 0, size * channels * c->tapers, 0);
+    ctx->taper_out = dsp_resize (NULL, sizeof (fftw_complex), 0, ctx->taper_stride * c->tapers, 0);
+    if (!ctx->taper_in || !ctx->taper_out) {
+        dsp_context_free_tapers (ctx);
+        return -1;
+    }
+    ctx->tapers = dsp_tapers_lookup (size, c->tapers, c->time_bandwidth);
+    return 0;
+}
+
+int
+dsp_context_tapers_missing (const dsp_context_t *ctx)
+{
+    return ctx->taper_in && !ctx->tapers;
+}
+
+static void
+dsp_context_free_averages (dsp_context_t *ctx)
+{
+    for (int i = 0; i < ctx->num_averages; i++) {
+        dsp_average_free (ctx->averages[i]);
+        ctx->averages[i] = NULL;
+    }
+    ctx->num_averages = 0;
+}
+
+// Rebuilds the averages for config c after the zoom transform and the levels, returns -1
+// if they can't be allocated, the context then shows every transform on its own.
+static int
+dsp_context_alloc_averages (dsp_context_t *ctx, const dsp_config_t *c)
+{
+    dsp_context_free_averages (ctx);
+    if (c->averaging == DSP_AVERAGING_NONE || c->engine != DSP_ENGINE_FFT) {
+        return 0;
+    }
+    const int channels = ctx->fft_channels;
+    for (int i = 0; i <= ctx->num_levels; i++) {
+        // the zoom transform keeps all its bins, see dsp_context_spectrum_stride
+        const int stride = i ? ctx->levels[i-1].fft_size/2 + 1 : ctx->zoom ? c->fft_size : c->fft_size/2 + 1;
+        ctx->averages[i] = dsp_average_new (c->averaging, stride * channels, c->average_frames);
+        if (!ctx->averages[i]) {
+            dsp_context_free_averages (ctx);
+            return -1;
+        }
+        ctx->num_averages = i + 1;
+    }
+    return 0;
+}
+
+static void
+dsp_context_release_level_tables (dsp_context_t *ctx)
+{
+    for (int r = 0; r < ctx->num_level_tables; r++) {
+        dsp_band_table_release (ctx->level_tables[r]);
+    }
+    ctx->num_level_tables = 0;
+}
+
+// Acquires the band tables of the multi-resolution levels of config c and picks the
+// level of each band, the band table of c must be in place. Returns -1 if the tables
+// can't be allocated, all bands are then read from the full transform.
+static int
+dsp_context_acquire_level_tables (dsp_context_t *ctx, const dsp_config_t *c)
+{
+    dsp_context_release_level_tables (ctx);
+    const int n = ctx->table ? dsp_config_levels (c) : 0;
+    for (int r = 0; r < n; r++) {
+        ctx->level_tables[r] = dsp_band_table_acquire (c->samplerate, c->fft_size >> (2 * (r + 1)), c->num_bars, c->min_freq, c->max_freq, 0);
+        if (!ctx->level_tables[r]) {
+            dsp_context_release_level_tables (ctx);
+            return -1;
+        }
+        ctx->num_level_tables = r + 1;
+    }
+    // the band distance grows with the frequency, so the levels are runs of bands
+    const float *freq = ctx->table ? ctx->table->freq : NULL;
+    const int bars = c->num_bars;
+    int level = 0;
+    for (int i = 0; i < bars && level < n; i++) {
+        const float spacing = i + 1 < bars ? freq[i+1] - freq[i] : i > 0 ? freq[i] - freq[i-1] : freq[i];
+        while (level < n && c->samplerate / (float)(c->fft_size >> (2 * (level + 1))) <= spacing) {
+            ctx->level_end[level++] = i;
+        }
+    }
+    while (level <= n) {
+        ctx->level_end[level++] = bars;
+    }
+    return 0;
+}
+
+// Entries per channel in the spectrum.
+static int
+dsp_context_spectrum_stride (const dsp_context_t *ctx)
+{
+    return ctx->zoom ? ctx->config.fft_size : ctx->config.fft_size/2 + 1;
+}
+
+// Resizes the band buffers, one extra entry per channel is kept for the interpolation
+// look-ahead. Bars are only kept if the channel count stays the same. On failure the
+// context is left unchanged.
+static int
+dsp_context_alloc_bars (dsp_context_t *ctx, int old_bars, int old_channels, int num_bars, int channels)
+{
+    const int old_size = old_bars > 0 && old_channels == channels ? (old_bars + 1) * channels : 0;
+    const int size = (num_bars + 1) * channels;
+    float *values = dsp_resize (ctx->values, sizeof (float), old_size, size, 0);
+    float *bars = dsp_resize (ctx->bars, sizeof (float), old_size, size, 0);
+    float *peaks = dsp_resize (ctx->peaks, sizeof (float), old_size, size, 0);
+    int *delay_bars = dsp_resize (ctx->delay_bars, sizeof (int), old_size, size, 0);
+    int *delay_peaks = dsp_resize (ctx->delay_peaks, sizeof (int), old_size, size, 0);
+    const int ok = values && bars && peaks && delay_bars && delay_peaks;
+    if (ok) {
+        dsp_free (ctx->values);
+        dsp_free (ctx->bars);
+        dsp_free (ctx->peaks);
+        dsp_free (ctx->delay_bars);
+        dsp_free (ctx->delay_peaks);
+        ctx->values = values;
+        ctx->bars = bars;
+        ctx->peaks = peaks;
+        ctx->delay_bars = delay_bars;
+        ctx->delay_peaks = delay_peaks;
+        ctx->bar_channels = channels;
+        return 0;
+    }
+    dsp_free (values);
+    dsp_free (bars);
+    dsp_free (peaks);
+    dsp_free (delay_bars);
+    dsp_free (delay_peaks);
+    return -1;
+}
+
+dsp_context_t *
+dsp_context_new (const dsp_config_t *config)
+{
+    dsp_context_t *ctx = calloc (1, sizeof (dsp_context_t));
+    if (!ctx) {
+        return NULL;
+    }
+    ctx->config = *config;
+    dsp_config_validate (&ctx->config);
+    ctx->table = dsp_band_table_acquire (ctx->config.samplerate, ctx->config.fft_size, ctx->config.num_bars, ctx->config.min_freq, ctx->config.max_freq, ctx->config.zoom);
+    if (!ctx->table || dsp_context_alloc_bars (ctx, 0, 0, ctx->config.num_bars, ctx->config.channels)) {
+        dsp_context_free (ctx);
+        return NULL;
+    }
+    if (dsp_context_acquire_level_tables (ctx, &ctx->config)) {
+        ctx->config.resolutions = 1;
+    }
+    return ctx;
+}
+
+int
+dsp_context_prepare (dsp_context_t *ctx)
+{
+    if (ctx->plan) {
+        return 0;
+    }
+    ctx->window = dsp_window_acquire (ctx->config.window, ctx->config.window_param, ctx->config.fft_size);
+    if (!ctx->window || dsp_context_alloc_fft (ctx, 0, 0, ctx->config.fft_size, ctx->config.channels)) {
+        dsp_window_release (ctx->window);
+        ctx->window = NULL;
+        return -1;
+    }
+    if (dsp_context_alloc_zoom (ctx, &ctx->config)) {
+        return -1;
+    }
+    if (dsp_context_alloc_sliding (ctx, &ctx->config) || dsp_context_alloc_filter_bank (ctx, &ctx->config)) {
+        return -1;
+    }
+    if (dsp_context_alloc_levels (ctx, &ctx->config) || dsp_context_alloc_tapers (ctx, &ctx->config)) {
+        return -1;
+    }
+    if (dsp_context_alloc_reassign (ctx, &ctx->config)) {
+        return -1;
+    }
+    return dsp_context_alloc_averages (ctx, &ctx->config);
+}
+
+void
+dsp_context_free (dsp_context_t *ctx)
+{
+    if (!ctx) {
+        return;
+    }
+    if (ctx->plan) {
+        fftw_destroy_plan (ctx->plan);
+    }
+    dsp_free (ctx->samples);
+    dsp_window_release (ctx->window);
+    dsp_free (ctx->fft_in);
+    dsp_free (ctx->fft_out);
+    dsp_free (ctx->spectrum);
+    dsp_zoom_free (ctx->zoom);
+    dsp_sliding_free (ctx->sliding);
+    dsp_filter_bank_free (ctx->filter_bank);
+    dsp_context_free_levels (ctx);
+    dsp_context_free_reassign (ctx);
+    dsp_context_free_tapers (ctx);
+    dsp_context_free_averages (ctx);
+    dsp_context_release_level_tables (ctx);
+    dsp_band_table_release (ctx->table);
+    dsp_free (ctx->values);
+    dsp_free (ctx->bars);
+    dsp_free (ctx->peaks);
+    dsp_free (ctx->delay_bars);
+    dsp_free (ctx->delay_peaks);
+    free (ctx);
+}
+
+int
+dsp_context_configure (dsp_context_t *ctx, const dsp_config_t *config)
+{
+    dsp_config_t c = *config;
+    dsp_config_validate (&c);
+
+    int ret = 0;
+    // fft buffers and window of a context that isn't prepared come with dsp_context_prepare,
+    // a size that can't be allocated stays at its previous value
+    const int prepared = ctx->plan != NULL;
+    const int old_fft_channels = ctx->fft_channels;
+    if (prepared) {
+        const dsp_window_t *window = ctx->window;
+        if (c.fft_size != ctx->config.fft_size || c.window != ctx->config.window || c.window_param != ctx->config.window_param) {
+            window = dsp_window_acquire (c.window, c.window_param, c.fft_size);
+        }
+        // the window always has the size of the fft buffers
+        int keep_fft_size = !window;
+        if (window && (c.fft_size != ctx->config.fft_size || c.channels != ctx->fft_channels)
+                && dsp_context_alloc_fft (ctx, ctx->config.fft_size, ctx->fft_channels, c.fft_size, c.channels)) {
+            keep_fft_size = c.fft_size != ctx->config.fft_size;
+            ret = -1;
+        }
+        if (keep_fft_size) {
+            if (window != ctx->window) {
+                dsp_window_release (window);
+            }
+            window = ctx->window;
+            c.fft_size = ctx->config.fft_size;
+            c.window = ctx->config.window;
+            c.window_param = ctx->config.window_param;
+            c.hop = MIN (c.hop, c.fft_size);
+            ret = -1;
+        }
+        if (window != ctx->window) {
+            dsp_window_release (ctx->window);
+            ctx->window = window;
+        }
+        const dsp_config_t *o = &ctx->config;
+        if ((c.zoom != o->zoom || c.engine != o->engine || c.samplerate != o->samplerate || c.min_freq != o->min_freq || c.max_freq != o->max_freq
+                    || c.fft_size != o->fft_size || ctx->fft_channels != old_fft_channels)
+                && dsp_context_alloc_zoom (ctx, &c)) {
+            // falls back to the real transform
+            c.zoom = 0;
+            ret = -1;
+        }
+        if ((c.resolutions != o->resolutions || c.engine != o->engine || c.zoom != o->zoom || c.samplerate != o->samplerate
+                    || c.min_freq != o->min_freq || c.max_freq != o->max_freq || c.fft_size != o->fft_size || c.window != o->window
+                    || c.window_param != o->window_param || ctx->fft_channels != old_fft_channels)
+                && dsp_context_alloc_levels (ctx, &c)) {
+            c.resolutions = 1;
+            ret = -1;
+        }
+        if ((c.tapers != o->tapers || c.time_bandwidth != o->time_bandwidth || c.engine != o->engine || c.zoom != o->zoom
+                    || c.samplerate != o->samplerate || c.min_freq != o->min_freq || c.max_freq != o->max_freq || c.fft_size != o->fft_size
+                    || ctx->fft_channels != old_fft_channels)
+                && dsp_context_alloc_tapers (ctx, &c)) {
+            c.tapers = 1;
+            ret = -1;
+        }
+        if ((c.reassign != o->reassign || c.tapers != o->tapers || c.engine != o->engine || c.zoom != o->zoom || c.samplerate != o->samplerate
+                    || c.min_freq != o->min_freq || c.max_freq != o->max_freq || c.fft_size != o->fft_size || c.window != o->window
+                    || c.window_param != o->window_param || ctx->fft_channels != old_fft_channels)
+                && dsp_context_alloc_reassign (ctx, &c)) {
+            c.reassign = 0;
+            ret = -1;
+        }
+        if ((c.averaging != o->averaging || c.average_frames != o->average_frames || c.resolutions != o->resolutions
+                    || c.engine != o->engine || c.zoom != o->zoom || c.samplerate != o->samplerate || c.min_freq != o->min_freq
+                    || c.max_freq != o->max_freq || c.fft_size != o->fft_size || ctx->fft_channels != old_fft_channels)
+                && dsp_context_alloc_averages (ctx, &c)) {
+            c.averaging = DSP_AVERAGING_NONE;
+            ret = -1;
+        }
+    }
+    if ((c.num_bars != ctx->config.num_bars || c.channels != ctx->bar_channels)
+            && dsp_context_alloc_bars (ctx, ctx->config.num_bars, ctx->bar_channels, c.num_bars, c.channels)) {
+        c.num_bars = ctx->config.num_bars;
+        ret = -1;
+    }
+    // channels that couldn't be allocated are left out, see fft_channels and bar_channels
+    if (ctx->bar_channels != c.channels || (prepared && ctx->fft_channels != c.channels)) {
+        c.channels = ctx->bar_channels;
+        ret = -1;
+    }
+    const int fft_changed = c.fft_size != ctx->config.fft_size;
+    const int bars_changed = c.num_bars != ctx->config.num_bars;
+    const int range_changed = c.min_freq != ctx->config.min_freq || c.max_freq != ctx->config.max_freq || c.zoom != ctx->config.zoom;
+    const int table_changed = fft_changed || bars_changed || range_changed || c.samplerate != ctx->config.samplerate;
+    if (table_changed) {
+        // without a table no bands are mapped until a later configure succeeds
+        dsp_band_table_release (ctx->table);
+        ctx->table = dsp_band_table_acquire (c.samplerate, c.fft_size, c.num_bars, c.min_freq, c.max_freq, c.zoom);
+        if (!ctx->table) {
+            ret = -1;
+        }
+    }
+    if ((table_changed || c.resolutions != ctx->config.resolutions || c.engine != ctx->config.engine)
+            && dsp_context_acquire_level_tables (ctx, &c)) {
+        c.resolutions = 1;
+        ret = -1;
+    }
+    if (prepared && (fft_changed || range_changed || c.samplerate != ctx->config.samplerate
+                || c.engine != ctx->config.engine || ctx->fft_channels != old_fft_channels)
+            && dsp_context_alloc_sliding (ctx, &c)) {
+        // falls back to the transforms
+        c.engine = DSP_ENGINE_FFT;
+        ret = -1;
+    }
+    if (prepared && (c.engine != ctx->config.engine || range_changed || c.samplerate != ctx->config.samplerate
+                || c.bands_per_octave != ctx->config.bands_per_octave || ctx->fft_channels != old_fft_channels)
+            && dsp_context_alloc_filter_bank (ctx, &c)) {
+        c.engine = DSP_ENGINE_FFT;
+        ret = -1;
+    }
+    ctx->config = c;
+    return ret;
+}
+
+const dsp_config_t *
+dsp_context_get_config (const dsp_context_t *ctx)
+{
+    return &ctx->config;
+}
+
+// Adds sz frames, at most fft_size.
+static void
+dsp_context_feed_block (dsp_context_t *ctx, const float *data, int sz, int channels)
+{
+    const int fft_size = ctx->config.fft_size;
+    // written in at most two parts, up to the end of the ring and from its start
+    const int first = MIN (sz, fft_size - ctx->pos);
+    for (int c = 0; c < ctx->fft_channels; c++) {
+        double *samples = ctx->samples + c * fft_size;
+        if (ctx->fft_channels == 1) {
+            dsp_downmix (data, first, channels, ctx->config.downmix, samples + ctx->pos);
+            dsp_downmix (data + first * channels, sz - first, channels, ctx->config.downmix, samples);
+        }
+        else {
+            // channels missing in the input repeat the last one
+            const int channel = MIN (c, channels - 1);
+            dsp_deinterleave (data, first, channels, channel, samples + ctx->pos);
+            dsp_deinterleave (data + first * channels, sz - first, channels, channel, samples);
+        }
+        if (ctx->zoom) {
+            dsp_zoom_feed (ctx->zoom, c, samples + ctx->pos, first);
+            dsp_zoom_feed (ctx->zoom, c, samples, sz - first);
+        }
+        if (ctx->sliding) {
+            dsp_sliding_feed (ctx->sliding, c, samples + ctx->pos, first);
+            dsp_sliding_feed (ctx->sliding, c, samples, sz - first);
+        }
+        if (ctx->filter_bank) {
+            dsp_filter_bank_feed (ctx->filter_bank, c, samples + ctx->pos, first);
+            dsp_filter_bank_feed (ctx->filter_bank, c, samples, sz - first);
+        }
+    }
+    ctx->pos = (ctx->pos + sz) % fft_size;
+    if (ctx->buffered < fft_size) {
+        ctx->buffered += sz;
+    }
+    ctx->fresh = MIN (ctx->fresh + sz, fft_size);
+}
+
+void
+dsp_context_feed (dsp_context_t *ctx, const float *data, int nframes, int channels)
+{
+    if (!ctx->samples || channels < 1) {
+        return;
+    }
+    const int fft_size = ctx->config.fft_size;
+    // only the newest fft_size frames fit into the history, the zoom filter, the sliding
+    // DFT and the filter bank need all of them
+    if (!ctx->zoom && !ctx->sliding && !ctx->filter_bank && nframes > fft_size) {
+        data += (nframes - fft_size) * channels;
+        nframes = fft_size;
+    }
+    while (nframes > 0) {
+        const int sz = MIN (fft_size, nframes);
+        dsp_context_feed_block (ctx, data, sz, channels);
+        data += sz * channels;
+        nframes -= sz;
+    }
+}
+
+void
+dsp_context_reset (dsp_context_t *ctx)
+{
+    if (ctx->samples) {
+        memset (ctx->samples, 0, ctx->config.fft_size * ctx->fft_channels * sizeof (double));
+    }
+    if (ctx->zoom) {
+        dsp_zoom_reset (ctx->zoom);
+    }
+    if (ctx->sliding) {
+        dsp_sliding_reset (ctx->sliding);
+    }
+    if (ctx->filter_bank) {
+        dsp_filter_bank_reset (ctx->filter_bank);
+    }
+    for (int i = 0; i < ctx->num_averages; i++) {
+        dsp_average_reset (ctx->averages[i]);
+    }
+    ctx->pos = 0;
+    ctx->buffered = 0;
+    ctx->fresh = 0;
+}
+
+// The bins of a size point transform that config c computes, bands of any bar count within
+// the range read no other bins, see dsp_band_table_t.
+static void
+dsp_config_bin_range (const dsp_config_t *c, int size, int *first_bin, int *last_bin)
+{
+    const float bin_width = c->samplerate / (float)size;
+    *first_bin = floorf (c->min_freq / bin_width);
+    *last_bin = MIN (ceilf (c->max_freq / bin_width), size/2);
+}
+
+// Jobs of the full transform, one per taper with several tapers.
+static int
+dsp_context_full_jobs (const dsp_context_t *ctx)
+{
+    return ctx->tapers ? ctx->tapers->count : 1;
+}
+
+// Job of dsp_context_fft: the first dsp_context_full_jobs indices run the full transform,
+// the following ones the levels.
+static void
+dsp_context_transform (void *arg, int index)
+{
+    dsp_context_t *ctx = arg;
+    const int fft_size = ctx->config.fft_size;
+    const int channels = ctx->fft_channels;
+    const int full_jobs = dsp_context_full_jobs (ctx);
+    if (ctx->tapers && index < full_jobs) {
+        // the taper average follows once all are done
+        double *in = ctx->taper_in + index * fft_size * channels;
+        dsp_apply_window (ctx->samples, ctx->pos, ctx->tapers->table + index * fft_size, in, fft_size, channels);
+        fftw_execute_dft_r2c (ctx->plan, in, ctx->taper_out + index * ctx->taper_stride);
+        return;
+    }
+    index -= full_jobs - 1;
+    const int size = index ? ctx->levels[index-1].fft_size : fft_size;
+    int first_bin, last_bin;
+    dsp_config_bin_range (&ctx->config, size, &first_bin, &last_bin);
+    if (index == 0 && ctx->bin_freq) {
+        dsp_fft_reassign (ctx->samples, ctx->pos, ctx->window->table, ctx->deriv_window, ctx->fft_in, ctx->fft_out, ctx->plan,
+                ctx->deriv_in, ctx->deriv_out, ctx->deriv_plan, ctx->spectrum, ctx->bin_freq, fft_size, ctx->fft_channels,
+                ctx->config.samplerate, first_bin, last_bin);
+        return;
+    }
+    if (index == 0) {
+        dsp_fft_range (ctx->samples, ctx->pos, ctx->window->table, ctx->fft_in, ctx->fft_out, ctx->plan, ctx->spectrum, fft_size, ctx->fft_channels, first_bin, last_bin);
+        return;
+    }
+    dsp_level_t *level = &ctx->levels[index-1];
+    // the newest samples of the history, which wraps at pos
+    const int start = (ctx->pos - size + fft_size) % fft_size;
+    const int first = MIN (size, fft_size - start);
+    for (int ch = 0; ch < ctx->fft_channels; ch++) {
+        const double *history = ctx->samples + ch * fft_size;
+        memcpy (level->samples + ch * size, history + start, first * sizeof (double));
+        memcpy (level->samples + ch * size + first, history, (size - first) * sizeof (double));
+    }
+    dsp_fft_range (level->samples, 0, level->window->table, level->fft_in, level->fft_out, level->plan, level->spectrum, size, ctx->fft_channels, first_bin, last_bin);
+}
+
+int
+dsp_context_fft (dsp_context_t *ctx)
+{
+    // the zoom history spans too long to wait for, it starts out silent like the sliding
+    // DFT and the filter bank
+    const int filled = ctx->zoom || ctx->sliding || ctx->filter_bank || ctx->buffered >= ctx->config.fft_size;
+    if (!ctx->plan || !filled || ctx->fresh < ctx->config.hop) {
+        return 0;
+    }
+    const int elapsed = ctx->fresh;
+    ctx->fresh = 0;
+    if (ctx->sliding) {
+        dsp_sliding_update (ctx->sliding);
+        return 1;
+    }
+    if (ctx->filter_bank) {
+        dsp_filter_bank_update (ctx->filter_bank, ctx->config.detector);
+        return 1;
+    }
+    if (ctx->zoom) {
+        dsp_zoom_transform (ctx->zoom, ctx->window->table, ctx->spectrum);
+    }
+    else {
+        if (dsp_context_tapers_missing (ctx)) {
+            ctx->tapers = dsp_tapers_lookup (ctx->config.fft_size, ctx->config.tapers, ctx->config.time_bandwidth);
+        }
+        dsp_pool_run (dsp_context_transform, ctx, dsp_context_full_jobs (ctx) + ctx->num_levels);
+    }
+    if (ctx->tapers) {
+        int first_bin, last_bin;
+        dsp_config_bin_range (&ctx->config, ctx->config.fft_size, &first_bin, &last_bin);
+        dsp_taper_average (ctx->taper_out, ctx->taper_stride, ctx->tapers->count, ctx->spectrum, ctx->config.fft_size, ctx->fft_channels,
+                first_bin, last_bin);
+    }
+    if (ctx->num_averages > 0) {
+        // transforms are hop samples apart or more if the caller is late
+        const float alpha = 1 - expf (-elapsed / (ctx->config.average_time * ctx->config.samplerate));
+        dsp_average_update (ctx->averages[0], ctx->spectrum, alpha);
+        for (int r = 1; r < ctx->num_averages; r++) {
+            dsp_average_update (ctx->averages[r], ctx->levels[r-1].spectrum, alpha);
+        }
+    }
+    return 1;
+}
+
+void
+dsp_context_map_bands (dsp_context_t *ctx)
+{
+    dsp_context_map_bands_from (ctx, ctx);
+}
+
+void
+dsp_context_map_bands_from (dsp_context_t *ctx, const dsp_context_t *source)
+{
+    if (!source->spectrum || !source->window || !ctx->table) {
+        return;
+    }
+    const int size = ctx->config.num_bars + 1;
+    if (source->sliding) {
+        // every bar shows the loudest band within [freq[i], freq[i+1]) or the nearest one if
+        // it is narrower than a band, bars beyond the bands stay at 0
+        const float *freq = ctx->table->freq;
+        const int num_bars = ctx->config.num_bars;
+        const int bands = dsp_sliding_bands (source->sliding);
+        for (int c = 0; c < ctx->bar_channels; c++) {
+            const double *power = dsp_sliding_power (source->sliding, MIN (c, source->fft_channels - 1));
+            float *values = ctx->values + c * size;
+            for (int i = 0; i < num_bars; i++) {
+                const float high = i + 1 < num_bars ? freq[i+1] : ctx->table->max_freq;
+                if (dsp_sliding_band (source->sliding, sqrtf (freq[i] * high)) < 0) {
+                    values[i] = 0;
+                    continue;
+                }
+                // the edges can only be beyond the bands on the outer side
+                int first = dsp_sliding_band (source->sliding, freq[i]);
+                int last = dsp_sliding_band (source->sliding, high);
+                first = first >= 0 ? first : 0;
+                last = last >= 0 ? last : bands;
+                // the band at the upper edge belongs to the next bar
+                last = MAX (last - 1, first);
+                double p = power[first];
+                for (int b = first + 1; b <= last; b++) {
+                    p = MAX (p, power[b]);
+                }
+                const float x = 10 * log10f (p) + ctx->config.amplitude_offset;
+                values[i] = CLAMP (x, 0, ctx->config.db_range);
+            }
+        }
+        return;
+    }
+    if (source->filter_bank) {
+        // every bar shows the filter band it falls into, bars beyond the bands stay at 0
+        const float *freq = ctx->table->freq;
+        for (int c = 0; c < ctx->bar_channels; c++) {
+            const double *power = dsp_filter_bank_power (source->filter_bank, MIN (c, source->fft_channels - 1));
+            float *values = ctx->values + c * size;
+            for (int i = 0; i < ctx->config.num_bars; i++) {
+                const int band = dsp_filter_bank_band (source->filter_bank, freq[i]);
+                const float x = band >= 0 ? 10 * log10f (power[band]) + ctx->config.amplitude_offset : 0;
+                values[i] = CLAMP (x, 0, ctx->config.db_range);
+            }
+        }
+        return;
+    }
+    const int bins = dsp_context_spectrum_stride (source);
+    // keys of the zoom grid don't fit a real transform, as when the source couldn't zoom
+    if (ctx->table->keys[ctx->config.num_bars] >= bins) {
+        return;
+    }
+    // the levels are calibrated for the window or tapers of the transform
+    const float offset = ctx->config.amplitude_offset + (source->tapers ? source->tapers->correction : source->window->correction);
+    const int levels = MIN (source->num_levels, ctx->num_level_tables);
+    const int full_end = levels > 0 ? ctx->level_end[0] : ctx->config.num_bars;
+    // reassignment replaces the interpolation of the bands sharing bins, see dsp_interpolate
+    const int reassigned = source->bin_freq && ctx->table->low_res_end > 0 && !ctx->table->zoom ? MIN (ctx->table->low_res_end + 2, full_end) : 0;
+    int first_bin = 0, last_bin = 0;
+    if (reassigned > 0) {
+        dsp_config_bin_range (&source->config, source->config.fft_size, &first_bin, &last_bin);
+        first_bin = MAX (first_bin, 0);
+        last_bin = MIN (last_bin, MIN (ctx->table->keys[reassigned] + 2, source->config.fft_size/2 - 1));
+    }
+    for (int c = 0; c < ctx->bar_channels; c++) {
+        // a source with fewer channels repeats its last one
+        const int ch = MIN (c, source->fft_channels - 1);
+        float *values = ctx->values + c * size;
+        dsp_map_bands (source->spectrum + ch * bins, ctx->table->keys, ctx->table->low_res_end, full_end, offset, ctx->config.db_range, values);
+        if (reassigned > 0) {
+            dsp_map_reassigned (source->spectrum + ch * bins, source->bin_freq + ch * bins, first_bin, last_bin, ctx->table->freq, reassigned,
+                    offset, ctx->config.db_range, values);
+        }
+        for (int r = 0; r < levels; r++) {
+            const dsp_level_t *level = &source->levels[r];
+            const dsp_band_table_t *table = ctx->level_tables[r];
+            const int start = ctx->level_end[r];
+            const double *spectrum = level->spectrum + ch * (level->fft_size/2 + 1);
+            dsp_map_bands (spectrum, table->keys + start, table->low_res_end - start, ctx->level_end[r+1] - start,
+                    ctx->config.amplitude_offset + level->window->correction, ctx->config.db_range, values + start);
+        }
+    }
+}
+
+void
+dsp_context_animate (dsp_context_t *ctx)
+{
+    const int size = ctx->config.num_bars + 1;
+    for (int c = 0; c < ctx->bar_channels; c++) {
+        const int o = c * size;
+        dsp_animate (ctx->values + o, ctx->bars + o, ctx->peaks + o, ctx->delay_bars + o, ctx->delay_peaks + o, ctx->config.num_bars, &ctx->config.animation);
+    }
+}
+
+void
+dsp_context_clear_bars (dsp_context_t *ctx)
+{
+    const int size = (ctx->config.num_bars + 1) * ctx->bar_channels;
+    memset (ctx->bars, 0, size * sizeof (float));
+    memset (ctx->peaks, 0, size * sizeof (float));
+    memset (ctx->delay_bars, 0, size * sizeof (int));
+    memset (ctx->delay_peaks, 0, size * sizeof (int));
+}
+
+const float *
+dsp_context_get_bars (const dsp_context_t *ctx)
+{
+    return ctx->bars;
+}
+
+const float *
+dsp_context_get_peaks (const dsp_context_t *ctx)
+{
+    return ctx->peaks;
+}
+
+const float *
+dsp_context_get_channel_bars (const dsp_context_t *ctx, int channel)
+{
+    channel = CLAMP (channel, 0, ctx->bar_channels - 1);
+    return ctx->bars + channel * (ctx->config.num_bars + 1);
+}
+
+const float *
+dsp_context_get_channel_peaks (const dsp_context_t *ctx, int channel)
+{
+    channel = CLAMP (channel, 0, ctx->bar_channels - 1);
+    return ctx->peaks + channel * (ctx->config.num_bars + 1);
+}
+
+const float *
+dsp_context_get_frequencies (const dsp_context_t *ctx)
+{
+    return ctx->table ? ctx->table->freq : NULL;
+}
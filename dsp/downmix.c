@@ -0,0 +1,350 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+// Downmix and deinterleave kernels of the audio tap. They convert interleaved float
+// frames into the double sample history, with SSE2 versions of the mono and stereo
+// cases, which are nearly all of the audio played.
+
+#include <math.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dsp.h"
+
+// Callers pass channels as a constant, so the channel loops are unrolled for each count.
+static inline void
+dsp_downmix_generic (const float *data, int nframes, const int channels, int mode, double *out)
+{
+    const float scale = 1.0f / channels;
+    const int right = channels > 1 ? 1 : 0;
+    switch (mode) {
+    case DSP_DOWNMIX_SIDE:
+        if (channels == 1) {
+            memset (out, 0, nframes * sizeof (double));
+            break;
+        }
+        for (int i = 0; i < nframes; i++, data += channels) {
+            out[i] = 0.5f * (data[0] - data[1]);
+        }
+        break;
+    case DSP_DOWNMIX_LEFT:
+        for (int i = 0; i < nframes; i++, data += channels) {
+            out[i] = data[0];
+        }
+        break;
+    case DSP_DOWNMIX_RIGHT:
+        for (int i = 0; i < nframes; i++, data += channels) {
+            out[i] = data[right];
+        }
+        break;
+    case DSP_DOWNMIX_MAX_ABS:
+        for (int i = 0; i < nframes; i++, data += channels) {
+            float v = data[0];
+            for (int c = 1; c < channels; c++) {
+                if (fabsf (data[c]) > fabsf (v)) {
+                    v = data[c];
+                }
+            }
+            out[i] = v;
+        }
+        break;
+    case DSP_DOWNMIX_RMS:
+        for (int i = 0; i < nframes; i++, data += channels) {
+            float sum = 0;
+            float squares = 0;
+            for (int c = 0; c < channels; c++) {
+                sum += data[c];
+                squares += data[c] * data[c];
+            }
+            const float rms = sqrtf (squares * scale);
+            out[i] = sum < 0 ? -rms : rms;
+        }
+        break;
+    default:
+        for (int i = 0; i < nframes; i++, data += channels) {
+            float sum = 0;
+            for (int c = 0; c < channels; c++) {
+                sum += data[c];
+            }
+            out[i] = sum * scale;
+        }
+        break;
+    }
+}
+
+#ifdef __SSE2__
+// splits four stereo frames into their left and right samples
+static inline void
+dsp_split_stereo (const float *data, __m128 *l, __m128 *r)
+{
+    const __m128 a = _mm_loadu_ps (data);
+    const __m128 b = _mm_loadu_ps (data + 4);
+    *l = _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0));
+    *r = _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1));
+}
+
+static inline void
+dsp_store_pd (double *out, __m128 v)
+{
+    _mm_storeu_pd (out, _mm_cvtps_pd (v));
+    _mm_storeu_pd (out + 2, _mm_cvtps_pd (_mm_movehl_ps (v, v)));
+}
+
+static void
+dsp_convert_sse2 (const float *data, int nframes, double *out)
+{
+    const int n = nframes & ~3;
+    for (int i = 0; i < n; i += 4) {
+        dsp_store_pd (out + i, _mm_loadu_ps (data + i));
+    }
+    for (int i = n; i < nframes; i++) {
+        out[i] = data[i];
+    }
+}
+
+static void
+dsp_downmix_stereo_sse2 (const float *data, int nframes, int mode, double *out)
+{
+    const __m128 half = _mm_set1_ps (0.5f);
+    // sign: only the sign bit set, for abs and copysign
+    const __m128 sign = _mm_set1_ps (-0.0f);
+    const int n = nframes & ~3;
+    __m128 l, r;
+    switch (mode) {
+    case DSP_DOWNMIX_SIDE:
+        for (int i = 0; i < n; i += 4) {
+            dsp_split_stereo (data + 2*i, &l, &r);
+            dsp_store_pd (out + i, _mm_mul_ps (_mm_sub_ps (l, r), half));
+        }
+        break;
+    case DSP_DOWNMIX_LEFT:
+        for (int i = 0; i < n; i += 4) {
+            dsp_split_stereo (data + 2*i, &l, &r);
+            dsp_store_pd (out + i, l);
+        }
+        break;
+    case DSP_DOWNMIX_RIGHT:
+        for (int i = 0; i < n; i += 4) {
+            dsp_split_stereo (data + 2*i, &l, &r);
+            dsp_store_pd (out + i, r);
+        }
+        break;
+    case DSP_DOWNMIX_MAX_ABS:
+        for (int i = 0; i < n; i += 4) {
+            dsp_split_stereo (data + 2*i, &l, &r);
+            // ties go to the left channel like in the generic kernel
+            const __m128 left = _mm_cmpge_ps (_mm_andnot_ps (sign, l), _mm_andnot_ps (sign, r));
+            dsp_store_pd (out + i, _mm_or_ps (_mm_and_ps (left, l), _mm_andnot_ps (left, r)));
+        }
+        break;
+    case DSP_DOWNMIX_RMS:
+        for (int i = 0; i < n; i += 4) {
+            dsp_split_stereo (data + 2*i, &l, &r);
+            const __m128 squares = _mm_add_ps (_mm_mul_ps (l, l), _mm_mul_ps (r, r));
+            const __m128 rms = _mm_sqrt_ps (_mm_mul_ps (squares, half));
+            dsp_store_pd (out + i, _mm_or_ps (rms, _mm_and_ps (sign, _mm_add_ps (l, r))));
+        }
+        break;
+    default:
+        for (int i = 0; i < n; i += 4) {
+            dsp_split_stereo (data + 2*i, &l, &r);
+            dsp_store_pd (out + i, _mm_mul_ps (_mm_add_ps (l, r), half));
+        }
+        break;
+    }
+    dsp_downmix_generic (data + 2*n, nframes - n, 2, mode, out + n);
+}
+
+// Loads the channels of one frame of 3 to 8 channels, channels 0-3 into a and 4-7 into b,
+// missing channels are zero.
+static inline void
+dsp_load_frame (const float *data, const int channels, __m128 *a, __m128 *b)
+{
+    switch (channels) {
+    case 3:
+        *a = _mm_set_ps (0, data[2], data[1], data[0]);
+        *b = _mm_setzero_ps ();
+        break;
+    case 4:
+        *a = _mm_loadu_ps (data);
+        *b = _mm_setzero_ps ();
+        break;
+    case 5:
+        *a = _mm_loadu_ps (data);
+        *b = _mm_load_ss (data + 4);
+        break;
+    case 6:
+        *a = _mm_loadu_ps (data);
+        *b = _mm_loadl_pi (_mm_setzero_ps (), (const __m64 *)(data + 4));
+        break;
+    case 7:
+        *a = _mm_loadu_ps (data);
+        *b = _mm_set_ps (0, data[6], data[5], data[4]);
+        break;
+    default:
+        *a = _mm_loadu_ps (data);
+        *b = _mm_loadu_ps (data + 4);
+        break;
+    }
+}
+
+// the sample of a or b with the larger magnitude, a on ties
+static inline __m128
+dsp_louder (__m128 a, __m128 b)
+{
+    const __m128 sign = _mm_set1_ps (-0.0f);
+    const __m128 louder = _mm_cmpgt_ps (_mm_andnot_ps (sign, b), _mm_andnot_ps (sign, a));
+    return _mm_or_ps (_mm_and_ps (louder, b), _mm_andnot_ps (louder, a));
+}
+
+// Mid, max-abs and rms of 3 to 8 channels. Every frame is folded into four lanes,
+// four frames are transposed so the lanes can be combined vertically. The other
+// modes only read one or two channels, they are left to the generic kernel.
+static inline void
+dsp_downmix_sse2 (const float *data, int nframes, const int channels, int mode, double *out)
+{
+    if (mode != DSP_DOWNMIX_MID && mode != DSP_DOWNMIX_MAX_ABS && mode != DSP_DOWNMIX_RMS) {
+        dsp_downmix_generic (data, nframes, channels, mode, out);
+        return;
+    }
+    const __m128 scale = _mm_set1_ps (1.0f / channels);
+    const __m128 sign = _mm_set1_ps (-0.0f);
+    const int n = nframes & ~3;
+    for (int i = 0; i < n; i += 4, data += 4 * channels) {
+        __m128 a0, a1, a2, a3, b0, b1, b2, b3;
+        dsp_load_frame (data, channels, &a0, &b0);
+        dsp_load_frame (data + channels, channels, &a1, &b1);
+        dsp_load_frame (data + 2 * channels, channels, &a2, &b2);
+        dsp_load_frame (data + 3 * channels, channels, &a3, &b3);
+        __m128 v;
+        if (mode == DSP_DOWNMIX_MAX_ABS) {
+            a0 = dsp_louder (a0, b0);
+            a1 = dsp_louder (a1, b1);
+            a2 = dsp_louder (a2, b2);
+            a3 = dsp_louder (a3, b3);
+            _MM_TRANSPOSE4_PS (a0, a1, a2, a3);
+            v = dsp_louder (dsp_louder (dsp_louder (a0, a1), a2), a3);
+        }
+        else {
+            __m128 s0 = _mm_add_ps (a0, b0);
+            __m128 s1 = _mm_add_ps (a1, b1);
+            __m128 s2 = _mm_add_ps (a2, b2);
+            __m128 s3 = _mm_add_ps (a3, b3);
+            _MM_TRANSPOSE4_PS (s0, s1, s2, s3);
+            const __m128 sum = _mm_add_ps (_mm_add_ps (s0, s1), _mm_add_ps (s2, s3));
+            if (mode == DSP_DOWNMIX_MID) {
+                v = _mm_mul_ps (sum, scale);
+            }
+            else {
+                __m128 q0 = _mm_add_ps (_mm_mul_ps (a0, a0), _mm_mul_ps (b0, b0));
+                __m128 q1 = _mm_add_ps (_mm_mul_ps (a1, a1), _mm_mul_ps (b1, b1));
+                __m128 q2 = _mm_add_ps (_mm_mul_ps (a2, a2), _mm_mul_ps (b2, b2));
+                __m128 q3 = _mm_add_ps (_mm_mul_ps (a3, a3), _mm_mul_ps (b3, b3));
+                _MM_TRANSPOSE4_PS (q0, q1, q2, q3);
+                const __m128 squares = _mm_add_ps (_mm_add_ps (q0, q1), _mm_add_ps (q2, q3));
+                v = _mm_or_ps (_mm_sqrt_ps (_mm_mul_ps (squares, scale)), _mm_and_ps (sign, sum));
+            }
+        }
+        dsp_store_pd (out + i, v);
+    }
+    dsp_downmix_generic (data, nframes - n, channels, mode, out + n);
+}
+#endif
+
+void
+dsp_downmix (const float *data, int nframes, int channels, int mode, double *out)
+{
+    if (channels < 1) {
+        memset (out, 0, nframes * sizeof (double));
+        return;
+    }
+    switch (channels) {
+    case 1:
+#ifdef __SSE2__
+        if (mode != DSP_DOWNMIX_SIDE) {
+            // every other mode of a single channel is the channel itself
+            dsp_convert_sse2 (data, nframes, out);
+            break;
+        }
+#endif
+        dsp_downmix_generic (data, nframes, 1, mode, out);
+        break;
+    case 2:
+#ifdef __SSE2__
+        dsp_downmix_stereo_sse2 (data, nframes, mode, out);
+#else
+        dsp_downmix_generic (data, nframes, 2, mode, out);
+#endif
+        break;
+#ifdef __SSE2__
+    case 3: dsp_downmix_sse2 (data, nframes, 3, mode, out); break;
+    case 4: dsp_downmix_sse2 (data, nframes, 4, mode, out); break;
+    case 5: dsp_downmix_sse2 (data, nframes, 5, mode, out); break;
+    case 6: dsp_downmix_sse2 (data, nframes, 6, mode, out); break;
+    case 7: dsp_downmix_sse2 (data, nframes, 7, mode, out); break;
+    case 8: dsp_downmix_sse2 (data, nframes, 8, mode, out); break;
+#else
+    case 3: dsp_downmix_generic (data, nframes, 3, mode, out); break;
+    case 4: dsp_downmix_generic (data, nframes, 4, mode, out); break;
+    case 5: dsp_downmix_generic (data, nframes, 5, mode, out); break;
+    case 6: dsp_downmix_generic (data, nframes, 6, mode, out); break;
+    case 7: dsp_downmix_generic (data, nframes, 7, mode, out); break;
+    case 8: dsp_downmix_generic (data, nframes, 8, mode, out); break;
+#endif
+    default:
+        // more channels than supported are mixed from the first DSP_MAX_CHANNELS
+        for (int i = 0; i < nframes; i++) {
+            dsp_downmix_generic (data + i * channels, 1, DSP_MAX_CHANNELS, mode, out + i);
+        }
+        break;
+    }
+}
+
+void
+dsp_deinterleave (const float *data, int nframes, int channels, int channel, double *out)
+{
+#ifdef __SSE2__
+    if (channels == 1) {
+        dsp_convert_sse2 (data, nframes, out);
+        return;
+    }
+    if (channels == 2) {
+        const int n = nframes & ~3;
+        __m128 l, r;
+        for (int i = 0; i < n; i += 4) {
+            dsp_split_stereo (data + 2*i, &l, &r);
+            dsp_store_pd (out + i, channel ? r : l);
+        }
+        data += 2*n;
+        out += n;
+        nframes -= n;
+    }
+#endif
+    for (int i = 0; i < nframes; i++) {
+        out[i] = data[i * channels + channel];
+    }
+}
@@ -0,0 +1,342 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fftw3.h>
+
+#include "../fastftoi.h"
+#include "dsp.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef CLAMP
+#define CLAMP(x,low,high) (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
+#endif
+
+fftw_plan
+dsp_fft_plan (int fft_size, double *in, fftw_complex *out)
+{
+    return dsp_fft_plan_many (fft_size, 1, in, out);
+}
+
+// Sets the threads of the next plan.
+static void
+dsp_fft_plan_threads (int fft_size)
+{
+#ifdef DSP_FFTW_THREADS
+    // 0: not initialized yet, afterwards the number of threads for large transforms
+    static int threads = 0;
+    if (!threads) {
+        threads = 1;
+        if (fftw_init_threads ()) {
+            threads = CLAMP ((int)sysconf (_SC_NPROCESSORS_ONLN), 1, DSP_MAX_FFT_THREADS);
+        }
+    }
+    fftw_plan_with_nthreads (fft_size >= DSP_THREADED_FFT_SIZE ? threads : 1);
+#endif
+}
+
+fftw_plan
+dsp_fft_plan_many (int fft_size, int howmany, double *in, fftw_complex *out)
+{
+    dsp_fft_plan_threads (fft_size);
+    if (howmany == 1) {
+        return fftw_plan_dft_r2c_1d (fft_size, in, out, FFTW_ESTIMATE);
+    }
+    // one plan for all channels, FFTW interleaves their passes for better cache use
+    const int bins = fft_size/2 + 1;
+    return fftw_plan_many_dft_r2c (1, &fft_size, howmany, in, NULL, 1, fft_size, out, NULL, 1, bins, FFTW_ESTIMATE);
+}
+
+fftw_plan
+dsp_fft_plan_complex_many (int fft_size, int howmany, fftw_complex *in, fftw_complex *out)
+{
+    dsp_fft_plan_threads (fft_size);
+    return fftw_plan_many_dft (1, &fft_size, howmany, in, NULL, 1, fft_size, out, NULL, 1, fft_size, FFTW_FORWARD, FFTW_ESTIMATE);
+}
+
+// Fills freq with the center frequency of each band and keys with the matching
+// FFT bin. Returns the last band that shares its bin with its predecessor.
+// Bands above the nyquist frequency point at bin fft_size/2, keys[num_bars] repeats the last key.
+int
+dsp_frequency_table (float *freq, int *keys, int num_bars, int fft_size, int samplerate)
+{
+    dsp_note_frequencies (freq, num_bars);
+    return dsp_bin_table (freq, keys, num_bars, fft_size, samplerate);
+}
+
+void
+dsp_note_frequencies (float *freq, int num_bars)
+{
+    dsp_band_frequencies (freq, num_bars, DSP_DEFAULT_MIN_FREQ, DSP_DEFAULT_MAX_FREQ);
+}
+
+void
+dsp_band_frequencies (float *freq, int num_bars, float min_freq, float max_freq)
+{
+    const double octaves = log2 ((double)max_freq / min_freq);
+
+    for (int i = 0; i < num_bars; i++) {
+        freq[i] = min_freq * pow (2.0, octaves * i / num_bars);
+    }
+}
+
+int
+dsp_bin_table (const float *freq, int *keys, int num_bars, int fft_size, int samplerate)
+{
+    return dsp_bin_table_grid (freq, keys, num_bars, 0, samplerate / (float)fft_size, fft_size/2);
+}
+
+int
+dsp_bin_table_grid (const float *freq, int *keys, int num_bars, float base_freq, float bin_width, int max_key)
+{
+    int low_res_end = 0;
+    int prev_key = -1;
+    for (int i = 0; i < num_bars; i++) {
+        const int key = ftoi ((freq[i] - base_freq) / bin_width);
+        if (i > 0 && prev_key == key)
+            low_res_end = i;
+        prev_key = key;
+        keys[i] = CLAMP (key, 0, max_key);
+    }
+    keys[num_bars] = keys[num_bars-1];
+    return low_res_end;
+}
+
+void
+dsp_fft (const double *samples, const double *window, double *fft_in, fftw_complex *fft_out, fftw_plan plan, double *spectrum, int fft_size)
+{
+    dsp_fft_many (samples, 0, window, fft_in, fft_out, plan, spectrum, fft_size, 1);
+}
+
+void
+dsp_fft_many (const double *samples, int start, const double *window, double *fft_in, fftw_complex *fft_out, fftw_plan plan, double *spectrum, int fft_size, int howmany)
+{
+    dsp_apply_window (samples, start, window, fft_in, fft_size, howmany);
+    fftw_execute (plan);
+    dsp_power_spectrum (fft_out, spectrum, fft_size, howmany, 0, fft_size/2 - 1);
+}
+
+void
+dsp_apply_window (const double *samples, int start, const double *window, double *fft_in, int fft_size, int howmany)
+{
+    // the ring is unrolled while the window is applied
+    const int n = fft_size - start;
+    for (int c = 0; c < howmany; c++) {
+        const double *s = samples + c * fft_size;
+        double *in = fft_in + c * fft_size;
+        for (int i = 0; i < n; i++) {
+            in[i] = s[start + i] * window[i];
+        }
+        for (int i = n; i < fft_size; i++) {
+            in[i] = s[i - n] * window[i];
+        }
+    }
+}
+
+void
+dsp_power_spectrum (const fftw_complex *fft_out, double *spectrum, int fft_size, int howmany, int first_bin, int last_bin)
+{
+    const int bins = fft_size/2 + 1;
+    for (int c = 0; c < howmany; c++) {
+        const fftw_complex *out = fft_out + c * bins;
+        double *spec = spectrum + c * bins;
+        for (int i = first_bin; i <= last_bin; i++)
+        {
+            const double real = out[i][0];
+            const double imag = out[i][1];
+            spec[i] = (real*real + imag*imag);
+        }
+    }
+}
+
+float
+dsp_get_value (const double *spectrum, int start, int end)
+{
+    if (start >= end) {
+        return spectrum[end];
+    }
+    float value = 0.0;
+    for (int i = start; i < end; i++) {
+        value = MAX (spectrum[i],value);
+    }
+    return value;
+}
+
+// Interpolates band index, which lies in the run [run_start, run_end) of bands
+// sharing one bin. next_end is the end of the following run.
+static inline float
+dsp_interpolate_run (const double *spectrum, const int *keys, int low_res_end, int bands, int index, int run_start, int run_end, int next_end)
+{
+    float x = 0.0;
+    if (index <= low_res_end+1) {
+        const float v1 = log10f (spectrum[keys[index]]);
+
+        // distance to the next value
+        int j = run_end - index;
+        const float v2 = log10f (spectrum[keys[index+j]]);
+
+        const int l = next_end - index;
+        const float v3 = log10f (spectrum[keys[index+l]]);
+
+        const int k = run_start - 1 - index;
+        j += index - run_start + 1;
+        const float v0 = log10f (spectrum[keys[CLAMP(index+k,0,bands-1)]]);
+
+        //x = linear_interpolate (v1,v2,(1.0/(j-1)) * ((-1 * k) - 1));
+        x = 10 * lagrange_interpolate (v0,v1,v2,v3,1 + (1.0 / (j - 1)) * ((-1 * k) - 1));
+    }
+    else {
+        int start = 0;
+        int end = 0;
+        if (index > 0) {
+            start = (keys[index] - keys[index-1])/2 + keys[index-1];
+            if (start == keys[index-1]) start = keys[index];
+        }
+        else {
+            start = keys[index];
+        }
+        if (index < bands-1) {
+            end = (keys[index+1] - keys[index])/2 + keys[index];
+            if (end == keys[index+1]) end = keys[index];
+        }
+        else {
+            end = keys[index];
+        }
+        x = 10 * log10f (dsp_get_value (spectrum, start, end));
+    }
+    return x;
+}
+
+// Returns the end of the run of bands sharing the bin of band start.
+static inline int
+dsp_run_end (const int *keys, int bands, int start)
+{
+    int end = start;
+    while (end < bands && keys[end] == keys[start]) {
+        end++;
+    }
+    return end;
+}
+
+float
+dsp_interpolate (const double *spectrum, const int *keys, int low_res_end, int bands, int index)
+{
+    int run_start = index;
+    while (run_start > 0 && keys[run_start-1] == keys[index]) {
+        run_start--;
+    }
+    const int run_end = dsp_run_end (keys, bands, index);
+    const int next_end = run_end < bands ? dsp_run_end (keys, bands, run_end) : run_end;
+    return dsp_interpolate_run (spectrum, keys, low_res_end, bands, index, run_start, run_end, next_end);
+}
+
+// Maps the power spectrum onto bands, values are in dB within [0, db_range].
+// Runs of bands sharing a bin are tracked while walking the bands, so the cost
+// is linear in the number of bands plus the number of bins.
+void
+dsp_map_bands (const double *spectrum, const int *keys, int low_res_end, int bands, float offset, float db_range, float *values)
+{
+    int run_start = 0;
+    int run_end = 0;
+    int next_end = 0;
+    for (int i = 0; i < bands; i++) {
+        if (i >= run_end) {
+            run_start = i;
+            run_end = i < next_end ? next_end : dsp_run_end (keys, bands, i);
+            next_end = run_end < bands ? dsp_run_end (keys, bands, run_end) : run_end;
+        }
+        const float x = dsp_interpolate_run (spectrum, keys, low_res_end, bands, i, run_start, run_end, next_end) + offset;
+        values[i] = CLAMP (x, 0, db_range);
+    }
+}
+
+void
+dsp_animate (const float *values, float *bars, float *peaks, int *delay_bars, int *delay_peaks, int bands, const dsp_animation_t *anim)
+{
+    for (int i = 0; i < bands; i++) {
+        const float x = values[i];
+        bars[i] = CLAMP (bars[i], 0, anim->db_range);
+        peaks[i] = CLAMP (peaks[i], 0, anim->db_range);
+
+        if (anim->bar_falloff >= 0) {
+            if (delay_bars[i] < 0) {
+                bars[i] -= anim->bar_falloff;
+            }
+            else {
+                delay_bars[i]--;
+            }
+        }
+        else {
+            bars[i] = 0;
+        }
+        if (anim->peak_falloff >= 0) {
+            if (delay_peaks[i] < 0) {
+                peaks[i] -= anim->peak_falloff;
+            }
+            else {
+                delay_peaks[i]--;
+            }
+        }
+        else {
+            peaks[i] = 0;
+        }
+
+        if (x > bars[i])
+        {
+            bars[i] = x;
+            delay_bars[i] = anim->bar_delay;
+        }
+        if (x > peaks[i]) {
+            peaks[i] = x;
+            delay_peaks[i] = anim->peak_delay;
+        }
+        if (peaks[i] < bars[i]) {
+            peaks[i] = bars[i];
+        }
+    }
+}
+
+float
+linear_interpolate (float y1, float y2, float mu)
+{
+       return (y1 * (1 - mu) + y2 * mu);
+}
+
+float
+lagrange_interpolate (float y0, float y1, float y2, float y3, float x)
+{
+    const float a0 = ((x - 1) * (x - 2) * (x - 3)) / -6 * y0;
+    const float a1 = ((x - 0) * (x - 2) * (x - 3)) /  2 * y1;
+    const float a2 = ((x - 0) * (x - 1) * (x - 3)) / -2 * y2;
+    const float a3 = ((x - 0) * (x - 1) * (x - 2)) /  6 * y3;
+    return (a0 + a1 + a2 + a3);
+}
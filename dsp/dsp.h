@@ -0,0 +1,612 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef DSP_HEADER
+#define DSP_HEADER
+
+#include <stdint.h>
+#include <fftw3.h>
+
+enum DSP_WINDOW {
+    DSP_WINDOW_BLACKMAN_HARRIS = 0,
+    DSP_WINDOW_HANNING = 1,
+    DSP_WINDOW_HAMMING = 2,
+    DSP_WINDOW_BLACKMAN_HARRIS_7 = 3,
+    DSP_WINDOW_NUTTALL = 4,
+    DSP_WINDOW_FLAT_TOP = 5,
+    DSP_WINDOW_KAISER = 6,
+    DSP_WINDOW_GAUSSIAN = 7,
+};
+#define DSP_NUM_WINDOWS 8
+// How a single analysed channel is made from the input channels.
+// MID: mean of all channels, SIDE: half the difference of the first two, LEFT, RIGHT: first and
+// second channel, MAX_ABS: the sample with the largest magnitude, RMS: root mean square of all
+// channels with the sign of their sum
+enum DSP_DOWNMIX {
+    DSP_DOWNMIX_MID = 0,
+    DSP_DOWNMIX_SIDE = 1,
+    DSP_DOWNMIX_LEFT = 2,
+    DSP_DOWNMIX_RIGHT = 3,
+    DSP_DOWNMIX_MAX_ABS = 4,
+    DSP_DOWNMIX_RMS = 5,
+};
+
+enum DSP_ENGINE {
+    // transforms of the newest fft_size samples, or dsp_zoom_t with config.zoom
+    DSP_ENGINE_FFT = 0,
+    // dsp_sliding_t, a constant-Q window per band updated with every sample
+    DSP_ENGINE_SLIDING_DFT = 1,
+    // dsp_filter_bank_t, fractional octave band-pass filters run on every sample
+    DSP_ENGINE_FILTER_BANK = 2,
+    DSP_NUM_ENGINES,
+};
+
+// Level of the filter bank bands.
+enum DSP_DETECTOR {
+    // mean square with a time constant of 125 ms
+    DSP_DETECTOR_RMS = 0,
+    // largest output since the last transform
+    DSP_DETECTOR_PEAK = 1,
+};
+
+enum DSP_AVERAGING {
+    // every transform on its own
+    DSP_AVERAGING_NONE = 0,
+    // exponential moving average with the time constant config.average_time
+    DSP_AVERAGING_EXPONENTIAL = 1,
+    // mean of the last config.average_frames transforms
+    DSP_AVERAGING_WELCH = 2,
+    DSP_NUM_AVERAGING_MODES
+};
+
+typedef struct {
+    // bar_falloff, peak_falloff: dB per frame, negative values make them follow the signal instantly
+    float bar_falloff;
+    float peak_falloff;
+    // bar_delay, peak_delay: frames before falloff starts
+    int bar_delay;
+    int peak_delay;
+    float db_range;
+} dsp_animation_t;
+
+// Bumped whenever a function or struct below changes incompatibly.
+#define DSP_API_VERSION 1
+
+#define DSP_MIN_FFT_SIZE 512
+#define DSP_MAX_FFT_SIZE 262144
+// transforms of at least this size are planned with several threads, if built with DSP_FFTW_THREADS
+#define DSP_THREADED_FFT_SIZE 65536
+#define DSP_MAX_FFT_THREADS 8
+#define DSP_MAX_CHANNELS 8
+// display range of the bands by default, C0 to C11
+#define DSP_DEFAULT_MIN_FREQ 16.351598f
+#define DSP_DEFAULT_MAX_FREQ 33488.07f
+// limits of the zoom transform, the span is the number of input samples it covers
+#define DSP_MAX_ZOOM_DECIMATION 256
+#define DSP_MAX_ZOOM_SPAN (4 * DSP_MAX_FFT_SIZE)
+#define DSP_MAX_BANDS_PER_OCTAVE 24
+// transform sizes of multi-resolution analysis, each a quarter of the previous one
+#define DSP_MAX_RESOLUTIONS 4
+#define DSP_MAX_TAPERS 8
+#define DSP_DEFAULT_TIME_BANDWIDTH 4
+#define DSP_MAX_TIME_BANDWIDTH 16
+#define DSP_MAX_AVERAGE_FRAMES 64
+#define DSP_MAX_AVERAGE_TIME 30
+
+typedef struct {
+    // fft_size: clamped to [DSP_MIN_FFT_SIZE, DSP_MAX_FFT_SIZE]
+    int fft_size;
+    // num_bars: at least 1, band tables are sized to it
+    int num_bars;
+    int samplerate;
+    // min_freq, max_freq: the bands span [min_freq, max_freq) on a log scale, min_freq is
+    // at least 1 Hz and max_freq above min_freq. Only the bins within are computed.
+    float min_freq;
+    float max_freq;
+    // zoom: analyse [min_freq, max_freq] with dsp_zoom_t instead of the real transform,
+    // ignored if the range is too wide to be decimated or by the sliding DFT
+    int zoom;
+    // engine: enum DSP_ENGINE. The sliding DFT analyses DSP_MAX_BANDS_PER_OCTAVE bands per
+    // octave whatever num_bars is, its windows are at most fft_size samples.
+    int engine;
+    // bands_per_octave: of the filter bank, e.g. 1, 3, 6 or 12, up to DSP_MAX_BANDS_PER_OCTAVE
+    int bands_per_octave;
+    // detector: enum DSP_DETECTOR of the filter bank
+    int detector;
+    // resolutions: transforms of fft_size, fft_size/4, fft_size/16... points, sizes below
+    // DSP_MIN_FFT_SIZE are left out. Each band is read from the shortest transform whose
+    // bins are no wider than the distance to the next band. 1 uses fft_size only, more
+    // only apply to DSP_ENGINE_FFT without zoom.
+    int resolutions;
+    // reassign: read the bands of the low resolution region, where several share one bin,
+    // from the reassigned frequency of each bin. Only applies to DSP_ENGINE_FFT without zoom.
+    int reassign;
+    // tapers: multitaper estimate of the full transform with this many DPSS tapers instead
+    // of the window, up to DSP_MAX_TAPERS and 2*time_bandwidth-1. 1 uses the window. Only
+    // applies to DSP_ENGINE_FFT without zoom, reassign is ignored with several tapers.
+    int tapers;
+    // time_bandwidth: NW of the tapers, the half bandwidth in bins, 1 to DSP_MAX_TIME_BANDWIDTH
+    float time_bandwidth;
+    // averaging: enum DSP_AVERAGING of the power spectra before the bands are mapped, only
+    // applies to DSP_ENGINE_FFT. average_time: time constant of the exponential average in
+    // seconds, up to DSP_MAX_AVERAGE_TIME. average_frames: transforms of the Welch average,
+    // 2 to DSP_MAX_AVERAGE_FRAMES.
+    int averaging;
+    float average_time;
+    int average_frames;
+    // window: enum DSP_WINDOW
+    int window;
+    // window_param: beta of the Kaiser window, sigma of the Gaussian window relative to
+    // half the window size, 0 picks a default, ignored by the other windows
+    float window_param;
+    // channels: analysed separately, up to DSP_MAX_CHANNELS, 1 combines all input channels
+    int channels;
+    // downmix: enum DSP_DOWNMIX, combines the input channels if channels is 1
+    int downmix;
+    // hop: new samples needed before the next transform, 0 transforms on every call
+    int hop;
+    // amplitude_offset: dB added to every band before it is clamped to [0, db_range]. Levels
+    // are corrected for the window first, a full scale sine reads 0 dB before the offset.
+    float amplitude_offset;
+    float db_range;
+    dsp_animation_t animation;
+} dsp_config_t;
+
+// Band frequencies and spectrum bins for one samplerate, fft size, bar count and range.
+// Tables are cached and shared between contexts, so switching back to a recently
+// used samplerate is a lookup. They must not be modified.
+typedef struct dsp_band_table_s {
+    int samplerate;
+    int fft_size;
+    int num_bars;
+    float min_freq;
+    float max_freq;
+    // zoom: keys index the bins of dsp_zoom_t if the range can be zoomed
+    int zoom;
+    // freq, keys: num_bars+1 entries, the last freq is 0 and the last key repeats the one
+    // before, so the bands only read bins within [keys[0], keys[num_bars-1]]
+    float *freq;
+    int *keys;
+    int low_res_end;
+    // refcount, last_used, next: owned by the cache
+    int refcount;
+    uint64_t last_used;
+    struct dsp_band_table_s *next;
+} dsp_band_table_t;
+
+// Unreferenced tables kept in the cache.
+#define DSP_BAND_TABLE_CACHE_SIZE 16
+
+// Returns the table for the given parameters, building it if it isn't cached.
+// Safe to call from any thread, returns NULL if it can't be allocated.
+const dsp_band_table_t *
+dsp_band_table_acquire (int samplerate, int fft_size, int num_bars, float min_freq, float max_freq, int zoom);
+
+void
+dsp_band_table_release (const dsp_band_table_t *table);
+
+// Builds the tables of the given samplerates ahead of time.
+void
+dsp_band_table_prefetch (const int *samplerates, int count, int fft_size, int num_bars, float min_freq, float max_freq, int zoom);
+
+// A window table for one type, parameter and size. Windows are cached and shared
+// between contexts like band tables and must not be modified.
+typedef struct dsp_window_s {
+    int type;
+    float param;
+    int size;
+    // table: size entries of the periodic window
+    double *table;
+    // correction: dB added to 10*log10 of a bin's power, a full scale sine at the
+    // center of a bin then reads 0 dB
+    float correction;
+    // refcount, last_used, next: owned by the cache
+    int refcount;
+    uint64_t last_used;
+    struct dsp_window_s *next;
+} dsp_window_t;
+
+// Unreferenced windows kept in the cache.
+#define DSP_WINDOW_CACHE_SIZE 8
+
+// Returns the window for the given parameters, generating it if it isn't cached.
+// Safe to call from any thread, returns NULL if it can't be allocated.
+const dsp_window_t *
+dsp_window_acquire (int type, float param, int size);
+
+void
+dsp_window_release (const dsp_window_t *window);
+
+// Discrete prolate spheroidal sequences of one size, count and time-bandwidth product.
+// Cached and shared like windows, they must not be modified.
+typedef struct dsp_tapers_s {
+    int size;
+    int count;
+    float bandwidth;
+    // table: count tapers of size entries each with unit energy, in order of concentration
+    double *table;
+    // correction: dB added to 10*log10 of the averaged power, a full scale sine at the
+    // center of a bin then reads 0 dB
+    float correction;
+    // refcount, last_used, next: owned by the cache
+    int refcount;
+    uint64_t last_used;
+    struct dsp_tapers_s *next;
+} dsp_tapers_t;
+
+// Unreferenced taper sets kept in the cache.
+#define DSP_TAPERS_CACHE_SIZE 4
+
+// Returns the tapers for the given parameters, generating them if they aren't cached,
+// which takes about a second at 262144 points. Safe to call from any thread, returns NULL
+// if they can't be allocated.
+const dsp_tapers_t *
+dsp_tapers_acquire (int size, int count, float bandwidth);
+
+// Returns the cached tapers for the given parameters or NULL, without generating them.
+// Cheap enough for audio and drawing locks, dsp_tapers_acquire fills the cache.
+const dsp_tapers_t *
+dsp_tapers_lookup (int size, int count, float bandwidth);
+
+void
+dsp_tapers_release (const dsp_tapers_t *tapers);
+
+// Fills table with count tapers of size entries and time-bandwidth product bandwidth.
+// Returns -1 if the scratch space can't be allocated.
+int
+dsp_dpss (double *table, int size, int count, double bandwidth);
+
+// Averages the power of the bins [first_bin, last_bin] of count transforms into spectrum.
+// The transform of taper k starts at fft_out + k * stride and is laid out like the fft_out
+// of dsp_fft_many for howmany channels.
+void
+dsp_taper_average (const fftw_complex *fft_out, int stride, int count, double *spectrum, int fft_size, int howmany, int first_bin, int last_bin);
+
+// Time average of power spectra, see enum DSP_AVERAGING.
+typedef struct dsp_average_s dsp_average_t;
+
+// Returns NULL if it can't be allocated, frames only matters to DSP_AVERAGING_WELCH.
+dsp_average_t *
+dsp_average_new (int mode, int size, int frames);
+
+void
+dsp_average_free (dsp_average_t *a);
+
+void
+dsp_average_reset (dsp_average_t *a);
+
+// Adds the size entries of spectrum to the average and replaces them by it. alpha is the
+// weight of the new frame in the exponential average.
+void
+dsp_average_update (dsp_average_t *a, double *spectrum, float alpha);
+
+// Analysis state of one spectrum: sample history, FFT plan, band tables and bars.
+// A context is not thread safe, callers feeding it from another thread must lock.
+typedef struct dsp_context_s dsp_context_t;
+
+void
+dsp_config_default (dsp_config_t *config);
+
+// Creates a context with band tables only. Contexts that map bands from another
+// context's spectrum never need more, sample and FFT buffers come with dsp_context_prepare.
+dsp_context_t *
+dsp_context_new (const dsp_config_t *config);
+
+// Allocates the sample history, window and FFT plan. Until then feeding and
+// transforming do nothing. Returns -1 if the buffers can't be allocated.
+int
+dsp_context_prepare (dsp_context_t *ctx);
+
+void
+dsp_context_free (dsp_context_t *ctx);
+
+// Applies a new config, only the tables and plans affected by the changes are rebuilt.
+// Returns -1 if buffers for a new size can't be allocated, that size is then left unchanged.
+int
+dsp_context_configure (dsp_context_t *ctx, const dsp_config_t *config);
+
+const dsp_config_t *
+dsp_context_get_config (const dsp_context_t *ctx);
+
+// Appends interleaved samples. With config.channels 1 the input channels are combined as
+// set by config.downmix, otherwise each input channel goes to its own history, missing
+// input channels repeat the last one.
+void
+dsp_context_feed (dsp_context_t *ctx, const float *data, int nframes, int channels);
+
+// Drops the sample history, e.g. when the samplerate of the fed audio changes,
+// so no transform mixes audio of both rates.
+void
+dsp_context_reset (dsp_context_t *ctx);
+
+// Returns 1 while the tapers of config.tapers aren't cached, the context uses the window
+// until another thread generated them with dsp_tapers_acquire.
+int
+dsp_context_tapers_missing (const dsp_context_t *ctx);
+
+// Transforms the newest fft_size samples. Returns 0 when too few new samples
+// arrived since the last transform and the previous spectrum is kept.
+int
+dsp_context_fft (dsp_context_t *ctx);
+
+void
+dsp_context_map_bands (dsp_context_t *ctx);
+
+// Maps the last spectrum of source onto the bands of ctx, which lets several
+// contexts share one transform. Both must use the same fft_size and samplerate.
+void
+dsp_context_map_bands_from (dsp_context_t *ctx, const dsp_context_t *source);
+
+void
+dsp_context_animate (dsp_context_t *ctx);
+
+// Drops all bars and peaks to zero, e.g. when playback stops.
+void
+dsp_context_clear_bars (dsp_context_t *ctx);
+
+// Bars and peaks of the first channel.
+const float *
+dsp_context_get_bars (const dsp_context_t *ctx);
+
+const float *
+dsp_context_get_peaks (const dsp_context_t *ctx);
+
+const float *
+dsp_context_get_channel_bars (const dsp_context_t *ctx, int channel);
+
+const float *
+dsp_context_get_channel_peaks (const dsp_context_t *ctx, int channel);
+
+// Center frequency of each band in Hz, NULL if the band table couldn't be allocated.
+const float *
+dsp_context_get_frequencies (const dsp_context_t *ctx);
+
+// Creates the real to complex plan used by contexts, multithreaded from DSP_THREADED_FFT_SIZE on.
+// Like all FFTW planning it must not run concurrently with other planner calls.
+fftw_plan
+dsp_fft_plan (int fft_size, double *in, fftw_complex *out);
+
+// Plans howmany transforms at once, input i at in + i*fft_size, output at out + i*(fft_size/2+1).
+fftw_plan
+dsp_fft_plan_many (int fft_size, int howmany, double *in, fftw_complex *out);
+
+// Plans howmany forward complex transforms laid out like dsp_fft_plan_many, with fft_size outputs each.
+fftw_plan
+dsp_fft_plan_complex_many (int fft_size, int howmany, fftw_complex *in, fftw_complex *out);
+
+// Fills window with fft_size entries of the periodic window, param as in dsp_config_t.
+void
+dsp_window_table (double *window, int fft_size, int type, float param);
+
+// Fills freq with the note frequencies of num_bars bands over the default range and keys
+// with their spectrum bins. Returns the last band sharing its bin with the previous one.
+int
+dsp_frequency_table (float *freq, int *keys, int num_bars, int fft_size, int samplerate);
+
+// The two halves of dsp_frequency_table, the frequencies only depend on num_bars and the range.
+void
+dsp_note_frequencies (float *freq, int num_bars);
+
+void
+dsp_band_frequencies (float *freq, int num_bars, float min_freq, float max_freq);
+
+int
+dsp_bin_table (const float *freq, int *keys, int num_bars, int fft_size, int samplerate);
+
+// dsp_bin_table for bins at base_freq + i*bin_width, keys are clamped to [0, max_key].
+int
+dsp_bin_table_grid (const float *freq, int *keys, int num_bars, float base_freq, float bin_width, int max_key);
+
+void
+dsp_fft (const double *samples, const double *window, double *fft_in, fftw_complex *fft_out, fftw_plan plan, double *spectrum, int fft_size);
+
+// dsp_fft for howmany channels laid out like dsp_fft_plan_many, spectrum has fft_size/2+1 entries per channel.
+// The samples of each channel are a ring of fft_size entries starting with the oldest one at start.
+void
+dsp_fft_many (const double *samples, int start, const double *window, double *fft_in, fftw_complex *fft_out, fftw_plan plan, double *spectrum, int fft_size, int howmany);
+
+// The steps of dsp_fft_many: windowing the rings into fft_in and the power of the bins
+// [first_bin, last_bin] of each channel after the transform.
+void
+dsp_apply_window (const double *samples, int start, const double *window, double *fft_in, int fft_size, int howmany);
+
+void
+dsp_power_spectrum (const fftw_complex *fft_out, double *spectrum, int fft_size, int howmany, int first_bin, int last_bin);
+
+// Power of the bins [first_bin, last_bin] of fft_size windowed samples, like dsp_power_spectrum.
+void
+dsp_goertzel (const double *in, int fft_size, int first_bin, int last_bin, double *spectrum);
+
+// dsp_fft_many producing only the bins [first_bin, last_bin] below nyquist, narrow ranges
+// skip the transform and are computed with dsp_goertzel.
+void
+dsp_fft_range (const double *samples, int start, const double *window, double *fft_in, fftw_complex *fft_out, fftw_plan plan, double *spectrum, int fft_size, int howmany, int first_bin, int last_bin);
+
+// Fills deriv with the derivative of the fft_size entry window per sample.
+void
+dsp_window_derivative (const double *window, double *deriv, int fft_size);
+
+// dsp_fft_many of the bins [first_bin, last_bin] that also transforms the samples with the
+// derivative window deriv into deriv_in and deriv_out, both laid out like fft_in and
+// fft_out, and stores the reassigned frequency of each bin in Hz into freq, which is laid
+// out like spectrum.
+void
+dsp_fft_reassign (const double *samples, int start, const double *window, const double *deriv, double *fft_in, fftw_complex *fft_out, fftw_plan plan,
+        double *deriv_in, fftw_complex *deriv_out, fftw_plan deriv_plan, double *spectrum, float *freq, int fft_size, int howmany, int samplerate,
+        int first_bin, int last_bin);
+
+// Maps the bins [first_bin, last_bin] of spectrum onto bands of the center frequencies freq
+// by their reassigned frequency bin_freq, each band shows its loudest bin. Bands without
+// one read 0, values are in dB within [0, db_range].
+void
+dsp_map_reassigned (const double *spectrum, const float *bin_freq, int first_bin, int last_bin, const float *freq, int bands, float offset, float db_range, float *values);
+
+// Zoom transform of a narrow band: the input is shifted down by the center of the band,
+// low-pass filtered and decimated, and the last fft_size decimated samples get a complex
+// transform. Its bins are decimation times narrower than those of a real transform of
+// the same size, it covers decimation*fft_size input samples.
+typedef struct dsp_zoom_s dsp_zoom_t;
+
+// Returns the decimation of the band, 1 if it's too wide to be zoomed.
+int
+dsp_zoom_decimation (int samplerate, float min_freq, float max_freq, int fft_size);
+
+// Fills base_freq and bin_width with the frequency of the first and the spacing of the
+// fft_size bins. Returns the decimation.
+int
+dsp_zoom_grid (int samplerate, float min_freq, float max_freq, int fft_size, float *base_freq, float *bin_width);
+
+// Returns NULL if the band is too wide or the buffers can't be allocated. Plans a transform.
+dsp_zoom_t *
+dsp_zoom_new (int samplerate, float min_freq, float max_freq, int fft_size, int channels);
+
+void
+dsp_zoom_free (dsp_zoom_t *zoom);
+
+void
+dsp_zoom_reset (dsp_zoom_t *zoom);
+
+// Filters n new samples of channel, every channel must be fed the same samples.
+void
+dsp_zoom_feed (dsp_zoom_t *zoom, int channel, const double *samples, int n);
+
+// Writes the power of the fft_size bins of each channel to spectrum, in ascending
+// frequency as given by dsp_zoom_grid, window has fft_size entries.
+void
+dsp_zoom_transform (dsp_zoom_t *zoom, const double *window, double *spectrum);
+
+// Sliding DFT of a set of bands: each band keeps the Hann windowed DFT of the newest
+// samples at its frequency, updated with every sample. The bands are at the centers
+// 440 * 2^(k/bands_per_octave) Hz within [min_freq, max_freq] and below Nyquist,
+// in ascending frequency. The windows are constant-Q up to max_length samples, reading
+// the power of all bands costs one pass over them.
+typedef struct dsp_sliding_s dsp_sliding_t;
+
+// Returns NULL if the buffers can't be allocated.
+dsp_sliding_t *
+dsp_sliding_new (int samplerate, float min_freq, float max_freq, int bands_per_octave, int max_length, int channels);
+
+void
+dsp_sliding_free (dsp_sliding_t *sd);
+
+void
+dsp_sliding_reset (dsp_sliding_t *sd);
+
+int
+dsp_sliding_bands (const dsp_sliding_t *sd);
+
+// Index of the band nearest to freq, -1 if freq is over half a band beyond the bands.
+int
+dsp_sliding_band (const dsp_sliding_t *sd, float freq);
+
+// Updates the bands of channel with n new samples.
+void
+dsp_sliding_feed (dsp_sliding_t *sd, int channel, const double *samples, int n);
+
+// Computes the power of every band from the current state.
+void
+dsp_sliding_update (dsp_sliding_t *sd);
+
+// Power of the bands of channel at the last dsp_sliding_update, a full scale sine reads 1.
+const double *
+dsp_sliding_power (const dsp_sliding_t *sd, int channel);
+
+// Fractional octave filter bank: 4th order Butterworth band-passes at the base 2 band
+// centers 1000 * 2^(k/bands_per_octave) Hz within [min_freq, max_freq] and below Nyquist,
+// each followed by a mean square and a peak detector. Bands are in ascending frequency.
+typedef struct dsp_filter_bank_s dsp_filter_bank_t;
+
+// Returns NULL if the buffers can't be allocated.
+dsp_filter_bank_t *
+dsp_filter_bank_new (int samplerate, float min_freq, float max_freq, int bands_per_octave, int channels);
+
+void
+dsp_filter_bank_free (dsp_filter_bank_t *fb);
+
+void
+dsp_filter_bank_reset (dsp_filter_bank_t *fb);
+
+int
+dsp_filter_bank_bands (const dsp_filter_bank_t *fb);
+
+// Index of the band containing freq, -1 if no band does.
+int
+dsp_filter_bank_band (const dsp_filter_bank_t *fb, float freq);
+
+// Filters n new samples of channel.
+void
+dsp_filter_bank_feed (dsp_filter_bank_t *fb, int channel, const double *samples, int n);
+
+// Reads the level of every band as set by detector, enum DSP_DETECTOR. The peak
+// detector starts over afterwards.
+void
+dsp_filter_bank_update (dsp_filter_bank_t *fb, int detector);
+
+// Power of the bands of channel at the last dsp_filter_bank_update, a full scale sine reads 1.
+const double *
+dsp_filter_bank_power (const dsp_filter_bank_t *fb, int channel);
+
+// Shared worker threads for the independent transforms of one frame, started with the
+// first dsp_pool_acquire and stopped with the last dsp_pool_release.
+typedef void (*dsp_job_t) (void *arg, int index);
+
+void
+dsp_pool_acquire (void);
+
+void
+dsp_pool_release (void);
+
+// Runs job (arg, i) for every i below count on the workers and the calling thread, returns
+// when all are done. Without workers, e.g. built without DSP_FFTW_THREADS, the calling
+// thread runs them in order.
+void
+dsp_pool_run (dsp_job_t job, void *arg, int count);
+
+// Combines nframes interleaved frames of 1 to DSP_MAX_CHANNELS channels into out, mode is enum DSP_DOWNMIX.
+void
+dsp_downmix (const float *data, int nframes, int channels, int mode, double *out);
+
+// Copies channel of nframes interleaved frames into out.
+void
+dsp_deinterleave (const float *data, int nframes, int channels, int channel, double *out);
+
+float
+dsp_get_value (const double *spectrum, int start, int end);
+
+float
+dsp_interpolate (const double *spectrum, const int *keys, int low_res_end, int bands, int index);
+
+void
+dsp_map_bands (const double *spectrum, const int *keys, int low_res_end, int bands, float offset, float db_range, float *values);
+
+void
+dsp_animate (const float *values, float *bars, float *peaks, int *delay_bars, int *delay_peaks, int bands, const dsp_animation_t *anim);
+
+float
+linear_interpolate (float y1, float y2, float mu);
+
+float
+lagrange_interpolate (float y0, float y1, float y2, float y3, float x);
+
+#endif
@@ -0,0 +1,370 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+
+// Fractional octave filter bank: band-pass filters at the base 2 octave band centers
+// 1000 * 2^(k/bands_per_octave) Hz with edges half a band below and above, as in
+// IEC 61260. Each band is a 4th order Butterworth band-pass of two biquads designed
+// with the bilinear transform, followed by a mean square and a peak detector. The
+// filters run on every sample, so the bass bands follow transients without waiting
+// for a transform window.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dsp.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef CLAMP
+#define CLAMP(x,low,high) (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
+#endif
+
+// reference frequency of the band centers
+#define FILTER_BANK_REFERENCE 1000.0
+// time constant of the mean square, "fast" of sound level meters
+#define FILTER_BANK_RMS_TIME 0.125
+// samples filtered at once, the bands then run over them one after another
+#define FILTER_BANK_BLOCK 256
+// states below this are flushed to 0 after each block, silence would otherwise decay
+// into denormals, which are slow on most CPUs
+#define FILTER_BANK_FLUSH 1e-30
+
+typedef struct {
+    // p1, p2: last two outputs of the first biquad, q1, q2: of the second one
+    double *p1;
+    double *p2;
+    double *q1;
+    double *q2;
+    // ms: mean square of the output, peak: largest squared output since the last update
+    double *ms;
+    double *peak;
+    // x1, x2: last two input samples
+    double x1;
+    double x2;
+    // power: of every band after dsp_filter_bank_update
+    double *power;
+} filter_bank_channel_t;
+
+struct dsp_filter_bank_s {
+    int bands;
+    // stride: bands rounded up to an even count, the vector loops run two at once
+    int stride;
+    int channels;
+    int bands_per_octave;
+    // first: index k of the band center 1000 * 2^(k/bands_per_octave) of band 0
+    int first;
+    // b0, a1, a2: coefficients of both biquads, biquad s of band b at s*stride + b.
+    // Their numerator is b0 * (1 - z^-2).
+    double *b0;
+    double *a1;
+    double *a2;
+    // rms_k: weight of a new sample in the mean square
+    double rms_k;
+    // dx: scratch of x[n] - x[n-2] of one block
+    double dx[FILTER_BANK_BLOCK];
+    filter_bank_channel_t channel[DSP_MAX_CHANNELS];
+};
+
+void
+dsp_filter_bank_free (dsp_filter_bank_t *fb)
+{
+    if (!fb) {
+        return;
+    }
+    for (int c = 0; c < fb->channels; c++) {
+        filter_bank_channel_t *ch = &fb->channel[c];
+        free (ch->p1);
+        free (ch->p2);
+        free (ch->q1);
+        free (ch->q2);
+        free (ch->ms);
+        free (ch->peak);
+        free (ch->power);
+    }
+    free (fb->b0);
+    free (fb->a1);
+    free (fb->a2);
+    free (fb);
+}
+
+// Bilinear transform of b * s / (s^2 - 2 Re(p) s + |p|^2), k is 2*samplerate.
+static void
+filter_bank_biquad (double complex p, double b, double k, double *b0, double *a1, double *a2)
+{
+    const double c1 = -2 * creal (p);
+    const double c0 = creal (p) * creal (p) + cimag (p) * cimag (p);
+    const double d0 = k * k + c1 * k + c0;
+    *b0 = b * k / d0;
+    *a1 = (2 * c0 - 2 * k * k) / d0;
+    *a2 = (k * k - c1 * k + c0) / d0;
+}
+
+// Magnitude of the biquad at w radians per sample.
+static double
+filter_bank_gain (double b0, double a1, double a2, double w)
+{
+    const double complex z1 = cexp (-I * w);
+    const double complex z2 = z1 * z1;
+    return cabs (b0 * (1 - z2) / (1 + a1 * z1 + a2 * z2));
+}
+
+dsp_filter_bank_t *
+dsp_filter_bank_new (int samplerate, float min_freq, float max_freq, int bands_per_octave, int channels)
+{
+    dsp_filter_bank_t *fb = calloc (1, sizeof (dsp_filter_bank_t));
+    if (!fb) {
+        return NULL;
+    }
+    const double b = MAX (bands_per_octave, 1);
+    const double half = pow (2, 0.5 / b);
+    // centers within the range whose upper edge is below Nyquist, at least one band
+    const int first = ceil (b * log2 (min_freq / FILTER_BANK_REFERENCE));
+    const int nyquist = floor (b * log2 (0.5 * samplerate / half / FILTER_BANK_REFERENCE) - 1e-9);
+    const int last = MAX (MIN ((int)floor (b * log2 (max_freq / FILTER_BANK_REFERENCE)), nyquist), first);
+    fb->bands_per_octave = b;
+    fb->first = first;
+    fb->bands = last - first + 1;
+    fb->stride = (fb->bands + 1) & ~1;
+    fb->channels = CLAMP (channels, 1, DSP_MAX_CHANNELS);
+    fb->rms_k = 1 - exp (-1 / (FILTER_BANK_RMS_TIME * samplerate));
+
+    const int size = 2 * fb->stride;
+    fb->b0 = calloc (size, sizeof (double));
+    fb->a1 = calloc (size, sizeof (double));
+    fb->a2 = calloc (size, sizeof (double));
+    int ok = fb->b0 && fb->a1 && fb->a2;
+    for (int c = 0; ok && c < fb->channels; c++) {
+        filter_bank_channel_t *ch = &fb->channel[c];
+        ch->p1 = calloc (fb->stride, sizeof (double));
+        ch->p2 = calloc (fb->stride, sizeof (double));
+        ch->q1 = calloc (fb->stride, sizeof (double));
+        ch->q2 = calloc (fb->stride, sizeof (double));
+        ch->ms = calloc (fb->stride, sizeof (double));
+        ch->peak = calloc (fb->stride, sizeof (double));
+        ch->power = calloc (fb->bands, sizeof (double));
+        ok = ch->p1 && ch->p2 && ch->q1 && ch->q2 && ch->ms && ch->peak && ch->power;
+    }
+    if (!ok) {
+        dsp_filter_bank_free (fb);
+        return NULL;
+    }
+
+    const double k = 2.0 * samplerate;
+    for (int i = 0; i < fb->bands; i++) {
+        const double fc = FILTER_BANK_REFERENCE * pow (2, (first + i) / b);
+        // prewarped edges, the band-pass of the 2nd order Butterworth low-pass
+        const double w1 = k * tan (M_PI * MIN (fc / half, 0.499 * samplerate) / samplerate);
+        const double w2 = k * tan (M_PI * MIN (fc * half, 0.499 * samplerate) / samplerate);
+        const double bw = w2 - w1;
+        const double w0 = sqrt (w1 * w2);
+        // each pole p of the low-pass gives the band-pass poles s^2 - p*bw*s + w0^2 = 0
+        const double complex p = cexp (I * 3 * M_PI / 4);
+        const double complex d = csqrt (p * p * bw * bw - 4 * w0 * w0);
+        double complex s1 = (p * bw + d) / 2;
+        double complex s2 = (p * bw - d) / 2;
+        // both biquads are normalized together to unity gain at the center
+        double b0[2], a1[2], a2[2];
+        filter_bank_biquad (s1, 1, k, &b0[0], &a1[0], &a2[0]);
+        filter_bank_biquad (s2, 1, k, &b0[1], &a1[1], &a2[1]);
+        const double wc = 2 * M_PI * MIN (fc, 0.499 * samplerate) / samplerate;
+        const double g = sqrt (filter_bank_gain (b0[0], a1[0], a2[0], wc) * filter_bank_gain (b0[1], a1[1], a2[1], wc));
+        for (int s = 0; s < 2; s++) {
+            fb->b0[s * fb->stride + i] = b0[s] / g;
+            fb->a1[s * fb->stride + i] = a1[s];
+            fb->a2[s * fb->stride + i] = a2[s];
+        }
+    }
+    return fb;
+}
+
+void
+dsp_filter_bank_reset (dsp_filter_bank_t *fb)
+{
+    for (int c = 0; c < fb->channels; c++) {
+        filter_bank_channel_t *ch = &fb->channel[c];
+        memset (ch->p1, 0, fb->stride * sizeof (double));
+        memset (ch->p2, 0, fb->stride * sizeof (double));
+        memset (ch->q1, 0, fb->stride * sizeof (double));
+        memset (ch->q2, 0, fb->stride * sizeof (double));
+        memset (ch->ms, 0, fb->stride * sizeof (double));
+        memset (ch->peak, 0, fb->stride * sizeof (double));
+        memset (ch->power, 0, fb->bands * sizeof (double));
+        ch->x1 = 0;
+        ch->x2 = 0;
+    }
+}
+
+int
+dsp_filter_bank_bands (const dsp_filter_bank_t *fb)
+{
+    return fb->bands;
+}
+
+int
+dsp_filter_bank_band (const dsp_filter_bank_t *fb, float freq)
+{
+    if (!(freq > 0)) {
+        return -1;
+    }
+    const int i = (int)lrint (fb->bands_per_octave * log2 (freq / FILTER_BANK_REFERENCE)) - fb->first;
+    return i >= 0 && i < fb->bands ? i : -1;
+}
+
+static inline double
+filter_bank_flush (double x)
+{
+    return fabs (x) < FILTER_BANK_FLUSH ? 0 : x;
+}
+
+// Runs bands b and b+1 over the n samples whose dx is in fb->dx.
+static void
+filter_bank_run (const dsp_filter_bank_t *fb, filter_bank_channel_t *ch, int b, int n)
+{
+    const int s = fb->stride;
+    const double *dx = fb->dx;
+#ifdef __SSE2__
+    // named rather than arrays, they stay in registers
+    __m128d p1 = _mm_loadu_pd (ch->p1 + b);
+    __m128d p2 = _mm_loadu_pd (ch->p2 + b);
+    __m128d q1 = _mm_loadu_pd (ch->q1 + b);
+    __m128d q2 = _mm_loadu_pd (ch->q2 + b);
+    __m128d ms = _mm_loadu_pd (ch->ms + b);
+    __m128d peak = _mm_loadu_pd (ch->peak + b);
+    const __m128d b0a = _mm_loadu_pd (fb->b0 + b);
+    const __m128d a1a = _mm_loadu_pd (fb->a1 + b);
+    const __m128d a2a = _mm_loadu_pd (fb->a2 + b);
+    const __m128d b0b = _mm_loadu_pd (fb->b0 + s + b);
+    const __m128d a1b = _mm_loadu_pd (fb->a1 + s + b);
+    const __m128d a2b = _mm_loadu_pd (fb->a2 + s + b);
+    const __m128d k = _mm_set1_pd (fb->rms_k);
+    for (int i = 0; i < n; i++) {
+        // the terms of older outputs first, they stay off the dependency chains
+        const __m128d p = _mm_sub_pd (_mm_sub_pd (_mm_mul_pd (b0a, _mm_set1_pd (dx[i])), _mm_mul_pd (a2a, p2)), _mm_mul_pd (a1a, p1));
+        const __m128d q = _mm_sub_pd (_mm_sub_pd (_mm_mul_pd (b0b, _mm_sub_pd (p, p2)), _mm_mul_pd (a2b, q2)), _mm_mul_pd (a1b, q1));
+        p2 = p1;
+        p1 = p;
+        q2 = q1;
+        q1 = q;
+        const __m128d y2 = _mm_mul_pd (q, q);
+        ms = _mm_add_pd (ms, _mm_mul_pd (k, _mm_sub_pd (y2, ms)));
+        peak = _mm_max_pd (peak, y2);
+    }
+    _mm_storeu_pd (ch->p1 + b, p1);
+    _mm_storeu_pd (ch->p2 + b, p2);
+    _mm_storeu_pd (ch->q1 + b, q1);
+    _mm_storeu_pd (ch->q2 + b, q2);
+    _mm_storeu_pd (ch->ms + b, ms);
+    _mm_storeu_pd (ch->peak + b, peak);
+#else
+    for (int j = b; j < b + 2; j++) {
+        const double b0a = fb->b0[j], a1a = fb->a1[j], a2a = fb->a2[j];
+        const double b0b = fb->b0[s + j], a1b = fb->a1[s + j], a2b = fb->a2[s + j];
+        double p1 = ch->p1[j], p2 = ch->p2[j], q1 = ch->q1[j], q2 = ch->q2[j];
+        double ms = ch->ms[j], peak = ch->peak[j];
+        for (int i = 0; i < n; i++) {
+            const double p = b0a * dx[i] - a2a * p2 - a1a * p1;
+            const double q = b0b * (p - p2) - a2b * q2 - a1b * q1;
+            p2 = p1;
+            p1 = p;
+            q2 = q1;
+            q1 = q;
+            ms += fb->rms_k * (q * q - ms);
+            peak = MAX (peak, q * q);
+        }
+        ch->p1[j] = p1;
+        ch->p2[j] = p2;
+        ch->q1[j] = q1;
+        ch->q2[j] = q2;
+        ch->ms[j] = ms;
+        ch->peak[j] = peak;
+    }
+#endif
+    for (int j = b; j < b + 2; j++) {
+        ch->p1[j] = filter_bank_flush (ch->p1[j]);
+        ch->p2[j] = filter_bank_flush (ch->p2[j]);
+        ch->q1[j] = filter_bank_flush (ch->q1[j]);
+        ch->q2[j] = filter_bank_flush (ch->q2[j]);
+        ch->ms[j] = filter_bank_flush (ch->ms[j]);
+    }
+}
+
+void
+dsp_filter_bank_feed (dsp_filter_bank_t *fb, int channel, const double *samples, int n)
+{
+    if (channel < 0 || channel >= fb->channels) {
+        return;
+    }
+    filter_bank_channel_t *ch = &fb->channel[channel];
+    while (n > 0) {
+        const int sz = MIN (n, FILTER_BANK_BLOCK);
+        // the numerator of all biquads is b0 * (1 - z^-2), its difference is shared
+        for (int i = 0; i < sz; i++) {
+            const double x2 = i >= 2 ? samples[i-2] : i == 1 ? ch->x1 : ch->x2;
+            fb->dx[i] = samples[i] - x2;
+        }
+        ch->x2 = sz >= 2 ? samples[sz-2] : ch->x1;
+        ch->x1 = samples[sz-1];
+        for (int b = 0; b < fb->stride; b += 2) {
+            filter_bank_run (fb, ch, b, sz);
+        }
+        samples += sz;
+        n -= sz;
+    }
+}
+
+void
+dsp_filter_bank_update (dsp_filter_bank_t *fb, int detector)
+{
+    for (int c = 0; c < fb->channels; c++) {
+        filter_bank_channel_t *ch = &fb->channel[c];
+        if (detector == DSP_DETECTOR_PEAK) {
+            // a full scale sine peaks at 1
+            memcpy (ch->power, ch->peak, fb->bands * sizeof (double));
+            memset (ch->peak, 0, fb->stride * sizeof (double));
+        }
+        else {
+            // the mean square of a full scale sine is 1/2
+            for (int i = 0; i < fb->bands; i++) {
+                ch->power[i] = 2 * ch->ms[i];
+            }
+        }
+    }
+}
+
+const double *
+dsp_filter_bank_power (const dsp_filter_bank_t *fb, int channel)
+{
+    return fb->channel[CLAMP (channel, 0, fb->channels - 1)].power;
+}
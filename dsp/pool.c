@@ -0,0 +1,162 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+
+// Worker threads shared by all contexts, they run the independent transforms of one
+// frame side by side. The pool needs pthreads, which come with DSP_FFTW_THREADS.
+// Without them the jobs run one after another on the calling thread.
+
+#include <stdlib.h>
+#ifdef DSP_FFTW_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "dsp.h"
+
+#ifndef CLAMP
+#define CLAMP(x,low,high) (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
+#endif
+
+#ifdef DSP_FFTW_THREADS
+// workers besides the calling thread, which takes part in every run
+#define POOL_MAX_THREADS 7
+
+// lock: protects everything below, run_lock: one run at a time
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_run_lock = PTHREAD_MUTEX_INITIALIZER;
+// wake: a run started or the pool is shut down, done: the last job of a run finished
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static int pool_refcount;
+static int pool_threads;
+static int pool_quit;
+static pthread_t pool_thread[POOL_MAX_THREADS];
+// job, arg: of the current run, next: first job not started yet, pending: jobs not finished yet
+static dsp_job_t pool_job;
+static void *pool_arg;
+static int pool_next;
+static int pool_count;
+static int pool_pending;
+
+// Runs jobs of the current run until none is left, the lock is held on entry and exit.
+static void
+pool_work (void)
+{
+    while (pool_next < pool_count) {
+        const int i = pool_next++;
+        pthread_mutex_unlock (&pool_lock);
+        pool_job (pool_arg, i);
+        pthread_mutex_lock (&pool_lock);
+        if (--pool_pending == 0) {
+            pthread_cond_signal (&pool_done);
+        }
+    }
+}
+
+static void *
+pool_worker (void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock (&pool_lock);
+    while (!pool_quit) {
+        pool_work ();
+        if (!pool_quit) {
+            pthread_cond_wait (&pool_wake, &pool_lock);
+        }
+    }
+    pthread_mutex_unlock (&pool_lock);
+    return NULL;
+}
+#endif
+
+void
+dsp_pool_acquire (void)
+{
+#ifdef DSP_FFTW_THREADS
+    pthread_mutex_lock (&pool_run_lock);
+    pthread_mutex_lock (&pool_lock);
+    if (pool_refcount++ == 0) {
+        pool_quit = 0;
+        const int threads = CLAMP ((int)sysconf (_SC_NPROCESSORS_ONLN) - 1, 0, POOL_MAX_THREADS);
+        // a thread that can't be started leaves its jobs to the others
+        while (pool_threads < threads && !pthread_create (&pool_thread[pool_threads], NULL, pool_worker, NULL)) {
+            pool_threads++;
+        }
+    }
+    pthread_mutex_unlock (&pool_lock);
+    pthread_mutex_unlock (&pool_run_lock);
+#endif
+}
+
+void
+dsp_pool_release (void)
+{
+#ifdef DSP_FFTW_THREADS
+    pthread_mutex_lock (&pool_run_lock);
+    pthread_mutex_lock (&pool_lock);
+    if (--pool_refcount == 0) {
+        pool_quit = 1;
+        pthread_cond_broadcast (&pool_wake);
+        pthread_mutex_unlock (&pool_lock);
+        for (int i = 0; i < pool_threads; i++) {
+            pthread_join (pool_thread[i], NULL);
+        }
+        pthread_mutex_lock (&pool_lock);
+        pool_threads = 0;
+    }
+    pthread_mutex_unlock (&pool_lock);
+    pthread_mutex_unlock (&pool_run_lock);
+#endif
+}
+
+void
+dsp_pool_run (dsp_job_t job, void *arg, int count)
+{
+#ifdef DSP_FFTW_THREADS
+    pthread_mutex_lock (&pool_run_lock);
+    pthread_mutex_lock (&pool_lock);
+    if (pool_threads > 0 && count > 1) {
+        pool_job = job;
+        pool_arg = arg;
+        pool_next = 0;
+        pool_count = count;
+        pool_pending = count;
+        pthread_cond_broadcast (&pool_wake);
+        pool_work ();
+        while (pool_pending > 0) {
+            pthread_cond_wait (&pool_done, &pool_lock);
+        }
+        pthread_mutex_unlock (&pool_lock);
+        pthread_mutex_unlock (&pool_run_lock);
+        return;
+    }
+    pthread_mutex_unlock (&pool_lock);
+    pthread_mutex_unlock (&pool_run_lock);
+#endif
+    for (int i = 0; i < count; i++) {
+        job (arg, i);
+    }
+}
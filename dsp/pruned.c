@@ -0,0 +1,125 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+// Pruned spectrum: the transform only has to produce the bins the band tables read.
+// Narrow bin ranges are computed with the Goertzel algorithm, wide ones take the
+// full FFT and skip the power of the bins outside.
+
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dsp.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+// bins computed at once, the padding of the last group is discarded
+#define GOERTZEL_GROUP 8
+// a Goertzel bin costs about as much per sample as two stages of the FFT (SSE2, measured
+// with bench_dsp), large transforms pay extra for leaving the cache
+#define GOERTZEL_COST 2
+
+void
+dsp_goertzel (const double *in, int fft_size, int first_bin, int last_bin, double *spectrum)
+{
+    for (int k = first_bin; k <= last_bin; k += GOERTZEL_GROUP) {
+        double coeff[GOERTZEL_GROUP];
+        for (int j = 0; j < GOERTZEL_GROUP; j++) {
+            coeff[j] = 2 * cos (2 * M_PI * (k + j) / fft_size);
+        }
+        double s1[GOERTZEL_GROUP] = {0};
+        double s2[GOERTZEL_GROUP] = {0};
+#ifdef __SSE2__
+        // four independent recurrences of two bins each hide the latency of the chain
+        __m128d c[4], a[4], b[4];
+        for (int j = 0; j < 4; j++) {
+            c[j] = _mm_loadu_pd (coeff + 2*j);
+            a[j] = _mm_setzero_pd ();
+            b[j] = _mm_setzero_pd ();
+        }
+        for (int i = 0; i < fft_size; i++) {
+            const __m128d x = _mm_set1_pd (in[i]);
+            for (int j = 0; j < 4; j++) {
+                const __m128d s = _mm_add_pd (_mm_sub_pd (x, b[j]), _mm_mul_pd (c[j], a[j]));
+                b[j] = a[j];
+                a[j] = s;
+            }
+        }
+        for (int j = 0; j < 4; j++) {
+            _mm_storeu_pd (s1 + 2*j, a[j]);
+            _mm_storeu_pd (s2 + 2*j, b[j]);
+        }
+#else
+        for (int i = 0; i < fft_size; i++) {
+            for (int j = 0; j < GOERTZEL_GROUP; j++) {
+                const double s = (in[i] - s2[j]) + coeff[j] * s1[j];
+                s2[j] = s1[j];
+                s1[j] = s;
+            }
+        }
+#endif
+        for (int j = 0; j < GOERTZEL_GROUP && k + j <= last_bin; j++) {
+            spectrum[k + j] = s1[j] * s1[j] + s2[j] * s2[j] - coeff[j] * s1[j] * s2[j];
+        }
+    }
+}
+
+// Estimated per sample cost of the transform is log2 (fft_size).
+static int
+dsp_goertzel_cheaper (int fft_size, int bins)
+{
+    const int groups = (bins + GOERTZEL_GROUP - 1) / GOERTZEL_GROUP;
+    int stages = 0;
+    while ((1 << stages) < fft_size) {
+        stages++;
+    }
+    return groups * GOERTZEL_GROUP * GOERTZEL_COST < stages;
+}
+
+void
+dsp_fft_range (const double *samples, int start, const double *window, double *fft_in, fftw_complex *fft_out, fftw_plan plan, double *spectrum, int fft_size, int howmany, int first_bin, int last_bin)
+{
+    first_bin = MAX (first_bin, 0);
+    last_bin = MIN (last_bin, fft_size/2 - 1);
+    if (first_bin > last_bin) {
+        return;
+    }
+    dsp_apply_window (samples, start, window, fft_in, fft_size, howmany);
+    if (dsp_goertzel_cheaper (fft_size, last_bin - first_bin + 1)) {
+        const int bins = fft_size/2 + 1;
+        for (int c = 0; c < howmany; c++) {
+            dsp_goertzel (fft_in + c * fft_size, fft_size, first_bin, last_bin, spectrum + c * bins);
+        }
+        return;
+    }
+    fftw_execute (plan);
+    dsp_power_spectrum (fft_out, spectrum, fft_size, howmany, first_bin, last_bin);
+}
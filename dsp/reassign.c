@@ -0,0 +1,137 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+
+// Frequency reassignment: a second transform with the derivative of the window gives the
+// instantaneous frequency of every bin, so a tone between two bins can be told apart
+// from its neighbours in the low resolution region where several bands share one bin.
+
+#include <math.h>
+
+#include "dsp.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef CLAMP
+#define CLAMP(x,low,high) (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
+#endif
+
+void
+dsp_window_derivative (const double *window, double *deriv, int fft_size)
+{
+    // central differences, the window is 0 outside of the table
+    for (int i = 0; i < fft_size; i++) {
+        const double prev = i > 0 ? window[i-1] : 0;
+        const double next = i < fft_size - 1 ? window[i+1] : 0;
+        deriv[i] = (next - prev) / 2;
+    }
+}
+
+void
+dsp_fft_reassign (const double *samples, int start, const double *window, const double *deriv, double *fft_in, fftw_complex *fft_out, fftw_plan plan,
+        double *deriv_in, fftw_complex *deriv_out, fftw_plan deriv_plan, double *spectrum, float *freq, int fft_size, int howmany, int samplerate,
+        int first_bin, int last_bin)
+{
+    first_bin = MAX (first_bin, 0);
+    last_bin = MIN (last_bin, fft_size/2 - 1);
+    if (first_bin > last_bin) {
+        return;
+    }
+    dsp_apply_window (samples, start, window, fft_in, fft_size, howmany);
+    dsp_apply_window (samples, start, deriv, deriv_in, fft_size, howmany);
+    fftw_execute (plan);
+    fftw_execute (deriv_plan);
+    dsp_power_spectrum (fft_out, spectrum, fft_size, howmany, first_bin, last_bin);
+
+    const int bins = fft_size/2 + 1;
+    const double bin_width = samplerate / (double)fft_size;
+    // the derivative window shifts the phase by the offset of the tone from the bin center
+    const double scale = fft_size / (2 * M_PI);
+    for (int c = 0; c < howmany; c++) {
+        const fftw_complex *x = fft_out + c * bins;
+        const fftw_complex *d = deriv_out + c * bins;
+        const double *power = spectrum + c * bins;
+        float *f = freq + c * bins;
+        for (int k = first_bin; k <= last_bin; k++) {
+            double offset = 0;
+            if (power[k] > 0) {
+                // Im (D conj (X)) / |X|^2
+                offset = (d[k][1] * x[k][0] - d[k][0] * x[k][1]) / power[k] * scale;
+            }
+            f[k] = (k - CLAMP (offset, -fft_size/2, fft_size/2)) * bin_width;
+        }
+    }
+}
+
+// Index of the band of freq whose edges, the geometric means with its neighbours, enclose f,
+// -1 if it lies outside all of them.
+static int
+dsp_reassigned_band (const float *freq, int bands, float f)
+{
+    if (bands < 1 || f <= 0) {
+        return -1;
+    }
+    int low = 0;
+    int high = bands - 1;
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (f < sqrtf (freq[mid] * freq[mid+1])) {
+            high = mid;
+        }
+        else {
+            low = mid + 1;
+        }
+    }
+    // the outer edges mirror the inner ones
+    const float ratio = bands > 1 ? sqrtf (freq[1] / freq[0]) : 1;
+    const float upper = low < bands - 1 ? sqrtf (freq[low] * freq[low+1]) : freq[low] * ratio;
+    if (f >= upper || f < freq[0] / ratio) {
+        return -1;
+    }
+    return low;
+}
+
+void
+dsp_map_reassigned (const double *spectrum, const float *bin_freq, int first_bin, int last_bin, const float *freq, int bands, float offset, float db_range, float *values)
+{
+    for (int i = 0; i < bands; i++) {
+        values[i] = 0;
+    }
+    // values hold the power of the loudest bin in each band until they are converted
+    for (int k = first_bin; k <= last_bin; k++) {
+        const int band = dsp_reassigned_band (freq, bands, bin_freq[k]);
+        if (band >= 0) {
+            values[band] = MAX (values[band], spectrum[k]);
+        }
+    }
+    for (int i = 0; i < bands; i++) {
+        const float x = values[i] > 0 ? 10 * log10f (values[i]) + offset : 0;
+        values[i] = CLAMP (x, 0, db_range);
+    }
+}
@@ -0,0 +1,328 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+// Sliding DFT: every band keeps the DFT of its own window of the newest samples,
+// updated with each input sample, so reading the spectrum doesn't transform anything.
+// The bands sit at the centers 440 * 2^(k/bands_per_octave) Hz, a band of
+// frequency f has a window of Q*samplerate/f samples, Q from the band spacing, which
+// makes the resolution constant-Q. Three resonators per band at f and
+// one bin of its window to either side give the Hann windowed value.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dsp.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef CLAMP
+#define CLAMP(x,low,high) (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
+#endif
+
+// concert pitch, the bands include the notes of the default bars
+#define SLIDING_REFERENCE 440.0
+// resonators per band: at the band and one bin below and above
+#define SLIDING_RESONATORS 3
+// shortest window, keeps the bands above a few kHz from turning into single samples
+#define SLIDING_MIN_LENGTH 16
+// samples added to the history at once, the bands then run over them one after another
+#define SLIDING_BLOCK 256
+// decay per sample, rounding errors in the states fade instead of piling up
+#define SLIDING_DAMPING 0.9999999
+
+typedef struct {
+    // re, im: state of every resonator, resonator r of band b at r*stride + b
+    double *re;
+    double *im;
+    // history: ring of the newest samples, history_size is a power of 2
+    double *history;
+    int pos;
+    // power: of every band after dsp_sliding_update
+    double *power;
+} sliding_channel_t;
+
+struct dsp_sliding_s {
+    int bands;
+    int bands_per_octave;
+    // first: index k of the band center 440 * 2^(k/bands_per_octave) of band 0
+    int first;
+    // stride: bands rounded up to an even count, the vector loops run two at once
+    int stride;
+    int channels;
+    int history_size;
+    // length: window of every band, the delay of its comb
+    int *length;
+    // c_re, c_im: rotation of every resonator per sample, d_re, d_im: factor of the sample
+    // leaving the window of every band, the same for its resonators as they are whole
+    // bins apart. Both include the damping.
+    double *c_re;
+    double *c_im;
+    double *d_re;
+    double *d_im;
+    // scale: normalizes the power of every band, a full scale sine reads 1
+    double *scale;
+    sliding_channel_t channel[DSP_MAX_CHANNELS];
+};
+
+void
+dsp_sliding_free (dsp_sliding_t *sd)
+{
+    if (!sd) {
+        return;
+    }
+    for (int c = 0; c < sd->channels; c++) {
+        free (sd->channel[c].re);
+        free (sd->channel[c].im);
+        free (sd->channel[c].history);
+        free (sd->channel[c].power);
+    }
+    free (sd->length);
+    free (sd->c_re);
+    free (sd->c_im);
+    free (sd->d_re);
+    free (sd->d_im);
+    free (sd->scale);
+    free (sd);
+}
+
+dsp_sliding_t *
+dsp_sliding_new (int samplerate, float min_freq, float max_freq, int bands_per_octave, int max_length, int channels)
+{
+    dsp_sliding_t *sd = calloc (1, sizeof (dsp_sliding_t));
+    if (!sd) {
+        return NULL;
+    }
+    const double b = CLAMP (bands_per_octave, 1, DSP_MAX_BANDS_PER_OCTAVE);
+    const double step = pow (2, 1 / b);
+    min_freq = MAX (min_freq, 1);
+    // the resonator one bin above the last band stays below Nyquist
+    const int first = ceil (b * log2 (min_freq / SLIDING_REFERENCE));
+    const int nyquist = floor (b * log2 (0.5 * samplerate / step / SLIDING_REFERENCE) - 1e-9);
+    const int last = MAX (MIN ((int)floor (b * log2 (max_freq / SLIDING_REFERENCE)), nyquist), first);
+    const int bands = last - first + 1;
+    sd->bands_per_octave = b;
+    sd->first = first;
+    sd->bands = bands;
+    sd->stride = (bands + 1) & ~1;
+    sd->channels = CLAMP (channels, 1, DSP_MAX_CHANNELS);
+    max_length = MAX (max_length, SLIDING_MIN_LENGTH);
+    sd->history_size = 1;
+    while (sd->history_size < max_length + SLIDING_BLOCK) {
+        sd->history_size <<= 1;
+    }
+
+    const int size = SLIDING_RESONATORS * sd->stride;
+    sd->length = calloc (sd->stride, sizeof (int));
+    sd->c_re = calloc (size, sizeof (double));
+    sd->c_im = calloc (size, sizeof (double));
+    sd->d_re = calloc (sd->stride, sizeof (double));
+    sd->d_im = calloc (sd->stride, sizeof (double));
+    sd->scale = calloc (sd->stride, sizeof (double));
+    int ok = sd->length && sd->c_re && sd->c_im && sd->d_re && sd->d_im && sd->scale;
+    for (int c = 0; ok && c < sd->channels; c++) {
+        sliding_channel_t *ch = &sd->channel[c];
+        ch->re = calloc (size, sizeof (double));
+        ch->im = calloc (size, sizeof (double));
+        ch->history = calloc (sd->history_size, sizeof (double));
+        ch->power = calloc (bands, sizeof (double));
+        ok = ch->re && ch->im && ch->history && ch->power;
+    }
+    if (!ok) {
+        dsp_sliding_free (sd);
+        return NULL;
+    }
+
+    for (int i = 0; i < bands; i++) {
+        // the bin width of the window matches the distance to the next band
+        const double freq = SLIDING_REFERENCE * pow (2, (first + i) / b);
+        const int length = CLAMP ((int)(samplerate / (freq * (step - 1))), SLIDING_MIN_LENGTH, max_length);
+        sd->length[i] = length;
+        // Hann: 0.5 X(f) - 0.25 X(f - bin) - 0.25 X(f + bin), its sum is length/2
+        sd->scale[i] = 16.0 / ((double)length * length);
+        const double w = 2 * M_PI * freq / samplerate;
+        const double decay = pow (SLIDING_DAMPING, length);
+        sd->d_re[i] = decay * cos (w * length);
+        sd->d_im[i] = decay * -sin (w * length);
+        for (int r = 0; r < SLIDING_RESONATORS; r++) {
+            const int j = r * sd->stride + i;
+            sd->c_re[j] = SLIDING_DAMPING * cos (w + 2 * M_PI * (r - 1) / length);
+            sd->c_im[j] = SLIDING_DAMPING * -sin (w + 2 * M_PI * (r - 1) / length);
+        }
+    }
+    return sd;
+}
+
+int
+dsp_sliding_bands (const dsp_sliding_t *sd)
+{
+    return sd->bands;
+}
+
+int
+dsp_sliding_band (const dsp_sliding_t *sd, float freq)
+{
+    if (!(freq > 0)) {
+        return -1;
+    }
+    const int i = (int)lrint (sd->bands_per_octave * log2 (freq / SLIDING_REFERENCE)) - sd->first;
+    return i >= 0 && i < sd->bands ? i : -1;
+}
+
+void
+dsp_sliding_reset (dsp_sliding_t *sd)
+{
+    const int size = SLIDING_RESONATORS * sd->stride;
+    for (int c = 0; c < sd->channels; c++) {
+        sliding_channel_t *ch = &sd->channel[c];
+        memset (ch->re, 0, size * sizeof (double));
+        memset (ch->im, 0, size * sizeof (double));
+        memset (ch->history, 0, sd->history_size * sizeof (double));
+        memset (ch->power, 0, sd->bands * sizeof (double));
+        ch->pos = 0;
+    }
+}
+
+#ifdef __SSE2__
+// X = c*X + in for a resonator of two bands.
+static inline void
+sliding_rotate (__m128d *re, __m128d *im, __m128d cr, __m128d ci, __m128d in_re, __m128d in_im)
+{
+    const __m128d r = *re;
+    *re = _mm_add_pd (in_re, _mm_sub_pd (_mm_mul_pd (cr, r), _mm_mul_pd (ci, *im)));
+    *im = _mm_add_pd (in_im, _mm_add_pd (_mm_mul_pd (cr, *im), _mm_mul_pd (ci, r)));
+}
+#endif
+
+// Runs the resonators of bands b and b+1 over the n samples of the history from pos on.
+static void
+sliding_run (const dsp_sliding_t *sd, sliding_channel_t *ch, int b, int pos, int n)
+{
+    const int s = sd->stride;
+    const int mask = sd->history_size - 1;
+    const double *h = ch->history;
+    const int l0 = sd->length[b];
+    const int l1 = sd->length[b+1];
+#ifdef __SSE2__
+    // named rather than arrays, they stay in registers
+    __m128d re0 = _mm_loadu_pd (ch->re + b);
+    __m128d im0 = _mm_loadu_pd (ch->im + b);
+    __m128d re1 = _mm_loadu_pd (ch->re + s + b);
+    __m128d im1 = _mm_loadu_pd (ch->im + s + b);
+    __m128d re2 = _mm_loadu_pd (ch->re + 2*s + b);
+    __m128d im2 = _mm_loadu_pd (ch->im + 2*s + b);
+    const __m128d cr0 = _mm_loadu_pd (sd->c_re + b);
+    const __m128d ci0 = _mm_loadu_pd (sd->c_im + b);
+    const __m128d cr1 = _mm_loadu_pd (sd->c_re + s + b);
+    const __m128d ci1 = _mm_loadu_pd (sd->c_im + s + b);
+    const __m128d cr2 = _mm_loadu_pd (sd->c_re + 2*s + b);
+    const __m128d ci2 = _mm_loadu_pd (sd->c_im + 2*s + b);
+    const __m128d dr = _mm_loadu_pd (sd->d_re + b);
+    const __m128d di = _mm_loadu_pd (sd->d_im + b);
+    for (int i = pos; i < pos + n; i++) {
+        const __m128d old = _mm_set_pd (h[(i - l1) & mask], h[(i - l0) & mask]);
+        // the terms without the state, they stay off the dependency chains
+        const __m128d in_re = _mm_sub_pd (_mm_set1_pd (h[i & mask]), _mm_mul_pd (dr, old));
+        const __m128d in_im = _mm_sub_pd (_mm_setzero_pd (), _mm_mul_pd (di, old));
+        sliding_rotate (&re0, &im0, cr0, ci0, in_re, in_im);
+        sliding_rotate (&re1, &im1, cr1, ci1, in_re, in_im);
+        sliding_rotate (&re2, &im2, cr2, ci2, in_re, in_im);
+    }
+    _mm_storeu_pd (ch->re + b, re0);
+    _mm_storeu_pd (ch->im + b, im0);
+    _mm_storeu_pd (ch->re + s + b, re1);
+    _mm_storeu_pd (ch->im + s + b, im1);
+    _mm_storeu_pd (ch->re + 2*s + b, re2);
+    _mm_storeu_pd (ch->im + 2*s + b, im2);
+#else
+    for (int k = 0; k < 2; k++) {
+        const int l = k ? l1 : l0;
+        for (int r = 0; r < SLIDING_RESONATORS; r++) {
+            const int j = r * s + b + k;
+            const double cr = sd->c_re[j], ci = sd->c_im[j], dr = sd->d_re[b+k], di = sd->d_im[b+k];
+            double re = ch->re[j], im = ch->im[j];
+            for (int i = pos; i < pos + n; i++) {
+                const double old = h[(i - l) & mask];
+                const double nr = h[i & mask] - dr * old + cr * re - ci * im;
+                im = cr * im + ci * re - di * old;
+                re = nr;
+            }
+            ch->re[j] = re;
+            ch->im[j] = im;
+        }
+    }
+#endif
+}
+
+void
+dsp_sliding_feed (dsp_sliding_t *sd, int channel, const double *samples, int n)
+{
+    if (channel < 0 || channel >= sd->channels) {
+        return;
+    }
+    sliding_channel_t *ch = &sd->channel[channel];
+    const int mask = sd->history_size - 1;
+    while (n > 0) {
+        // a block is added to the history before the bands run over it, the history holds
+        // the longest window behind it
+        const int sz = MIN (n, SLIDING_BLOCK);
+        for (int i = 0; i < sz; i++) {
+            ch->history[(ch->pos + i) & mask] = samples[i];
+        }
+        for (int b = 0; b < sd->stride; b += 2) {
+            sliding_run (sd, ch, b, ch->pos, sz);
+        }
+        ch->pos = (ch->pos + sz) & mask;
+        samples += sz;
+        n -= sz;
+    }
+}
+
+void
+dsp_sliding_update (dsp_sliding_t *sd)
+{
+    const int s = sd->stride;
+    for (int c = 0; c < sd->channels; c++) {
+        sliding_channel_t *ch = &sd->channel[c];
+        for (int b = 0; b < sd->bands; b++) {
+            const double re = 0.5 * ch->re[s + b] - 0.25 * (ch->re[b] + ch->re[2*s + b]);
+            const double im = 0.5 * ch->im[s + b] - 0.25 * (ch->im[b] + ch->im[2*s + b]);
+            ch->power[b] = (re * re + im * im) * sd->scale[b];
+        }
+    }
+}
+
+const double *
+dsp_sliding_power (const dsp_sliding_t *sd, int channel)
+{
+    return sd->channel[CLAMP (channel, 0, sd->channels - 1)].power;
+}
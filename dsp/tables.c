@@ -0,0 +1,193 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dsp.h"
+
+// tables: all cached tables, guarded by tables_lock, which is only held for
+// lookups and list updates, tables are built outside of it
+static dsp_band_table_t *tables = NULL;
+static char tables_lock;
+static uint64_t tables_clock;
+
+static void
+dsp_band_tables_lock (void)
+{
+    while (__atomic_test_and_set (&tables_lock, __ATOMIC_ACQUIRE));
+}
+
+static void
+dsp_band_tables_unlock (void)
+{
+    __atomic_clear (&tables_lock, __ATOMIC_RELEASE);
+}
+
+static void
+dsp_band_table_free (dsp_band_table_t *table)
+{
+    free (table->freq);
+    free (table->keys);
+    free (table);
+}
+
+// with the lock held
+static dsp_band_table_t *
+dsp_band_table_find (int samplerate, int fft_size, int num_bars, float min_freq, float max_freq, int zoom)
+{
+    for (dsp_band_table_t *t = tables; t; t = t->next) {
+        if (t->samplerate == samplerate && t->fft_size == fft_size && t->num_bars == num_bars
+                && t->min_freq == min_freq && t->max_freq == max_freq && t->zoom == zoom) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+// with the lock held, frees the least recently used unreferenced tables beyond the cache size
+static void
+dsp_band_tables_trim (void)
+{
+    for (;;) {
+        int unused = 0;
+        dsp_band_table_t **oldest = NULL;
+        for (dsp_band_table_t **p = &tables; *p; p = &(*p)->next) {
+            if ((*p)->refcount == 0) {
+                unused++;
+                if (!oldest || (*p)->last_used < (*oldest)->last_used) {
+                    oldest = p;
+                }
+            }
+        }
+        if (unused <= DSP_BAND_TABLE_CACHE_SIZE) {
+            return;
+        }
+        dsp_band_table_t *t = *oldest;
+        *oldest = t->next;
+        dsp_band_table_free (t);
+    }
+}
+
+static dsp_band_table_t *
+dsp_band_table_new (int samplerate, int fft_size, int num_bars, float min_freq, float max_freq, int zoom)
+{
+    dsp_band_table_t *table = calloc (1, sizeof (dsp_band_table_t));
+    if (!table) {
+        return NULL;
+    }
+    table->samplerate = samplerate;
+    table->fft_size = fft_size;
+    table->num_bars = num_bars;
+    table->min_freq = min_freq;
+    table->max_freq = max_freq;
+    table->zoom = zoom;
+    table->freq = calloc (num_bars + 1, sizeof (float));
+    table->keys = calloc (num_bars + 1, sizeof (int));
+    if (!table->freq || !table->keys) {
+        dsp_band_table_free (table);
+        return NULL;
+    }
+
+    // the band frequencies don't depend on samplerate and fft size, reuse them if possible
+    int have_freq = 0;
+    dsp_band_tables_lock ();
+    for (dsp_band_table_t *t = tables; t; t = t->next) {
+        if (t->num_bars == num_bars && t->min_freq == min_freq && t->max_freq == max_freq) {
+            memcpy (table->freq, t->freq, num_bars * sizeof (float));
+            have_freq = 1;
+            break;
+        }
+    }
+    dsp_band_tables_unlock ();
+    if (!have_freq) {
+        dsp_band_frequencies (table->freq, num_bars, min_freq, max_freq);
+    }
+    float base_freq, bin_width;
+    if (zoom && dsp_zoom_grid (samplerate, min_freq, max_freq, fft_size, &base_freq, &bin_width) > 1) {
+        table->low_res_end = dsp_bin_table_grid (table->freq, table->keys, num_bars, base_freq, bin_width, fft_size - 1);
+    }
+    else {
+        table->low_res_end = dsp_bin_table (table->freq, table->keys, num_bars, fft_size, samplerate);
+    }
+    return table;
+}
+
+const dsp_band_table_t *
+dsp_band_table_acquire (int samplerate, int fft_size, int num_bars, float min_freq, float max_freq, int zoom)
+{
+    dsp_band_tables_lock ();
+    dsp_band_table_t *table = dsp_band_table_find (samplerate, fft_size, num_bars, min_freq, max_freq, zoom);
+    if (table) {
+        table->refcount++;
+        table->last_used = ++tables_clock;
+        dsp_band_tables_unlock ();
+        return table;
+    }
+    dsp_band_tables_unlock ();
+
+    dsp_band_table_t *new_table = dsp_band_table_new (samplerate, fft_size, num_bars, min_freq, max_freq, zoom);
+    if (!new_table) {
+        return NULL;
+    }
+
+    dsp_band_tables_lock ();
+    // another thread may have built the same table meanwhile
+    table = dsp_band_table_find (samplerate, fft_size, num_bars, min_freq, max_freq, zoom);
+    if (!table) {
+        table = new_table;
+        new_table = NULL;
+        table->next = tables;
+        tables = table;
+    }
+    table->refcount++;
+    table->last_used = ++tables_clock;
+    dsp_band_tables_unlock ();
+
+    if (new_table) {
+        dsp_band_table_free (new_table);
+    }
+    return table;
+}
+
+void
+dsp_band_table_release (const dsp_band_table_t *table)
+{
+    if (!table) {
+        return;
+    }
+    dsp_band_tables_lock ();
+    ((dsp_band_table_t *)table)->refcount--;
+    dsp_band_tables_trim ();
+    dsp_band_tables_unlock ();
+}
+
+void
+dsp_band_table_prefetch (const int *samplerates, int count, int fft_size, int num_bars, float min_freq, float max_freq, int zoom)
+{
+    for (int i = 0; i < count; i++) {
+        dsp_band_table_release (dsp_band_table_acquire (samplerates[i], fft_size, num_bars, min_freq, max_freq, zoom));
+    }
+}
@@ -0,0 +1,361 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+
+// Multitaper estimation: the power spectrum is averaged over the transforms of one block
+// with several orthogonal tapers, the discrete prolate spheroidal sequences. Their spectra
+// are nearly independent, so the average has a fraction of the variance of a single
+// window at the same resolution. Taper sets are generated once and cached like windows.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dsp.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+// bisection steps of an eigenvalue, enough for double precision
+#define DPSS_BISECTIONS 64
+#define DPSS_INVERSE_ITERATIONS 3
+
+// tapers: all cached taper sets, guarded by tapers_lock like the windows
+static dsp_tapers_t *tapers = NULL;
+static char tapers_lock;
+static uint64_t tapers_clock;
+
+static void
+dsp_tapers_lock (void)
+{
+    while (__atomic_test_and_set (&tapers_lock, __ATOMIC_ACQUIRE));
+}
+
+static void
+dsp_tapers_unlock (void)
+{
+    __atomic_clear (&tapers_lock, __ATOMIC_RELEASE);
+}
+
+// Number of eigenvalues below x of the symmetric tridiagonal matrix with diagonal d and
+// off-diagonal e, by the Sturm sequence.
+static int
+dpss_count_below (const double *d, const double *e, int n, double x)
+{
+    int count = 0;
+    double q = d[0] - x;
+    for (int i = 0; ; i++) {
+        if (q < 0) {
+            count++;
+        }
+        if (i == n - 1) {
+            return count;
+        }
+        if (q == 0) {
+            q = 1e-300;
+        }
+        q = d[i+1] - x - e[i] * e[i] / q;
+    }
+}
+
+// Solves (T - x) y = b in place for the tridiagonal matrix T, c is scratch of n entries.
+static void
+dpss_solve (const double *d, const double *e, int n, double x, double *b, double *c)
+{
+    double pivot = d[0] - x;
+    for (int i = 0; ; i++) {
+        // a singular pivot only scales the eigenvector
+        if (fabs (pivot) < 1e-300) {
+            pivot = 1e-300;
+        }
+        if (i == n - 1) {
+            b[i] /= pivot;
+            break;
+        }
+        c[i] = e[i] / pivot;
+        b[i] /= pivot;
+        pivot = d[i+1] - x - e[i] * c[i];
+        b[i+1] -= e[i] * b[i];
+    }
+    for (int i = n - 2; i >= 0; i--) {
+        b[i] -= c[i] * b[i+1];
+    }
+}
+
+static void
+dpss_normalize (double *v, int n)
+{
+    double energy = 0;
+    for (int i = 0; i < n; i++) {
+        energy += v[i] * v[i];
+    }
+    const double scale = energy > 0 ? 1 / sqrt (energy) : 0;
+    for (int i = 0; i < n; i++) {
+        v[i] *= scale;
+    }
+}
+
+int
+dsp_dpss (double *table, int size, int count, double bandwidth)
+{
+    // the tapers are the eigenvectors of the largest eigenvalues of a tridiagonal matrix
+    // commuting with the concentration problem (Slepian 1978)
+    double *d = malloc (size * sizeof (double));
+    double *e = malloc (size * sizeof (double));
+    double *c = malloc (size * sizeof (double));
+    if (!d || !e || !c) {
+        free (d);
+        free (e);
+        free (c);
+        return -1;
+    }
+    const double w = cos (2 * M_PI * bandwidth / size);
+    double low = 0;
+    double high = 0;
+    for (int i = 0; i < size; i++) {
+        const double x = (size - 1 - 2 * i) / 2.0;
+        d[i] = x * x * w;
+        e[i] = i < size - 1 ? (i + 1) * (double)(size - 1 - i) / 2 : 0;
+    }
+    // Gershgorin bounds of the spectrum
+    for (int i = 0; i < size; i++) {
+        const double r = e[i] + (i > 0 ? e[i-1] : 0);
+        low = i ? MIN (low, d[i] - r) : d[i] - r;
+        high = i ? MAX (high, d[i] + r) : d[i] + r;
+    }
+    for (int k = 0; k < count; k++) {
+        // eigenvalue size-1-k in ascending order
+        const int index = size - 1 - k;
+        double a = low;
+        double b = high;
+        for (int i = 0; i < DPSS_BISECTIONS; i++) {
+            const double mid = (a + b) / 2;
+            if (dpss_count_below (d, e, size, mid) > index) {
+                b = mid;
+            }
+            else {
+                a = mid;
+            }
+        }
+        const double lambda = (a + b) / 2;
+        double *v = table + k * size;
+        for (int i = 0; i < size; i++) {
+            // any start with a component along the eigenvector
+            v[i] = 1 + 0.5 * sin (i * 12.9898);
+        }
+        for (int it = 0; it < DPSS_INVERSE_ITERATIONS; it++) {
+            dpss_solve (d, e, size, lambda, v, c);
+            // keep clear of the previous tapers, their eigenvalues are close for large sizes
+            for (int j = 0; j < k; j++) {
+                const double *u = table + j * size;
+                double dot = 0;
+                for (int i = 0; i < size; i++) {
+                    dot += u[i] * v[i];
+                }
+                for (int i = 0; i < size; i++) {
+                    v[i] -= dot * u[i];
+                }
+            }
+            dpss_normalize (v, size);
+        }
+        // even tapers have a positive sum, odd ones a positive slope at the start
+        double sign = 0;
+        for (int i = 0; i < size; i++) {
+            sign += (k & 1 ? (size - 1 - 2 * i) : 1) * v[i];
+        }
+        if (sign < 0) {
+            for (int i = 0; i < size; i++) {
+                v[i] = -v[i];
+            }
+        }
+    }
+    free (d);
+    free (e);
+    free (c);
+    return 0;
+}
+
+static void
+dsp_tapers_free (dsp_tapers_t *t)
+{
+    if (t->table) {
+        fftw_free (t->table);
+    }
+    free (t);
+}
+
+// with the lock held
+static dsp_tapers_t *
+dsp_tapers_find (int size, int count, float bandwidth)
+{
+    for (dsp_tapers_t *t = tapers; t; t = t->next) {
+        if (t->size == size && t->count == count && t->bandwidth == bandwidth) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+// with the lock held, frees the least recently used unreferenced sets beyond the cache size
+static void
+dsp_tapers_trim (void)
+{
+    for (;;) {
+        int unused = 0;
+        dsp_tapers_t **oldest = NULL;
+        for (dsp_tapers_t **p = &tapers; *p; p = &(*p)->next) {
+            if ((*p)->refcount == 0) {
+                unused++;
+                if (!oldest || (*p)->last_used < (*oldest)->last_used) {
+                    oldest = p;
+                }
+            }
+        }
+        if (unused <= DSP_TAPERS_CACHE_SIZE) {
+            return;
+        }
+        dsp_tapers_t *t = *oldest;
+        *oldest = t->next;
+        dsp_tapers_free (t);
+    }
+}
+
+static dsp_tapers_t *
+dsp_tapers_new (int size, int count, float bandwidth)
+{
+    dsp_tapers_t *t = calloc (1, sizeof (dsp_tapers_t));
+    if (!t) {
+        return NULL;
+    }
+    t->size = size;
+    t->count = count;
+    t->bandwidth = bandwidth;
+    t->table = fftw_malloc (size * count * sizeof (double));
+    if (!t->table || dsp_dpss (t->table, size, count, bandwidth)) {
+        dsp_tapers_free (t);
+        return NULL;
+    }
+    // a full scale sine puts sum/2 into the magnitude of its bin with each taper
+    double power = 0;
+    for (int k = 0; k < count; k++) {
+        double sum = 0;
+        for (int i = 0; i < size; i++) {
+            sum += t->table[k * size + i];
+        }
+        power += sum * sum / 4;
+    }
+    t->correction = -10 * log10 (power / count);
+    return t;
+}
+
+const dsp_tapers_t *
+dsp_tapers_lookup (int size, int count, float bandwidth)
+{
+    dsp_tapers_lock ();
+    dsp_tapers_t *t = dsp_tapers_find (size, count, bandwidth);
+    if (t) {
+        t->refcount++;
+        t->last_used = ++tapers_clock;
+    }
+    dsp_tapers_unlock ();
+    return t;
+}
+
+const dsp_tapers_t *
+dsp_tapers_acquire (int size, int count, float bandwidth)
+{
+    dsp_tapers_lock ();
+    dsp_tapers_t *t = dsp_tapers_find (size, count, bandwidth);
+    if (t) {
+        t->refcount++;
+        t->last_used = ++tapers_clock;
+        dsp_tapers_unlock ();
+        return t;
+    }
+    dsp_tapers_unlock ();
+
+    dsp_tapers_t *new_tapers = dsp_tapers_new (size, count, bandwidth);
+    if (!new_tapers) {
+        return NULL;
+    }
+
+    dsp_tapers_lock ();
+    // another thread may have built the same set meanwhile
+    t = dsp_tapers_find (size, count, bandwidth);
+    if (!t) {
+        t = new_tapers;
+        new_tapers = NULL;
+        t->next = tapers;
+        tapers = t;
+    }
+    t->refcount++;
+    t->last_used = ++tapers_clock;
+    dsp_tapers_unlock ();
+
+    if (new_tapers) {
+        dsp_tapers_free (new_tapers);
+    }
+    return t;
+}
+
+void
+dsp_tapers_release (const dsp_tapers_t *t)
+{
+    if (!t) {
+        return;
+    }
+    dsp_tapers_lock ();
+    ((dsp_tapers_t *)t)->refcount--;
+    dsp_tapers_trim ();
+    dsp_tapers_unlock ();
+}
+
+void
+dsp_taper_average (const fftw_complex *fft_out, int stride, int count, double *spectrum, int fft_size, int howmany, int first_bin, int last_bin)
+{
+    first_bin = MAX (first_bin, 0);
+    last_bin = MIN (last_bin, fft_size/2 - 1);
+    const int bins = fft_size/2 + 1;
+    const double scale = 1.0 / count;
+    for (int c = 0; c < howmany; c++) {
+        double *spec = spectrum + c * bins;
+        for (int i = first_bin; i <= last_bin; i++) {
+            spec[i] = 0;
+        }
+        for (int k = 0; k < count; k++) {
+            const fftw_complex *out = fft_out + k * stride + c * bins;
+            for (int i = first_bin; i <= last_bin; i++) {
+                spec[i] += out[i][0] * out[i][0] + out[i][1] * out[i][1];
+            }
+        }
+        for (int i = first_bin; i <= last_bin; i++) {
+            spec[i] *= scale;
+        }
+    }
+}
@@ -0,0 +1,257 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+// Window functions. Tables are generated once per type, parameter and size and
+// shared between contexts, together with the gain figures used to calibrate levels.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dsp.h"
+
+#define DEFAULT_KAISER_BETA 8.6
+#define DEFAULT_GAUSSIAN_SIGMA 0.4
+
+// windows: all cached windows, guarded by windows_lock like the band tables
+static dsp_window_t *windows = NULL;
+static char windows_lock;
+static uint64_t windows_clock;
+
+// coefficients of the cosine sum windows, w(x) = a0 - a1 cos(x) + a2 cos(2x) - ...
+static const double hann[] = {0.5, 0.5};
+static const double hamming[] = {0.54, 0.46};
+static const double blackman_harris[] = {0.35875, 0.48829, 0.14128, 0.01168};
+static const double blackman_harris_7[] = {0.27105140069342, 0.43329793923448, 0.21812299954311, 0.06592544638803,
+                                           0.01081174209837, 0.00077658482522, 0.00001388721735};
+static const double nuttall[] = {0.355768, 0.487396, 0.144232, 0.012604};
+static const double flat_top[] = {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368};
+
+static double
+dsp_cosine_sum (const double *a, int terms, double x)
+{
+    double w = 0;
+    for (int k = 0; k < terms; k++) {
+        w += (k & 1 ? -a[k] : a[k]) * cos (k * x);
+    }
+    return w;
+}
+
+// modified Bessel function of the first kind, order 0
+static double
+dsp_bessel_i0 (double x)
+{
+    double sum = 1;
+    double term = 1;
+    for (int k = 1; k < 500 && term > sum * 1e-16; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+void
+dsp_window_table (double *window, int fft_size, int type, float param)
+{
+    // periodic windows are symmetric around fft_size/2, only the first half is computed
+    const int half = fft_size / 2;
+    for (int i = 0; i <= half; i++) {
+        const double x = 2 * M_PI * i / fft_size;
+        double w;
+        switch (type) {
+        case DSP_WINDOW_HANNING:
+            w = dsp_cosine_sum (hann, 2, x);
+            break;
+        case DSP_WINDOW_HAMMING:
+            w = dsp_cosine_sum (hamming, 2, x);
+            break;
+        case DSP_WINDOW_BLACKMAN_HARRIS_7:
+            w = dsp_cosine_sum (blackman_harris_7, 7, x);
+            break;
+        case DSP_WINDOW_NUTTALL:
+            w = dsp_cosine_sum (nuttall, 4, x);
+            break;
+        case DSP_WINDOW_FLAT_TOP:
+            w = dsp_cosine_sum (flat_top, 5, x);
+            break;
+        case DSP_WINDOW_KAISER: {
+            const double beta = param > 0 ? param : DEFAULT_KAISER_BETA;
+            const double r = (double)(i - half) / half;
+            w = dsp_bessel_i0 (beta * sqrt (1 - r * r)) / dsp_bessel_i0 (beta);
+            break;
+        }
+        case DSP_WINDOW_GAUSSIAN: {
+            const double sigma = param > 0 ? param : DEFAULT_GAUSSIAN_SIGMA;
+            const double r = (double)(i - half) / (sigma * half);
+            w = exp (-0.5 * r * r);
+            break;
+        }
+        default:
+            w = dsp_cosine_sum (blackman_harris, 4, x);
+            break;
+        }
+        window[i] = w;
+        if (i > 0 && i < fft_size - i) {
+            window[fft_size - i] = w;
+        }
+    }
+}
+
+static void
+dsp_windows_lock (void)
+{
+    while (__atomic_test_and_set (&windows_lock, __ATOMIC_ACQUIRE));
+}
+
+static void
+dsp_windows_unlock (void)
+{
+    __atomic_clear (&windows_lock, __ATOMIC_RELEASE);
+}
+
+static void
+dsp_window_free (dsp_window_t *window)
+{
+    if (window->table) {
+        fftw_free (window->table);
+    }
+    free (window);
+}
+
+// with the lock held
+static dsp_window_t *
+dsp_window_find (int type, float param, int size)
+{
+    for (dsp_window_t *w = windows; w; w = w->next) {
+        if (w->type == type && w->param == param && w->size == size) {
+            return w;
+        }
+    }
+    return NULL;
+}
+
+// with the lock held, frees the least recently used unreferenced windows beyond the cache size
+static void
+dsp_windows_trim (void)
+{
+    for (;;) {
+        int unused = 0;
+        dsp_window_t **oldest = NULL;
+        for (dsp_window_t **p = &windows; *p; p = &(*p)->next) {
+            if ((*p)->refcount == 0) {
+                unused++;
+                if (!oldest || (*p)->last_used < (*oldest)->last_used) {
+                    oldest = p;
+                }
+            }
+        }
+        if (unused <= DSP_WINDOW_CACHE_SIZE) {
+            return;
+        }
+        dsp_window_t *w = *oldest;
+        *oldest = w->next;
+        dsp_window_free (w);
+    }
+}
+
+static dsp_window_t *
+dsp_window_new (int type, float param, int size)
+{
+    dsp_window_t *window = calloc (1, sizeof (dsp_window_t));
+    if (!window) {
+        return NULL;
+    }
+    window->type = type;
+    window->param = param;
+    window->size = size;
+    // aligned for the windowing loop in front of the transform
+    window->table = fftw_malloc (size * sizeof (double));
+    if (!window->table) {
+        dsp_window_free (window);
+        return NULL;
+    }
+    dsp_window_table (window->table, size, type, param);
+
+    double sum = 0;
+    for (int i = 0; i < size; i++) {
+        sum += window->table[i];
+    }
+    // a full scale sine puts sum/2 into the magnitude of its bin
+    window->correction = -20 * log10 (sum / 2);
+    return window;
+}
+
+const dsp_window_t *
+dsp_window_acquire (int type, float param, int size)
+{
+    // the parameter only matters to the windows that have one
+    if (type != DSP_WINDOW_KAISER && type != DSP_WINDOW_GAUSSIAN) {
+        param = 0;
+    }
+    dsp_windows_lock ();
+    dsp_window_t *window = dsp_window_find (type, param, size);
+    if (window) {
+        window->refcount++;
+        window->last_used = ++windows_clock;
+        dsp_windows_unlock ();
+        return window;
+    }
+    dsp_windows_unlock ();
+
+    dsp_window_t *new_window = dsp_window_new (type, param, size);
+    if (!new_window) {
+        return NULL;
+    }
+
+    dsp_windows_lock ();
+    // another thread may have built the same window meanwhile
+    window = dsp_window_find (type, param, size);
+    if (!window) {
+        window = new_window;
+        new_window = NULL;
+        window->next = windows;
+        windows = window;
+    }
+    window->refcount++;
+    window->last_used = ++windows_clock;
+    dsp_windows_unlock ();
+
+    if (new_window) {
+        dsp_window_free (new_window);
+    }
+    return window;
+}
+
+void
+dsp_window_release (const dsp_window_t *window)
+{
+    if (!window) {
+        return;
+    }
+    dsp_windows_lock ();
+    ((dsp_window_t *)window)->refcount--;
+    dsp_windows_trim ();
+    dsp_windows_unlock ();
+}
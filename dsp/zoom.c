@@ -0,0 +1,298 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+
+// Zoom FFT: heterodyne, low-pass, decimate and a small complex transform. The filter
+// is a Blackman windowed sinc evaluated once per decimated sample, so it costs the
+// same per input sample for every decimation.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fftw3.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dsp.h"
+
+#ifndef MIN
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+// the decimated rate is kept this much above the bandwidth, the filter passes 0.4 and
+// stops 0.6 of the decimated rate, so nothing aliases into the band
+#define ZOOM_MARGIN 1.25f
+// filter taps per decimation step, sets the transition band, a multiple of 4
+#define ZOOM_TAPS 32
+// the oscillator is renormalized after every decimated sample
+#define ZOOM_RENORMALIZE(re, im) \
+    do { const double g = (3 - (re * re + im * im)) / 2; re *= g; im *= g; } while (0)
+
+typedef struct {
+    // history_re, history_im: the last taps mixed samples, each one is written twice so
+    // the newest taps of them are contiguous at pos
+    double *history_re;
+    double *history_im;
+    int pos;
+    // osc_re, osc_im: phase of the oscillator shifting the band down
+    double osc_re;
+    double osc_im;
+    // countdown: input samples until the next decimated one
+    int countdown;
+    // out: ring of the last fft_size decimated samples, the oldest at out_pos
+    fftw_complex *out;
+    int out_pos;
+} zoom_channel_t;
+
+struct dsp_zoom_s {
+    int fft_size;
+    int decimation;
+    int taps;
+    int channels;
+    // step_re, step_im: rotation of the oscillator per input sample
+    double step_re;
+    double step_im;
+    double *filter;
+    zoom_channel_t channel[DSP_MAX_CHANNELS];
+    fftw_complex *fft_in;
+    fftw_complex *fft_out;
+    fftw_plan plan;
+};
+
+int
+dsp_zoom_decimation (int samplerate, float min_freq, float max_freq, int fft_size)
+{
+    if (max_freq <= min_freq) {
+        return 1;
+    }
+    int decimation = MIN (samplerate / ((max_freq - min_freq) * ZOOM_MARGIN), DSP_MAX_ZOOM_DECIMATION);
+    decimation = MIN (decimation, DSP_MAX_ZOOM_SPAN / fft_size);
+    return MAX (decimation, 1);
+}
+
+int
+dsp_zoom_grid (int samplerate, float min_freq, float max_freq, int fft_size, float *base_freq, float *bin_width)
+{
+    const int decimation = dsp_zoom_decimation (samplerate, min_freq, max_freq, fft_size);
+    const float rate = samplerate / (float)decimation;
+    *base_freq = (min_freq + max_freq) / 2 - rate / 2;
+    *bin_width = rate / fft_size;
+    return decimation;
+}
+
+dsp_zoom_t *
+dsp_zoom_new (int samplerate, float min_freq, float max_freq, int fft_size, int channels)
+{
+    const int decimation = dsp_zoom_decimation (samplerate, min_freq, max_freq, fft_size);
+    if (decimation < 2) {
+        return NULL;
+    }
+    dsp_zoom_t *zoom = calloc (1, sizeof (dsp_zoom_t));
+    if (!zoom) {
+        return NULL;
+    }
+    zoom->fft_size = fft_size;
+    zoom->decimation = decimation;
+    zoom->taps = ZOOM_TAPS * decimation;
+    zoom->channels = MIN (channels, DSP_MAX_CHANNELS);
+    const double w = 2 * M_PI * (min_freq + max_freq) / 2 / samplerate;
+    zoom->step_re = cos (w);
+    zoom->step_im = -sin (w);
+
+    int ok = (zoom->filter = malloc (zoom->taps * sizeof (double))) != NULL;
+    for (int c = 0; ok && c < zoom->channels; c++) {
+        zoom_channel_t *ch = &zoom->channel[c];
+        ch->history_re = malloc (2 * zoom->taps * sizeof (double));
+        ch->history_im = malloc (2 * zoom->taps * sizeof (double));
+        ch->out = fftw_malloc (fft_size * sizeof (fftw_complex));
+        ok = ch->history_re && ch->history_im && ch->out;
+    }
+    if (ok) {
+        zoom->fft_in = fftw_malloc (fft_size * zoom->channels * sizeof (fftw_complex));
+        zoom->fft_out = fftw_malloc (fft_size * zoom->channels * sizeof (fftw_complex));
+    }
+    if (zoom->fft_in && zoom->fft_out) {
+        zoom->plan = dsp_fft_plan_complex_many (fft_size, zoom->channels, zoom->fft_in, zoom->fft_out);
+    }
+    if (!zoom->plan) {
+        dsp_zoom_free (zoom);
+        return NULL;
+    }
+
+    // low-pass at half the decimated rate, unity gain at 0 Hz
+    const double cutoff = 0.5 / decimation;
+    const double center = (zoom->taps - 1) / 2.0;
+    double sum = 0;
+    for (int i = 0; i < zoom->taps; i++) {
+        const double t = i - center;
+        const double sinc = t == 0 ? 1 : sin (2 * M_PI * cutoff * t) / (2 * M_PI * cutoff * t);
+        const double x = 2 * M_PI * i / (zoom->taps - 1);
+        zoom->filter[i] = sinc * (0.42 - 0.5 * cos (x) + 0.08 * cos (2 * x));
+        sum += zoom->filter[i];
+    }
+    for (int i = 0; i < zoom->taps; i++) {
+        zoom->filter[i] /= sum;
+    }
+    dsp_zoom_reset (zoom);
+    return zoom;
+}
+
+void
+dsp_zoom_free (dsp_zoom_t *zoom)
+{
+    if (!zoom) {
+        return;
+    }
+    if (zoom->plan) {
+        fftw_destroy_plan (zoom->plan);
+    }
+    for (int c = 0; c < zoom->channels; c++) {
+        free (zoom->channel[c].history_re);
+        free (zoom->channel[c].history_im);
+        if (zoom->channel[c].out) {
+            fftw_free (zoom->channel[c].out);
+        }
+    }
+    if (zoom->fft_in) {
+        fftw_free (zoom->fft_in);
+    }
+    if (zoom->fft_out) {
+        fftw_free (zoom->fft_out);
+    }
+    free (zoom->filter);
+    free (zoom);
+}
+
+void
+dsp_zoom_reset (dsp_zoom_t *zoom)
+{
+    for (int c = 0; c < zoom->channels; c++) {
+        zoom_channel_t *ch = &zoom->channel[c];
+        memset (ch->history_re, 0, 2 * zoom->taps * sizeof (double));
+        memset (ch->history_im, 0, 2 * zoom->taps * sizeof (double));
+        memset (ch->out, 0, zoom->fft_size * sizeof (fftw_complex));
+        ch->pos = 0;
+        ch->osc_re = 1;
+        ch->osc_im = 0;
+        ch->countdown = zoom->decimation;
+        ch->out_pos = 0;
+    }
+}
+
+// Filters taps samples, taps is a multiple of 4. Separate sums hide the latency of the additions.
+static inline void
+zoom_filter (const double *filter, const double *re, const double *im, int taps, fftw_complex out)
+{
+#ifdef __SSE2__
+    __m128d re0 = _mm_setzero_pd (), re1 = _mm_setzero_pd ();
+    __m128d im0 = _mm_setzero_pd (), im1 = _mm_setzero_pd ();
+    for (int t = 0; t < taps; t += 4) {
+        const __m128d f0 = _mm_loadu_pd (filter + t);
+        const __m128d f1 = _mm_loadu_pd (filter + t + 2);
+        re0 = _mm_add_pd (re0, _mm_mul_pd (f0, _mm_loadu_pd (re + t)));
+        re1 = _mm_add_pd (re1, _mm_mul_pd (f1, _mm_loadu_pd (re + t + 2)));
+        im0 = _mm_add_pd (im0, _mm_mul_pd (f0, _mm_loadu_pd (im + t)));
+        im1 = _mm_add_pd (im1, _mm_mul_pd (f1, _mm_loadu_pd (im + t + 2)));
+    }
+    double sum[4];
+    _mm_storeu_pd (sum, _mm_add_pd (re0, re1));
+    _mm_storeu_pd (sum + 2, _mm_add_pd (im0, im1));
+    out[0] = sum[0] + sum[1];
+    out[1] = sum[2] + sum[3];
+#else
+    double sum_re[4] = {0};
+    double sum_im[4] = {0};
+    for (int t = 0; t < taps; t += 4) {
+        for (int j = 0; j < 4; j++) {
+            sum_re[j] += filter[t + j] * re[t + j];
+            sum_im[j] += filter[t + j] * im[t + j];
+        }
+    }
+    out[0] = (sum_re[0] + sum_re[1]) + (sum_re[2] + sum_re[3]);
+    out[1] = (sum_im[0] + sum_im[1]) + (sum_im[2] + sum_im[3]);
+#endif
+}
+
+void
+dsp_zoom_feed (dsp_zoom_t *zoom, int channel, const double *samples, int n)
+{
+    if (channel < 0 || channel >= zoom->channels) {
+        return;
+    }
+    zoom_channel_t *ch = &zoom->channel[channel];
+    const int taps = zoom->taps;
+    double osc_re = ch->osc_re;
+    double osc_im = ch->osc_im;
+    for (int i = 0; i < n; i++) {
+        const double re = samples[i] * osc_re;
+        const double im = samples[i] * osc_im;
+        ch->history_re[ch->pos] = ch->history_re[ch->pos + taps] = re;
+        ch->history_im[ch->pos] = ch->history_im[ch->pos + taps] = im;
+        ch->pos = ch->pos + 1 < taps ? ch->pos + 1 : 0;
+        const double r = osc_re * zoom->step_re - osc_im * zoom->step_im;
+        osc_im = osc_re * zoom->step_im + osc_im * zoom->step_re;
+        osc_re = r;
+
+        if (--ch->countdown > 0) {
+            continue;
+        }
+        ch->countdown = zoom->decimation;
+        ZOOM_RENORMALIZE (osc_re, osc_im);
+        // the filter is symmetric, the oldest sample at pos meets its first tap
+        zoom_filter (zoom->filter, ch->history_re + ch->pos, ch->history_im + ch->pos, taps, ch->out[ch->out_pos]);
+        ch->out_pos = ch->out_pos + 1 < zoom->fft_size ? ch->out_pos + 1 : 0;
+    }
+    ch->osc_re = osc_re;
+    ch->osc_im = osc_im;
+}
+
+void
+dsp_zoom_transform (dsp_zoom_t *zoom, const double *window, double *spectrum)
+{
+    const int n = zoom->fft_size;
+    for (int c = 0; c < zoom->channels; c++) {
+        const zoom_channel_t *ch = &zoom->channel[c];
+        fftw_complex *in = zoom->fft_in + c * n;
+        // the ring is unrolled while the window is applied
+        for (int i = 0; i < n; i++) {
+            const int j = (ch->out_pos + i) % n;
+            in[i][0] = ch->out[j][0] * window[i];
+            in[i][1] = ch->out[j][1] * window[i];
+        }
+    }
+    fftw_execute (zoom->plan);
+    for (int c = 0; c < zoom->channels; c++) {
+        const fftw_complex *out = zoom->fft_out + c * n;
+        double *spec = spectrum + c * n;
+        // negative frequencies come first
+        for (int i = 0; i < n; i++) {
+            const fftw_complex *x = &out[(i + n/2) % n];
+            spec[i] = (*x)[0] * (*x)[0] + (*x)[1] * (*x)[1];
+        }
+    }
+}
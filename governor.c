@@ -0,0 +1,160 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "governor.h"
+
+#define MIN(a,b) (((a) < (b)) ? (a) : (b))
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+
+// smoothing factor of the load average
+#define LOAD_ALPHA 0.1f
+// time the load has to stay above budget before stepping down (ms)
+#define STEP_DOWN_DELAY 1000
+// time the load has to stay well below budget before stepping up (ms)
+#define STEP_UP_DELAY 3000
+// stepping a knob up roughly doubles its cost, so only do it below this share of the budget
+#define STEP_UP_HEADROOM 0.4f
+
+#define MIN_FFT_SIZE 512
+#define MIN_NUM_BARS 12
+
+static const char *knob_names[] = {"Refresh rate", "Overlap", "Bar count", "FFT size"};
+
+void
+governor_reset (governor_t *g)
+{
+    memset (g, 0, sizeof (governor_t));
+}
+
+const char *
+governor_knob_name (int knob)
+{
+    if (knob < 0 || knob >= NUM_KNOBS) {
+        return NULL;
+    }
+    return knob_names[knob];
+}
+
+static int
+governor_step_down (governor_t *g, const int *order)
+{
+    for (int i = 0; i < NUM_KNOBS; i++) {
+        const int knob = order[i];
+        if (g->level[knob] < GOVERNOR_MAX_LEVEL) {
+            g->level[knob]++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+governor_step_up (governor_t *g, const int *order)
+{
+    // restore in reverse priority, the knob turned down last comes back first
+    for (int i = NUM_KNOBS - 1; i >= 0; i--) {
+        const int knob = order[i];
+        if (g->level[knob] > 0) {
+            g->level[knob]--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Feeds the time spent on one frame (analysis + render, in us) into the governor.
+// budget is the allowed share of one core in percent. Returns 1 if any knob changed.
+int
+governor_update (governor_t *g, int64_t now, int64_t frame_time, int interval, int budget, const int *order)
+{
+    const int64_t nominal = (int64_t)governor_refresh_interval (g, interval) * 1000;
+    int64_t elapsed = nominal;
+    if (g->last_frame > 0) {
+        elapsed = MAX (now - g->last_frame, nominal);
+    }
+    g->last_frame = now;
+
+    const float load = (float)frame_time / elapsed;
+    g->load += LOAD_ALPHA * (load - g->load);
+
+    const float limit = budget / 100.f;
+    const int frames_per_s = MAX (1000 / governor_refresh_interval (g, interval), 1);
+
+    if (g->load > limit) {
+        g->under_frames = 0;
+        if (++g->over_frames >= frames_per_s * STEP_DOWN_DELAY / 1000) {
+            g->over_frames = 0;
+            return governor_step_down (g, order);
+        }
+    }
+    else if (g->load < limit * STEP_UP_HEADROOM) {
+        g->over_frames = 0;
+        if (++g->under_frames >= frames_per_s * STEP_UP_DELAY / 1000) {
+            g->under_frames = 0;
+            return governor_step_up (g, order);
+        }
+    }
+    else {
+        g->over_frames = 0;
+        g->under_frames = 0;
+    }
+    return 0;
+}
+
+int
+governor_refresh_interval (const governor_t *g, int interval)
+{
+    return interval << g->level[KNOB_REFRESH];
+}
+
+int
+governor_fft_size (const governor_t *g, int fft_size)
+{
+    return MAX (fft_size >> g->level[KNOB_FFT], MIN (fft_size, MIN_FFT_SIZE));
+}
+
+int
+governor_num_bars (const governor_t *g, int num_bars)
+{
+    return MAX (num_bars >> g->level[KNOB_BARS], MIN (num_bars, MIN_NUM_BARS));
+}
+
+// Each overlap step lowers the allowed overlap of consecutive FFT windows.
+int
+governor_max_overlap (const governor_t *g)
+{
+    static const int overlap[GOVERNOR_MAX_LEVEL + 1] = {100, 75, 50, 0};
+    return overlap[g->level[KNOB_OVERLAP]];
+}
+
+// Minimum number of new samples between two transforms.
+int
+governor_hop (const governor_t *g, int fft_size)
+{
+    return fft_size * (100 - governor_max_overlap (g)) / 100;
+}
@@ -0,0 +1,69 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef GOVERNOR_HEADER
+#define GOVERNOR_HEADER
+
+#include <stdint.h>
+
+enum GOVERNOR_KNOB { KNOB_REFRESH = 0, KNOB_OVERLAP = 1, KNOB_BARS = 2, KNOB_FFT = 3, NUM_KNOBS = 4 };
+
+// every knob can be turned down by this many steps, each step halves its cost
+#define GOVERNOR_MAX_LEVEL 3
+
+typedef struct {
+    // load: smoothed fraction of the frame interval spent in analysis and rendering
+    float load;
+    int64_t last_frame;
+    int over_frames;
+    int under_frames;
+    // level: number of steps each knob is currently turned down
+    int level[NUM_KNOBS];
+} governor_t;
+
+void
+governor_reset (governor_t *g);
+
+int
+governor_update (governor_t *g, int64_t now, int64_t frame_time, int interval, int budget, const int *order);
+
+int
+governor_refresh_interval (const governor_t *g, int interval);
+
+int
+governor_fft_size (const governor_t *g, int fft_size);
+
+int
+governor_num_bars (const governor_t *g, int num_bars);
+
+int
+governor_max_overlap (const governor_t *g);
+
+int
+governor_hop (const governor_t *g, int fft_size);
+
+const char *
+governor_knob_name (int knob);
+
+#endif
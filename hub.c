@@ -0,0 +1,246 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <deadbeef/deadbeef.h>
+
+#include "hub.h"
+#include "trace.h"
+
+#ifndef MAX
+#define MAX(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+extern DB_functions_t *deadbeef;
+
+// all hubs in use, only touched from the GUI thread
+static hub_t *hubs = NULL;
+
+static int
+hub_compatible (const dsp_config_t *a, const dsp_config_t *b)
+{
+    return a->fft_size == b->fft_size && a->window == b->window && a->window_param == b->window_param
+        && a->samplerate == b->samplerate && a->min_freq == b->min_freq && a->max_freq == b->max_freq
+        && a->zoom == b->zoom && a->engine == b->engine
+        && a->bands_per_octave == b->bands_per_octave && a->detector == b->detector && a->resolutions == b->resolutions
+        && a->reassign == b->reassign && a->tapers == b->tapers && a->time_bandwidth == b->time_bandwidth
+        && a->averaging == b->averaging && a->average_time == b->average_time && a->average_frames == b->average_frames
+        && a->channels == b->channels && (a->channels > 1 || a->downmix == b->downmix);
+}
+
+static void
+hub_lock (hub_t *hub)
+{
+    trace_begin ("mutex wait");
+    deadbeef->mutex_lock (hub->mutex);
+    trace_end ("mutex wait");
+}
+
+// taper set the newest hub waits for and whether hub_tapers_thread runs, guarded by tapers_lock
+static int tapers_size;
+static int tapers_count;
+static float tapers_bandwidth;
+static int tapers_running;
+static char tapers_lock;
+
+static void
+hub_tapers_lock (void)
+{
+    while (__atomic_test_and_set (&tapers_lock, __ATOMIC_ACQUIRE));
+}
+
+static void
+hub_tapers_unlock (void)
+{
+    __atomic_clear (&tapers_lock, __ATOMIC_RELEASE);
+}
+
+// Generates the wanted taper sets into the cache until no newer one is wanted, the hubs
+// pick them up on their next transform.
+static void
+hub_tapers_thread (void *ctx)
+{
+    for (;;) {
+        hub_tapers_lock ();
+        const int size = tapers_size;
+        const int count = tapers_count;
+        const float bandwidth = tapers_bandwidth;
+        hub_tapers_unlock ();
+
+        trace_begin ("tapers");
+        dsp_tapers_release (dsp_tapers_acquire (size, count, bandwidth));
+        trace_end ("tapers");
+
+        hub_tapers_lock ();
+        if (size == tapers_size && count == tapers_count && bandwidth == tapers_bandwidth) {
+            tapers_running = 0;
+            hub_tapers_unlock ();
+            return;
+        }
+        hub_tapers_unlock ();
+    }
+}
+
+// Starts generating the tapers of hub if it has to wait for them, outside of its lock
+// since that takes up to a second.
+static void
+hub_prefetch_tapers (hub_t *hub)
+{
+    hub_lock (hub);
+    const int missing = dsp_context_tapers_missing (hub->dsp);
+    const dsp_config_t config = *dsp_context_get_config (hub->dsp);
+    deadbeef->mutex_unlock (hub->mutex);
+    if (!missing) {
+        return;
+    }
+    hub_tapers_lock ();
+    tapers_size = config.fft_size;
+    tapers_count = config.tapers;
+    tapers_bandwidth = config.time_bandwidth;
+    const int start = !tapers_running;
+    tapers_running = 1;
+    hub_tapers_unlock ();
+    if (!start) {
+        return;
+    }
+    intptr_t tid = deadbeef->thread_start (hub_tapers_thread, NULL);
+    if (tid) {
+        deadbeef->thread_detach (tid);
+    }
+    else {
+        hub_tapers_lock ();
+        tapers_running = 0;
+        hub_tapers_unlock ();
+    }
+}
+
+static void
+hub_wavedata_listener (void *ctx, ddb_audio_data_t *data)
+{
+    hub_t *hub = ctx;
+
+    trace_begin ("audio callback");
+    hub_lock (hub);
+    // the first frames of a track at a new rate must not include the previous track
+    if (data->fmt->samplerate != hub->feed_samplerate) {
+        if (hub->feed_samplerate) {
+            dsp_context_reset (hub->dsp);
+        }
+        hub->feed_samplerate = data->fmt->samplerate;
+    }
+    dsp_context_feed (hub->dsp, data->data, data->nframes, data->fmt->channels);
+    deadbeef->mutex_unlock (hub->mutex);
+    trace_end ("audio callback");
+}
+
+static hub_t *
+hub_find (const dsp_config_t *config)
+{
+    for (hub_t *hub = hubs; hub; hub = hub->next) {
+        if (hub_compatible (dsp_context_get_config (hub->dsp), config)) {
+            return hub;
+        }
+    }
+    return NULL;
+}
+
+hub_t *
+hub_acquire (const dsp_config_t *config)
+{
+    hub_t *hub = hub_find (config);
+    if (hub) {
+        hub->refcount++;
+        return hub;
+    }
+
+    hub = calloc (1, sizeof (hub_t));
+    if (!hub) {
+        return NULL;
+    }
+    hub->dsp = dsp_context_new (config);
+    if (!hub->dsp || dsp_context_prepare (hub->dsp)) {
+        dsp_context_free (hub->dsp);
+        free (hub);
+        return NULL;
+    }
+    hub->mutex = deadbeef->mutex_create ();
+    hub->refcount = 1;
+    hub->next = hubs;
+    hubs = hub;
+    deadbeef->vis_waveform_listen (hub, hub_wavedata_listener);
+    hub_prefetch_tapers (hub);
+    return hub;
+}
+
+void
+hub_release (hub_t *hub)
+{
+    if (!hub || --hub->refcount > 0) {
+        return;
+    }
+    for (hub_t **p = &hubs; *p; p = &(*p)->next) {
+        if (*p == hub) {
+            *p = hub->next;
+            break;
+        }
+    }
+    deadbeef->vis_waveform_unlisten (hub);
+    dsp_context_free (hub->dsp);
+    deadbeef->mutex_free (hub->mutex);
+    free (hub);
+}
+
+hub_t *
+hub_update (hub_t *hub, const dsp_config_t *config)
+{
+    if (hub && hub_compatible (dsp_context_get_config (hub->dsp), config)) {
+        return hub;
+    }
+    if (hub && hub->refcount == 1 && !hub_find (config)) {
+        // keeps the buffered audio, so the spectrum doesn't restart from silence
+        hub_lock (hub);
+        dsp_context_configure (hub->dsp, config);
+        deadbeef->mutex_unlock (hub->mutex);
+        hub_prefetch_tapers (hub);
+        return hub;
+    }
+    hub_t *new_hub = hub_acquire (config);
+    hub_release (hub);
+    return new_hub;
+}
+
+void
+hub_fft (hub_t *hub, int hop)
+{
+    trace_begin ("fft");
+    hub_lock (hub);
+    dsp_config_t config = *dsp_context_get_config (hub->dsp);
+    // at least one new sample, so widgets drawing the same frame share the transform
+    config.hop = MAX (1, hop);
+    dsp_context_configure (hub->dsp, &config);
+    dsp_context_fft (hub->dsp);
+    deadbeef->mutex_unlock (hub->mutex);
+    trace_end ("fft");
+}
@@ -0,0 +1,62 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef HUB_HEADER
+#define HUB_HEADER
+
+#include <stdint.h>
+
+#include "dsp/dsp.h"
+
+// Shared analysis of one audio tap. Widgets with the same fft size, window and
+// samplerate use the same hub, so the audio is copied and transformed once per
+// frame no matter how many of them are visible.
+typedef struct hub_s {
+    int refcount;
+    // dsp: fed by the audio thread, accessed with mutex locked
+    dsp_context_t *dsp;
+    intptr_t mutex;
+    // feed_samplerate: rate of the audio last fed, audio thread only
+    int feed_samplerate;
+    struct hub_s *next;
+} hub_t;
+
+// Returns a hub for config, creating it if no compatible one exists.
+// Must only be called from the GUI thread, like all functions below.
+hub_t *
+hub_acquire (const dsp_config_t *config);
+
+void
+hub_release (hub_t *hub);
+
+// Returns a hub matching config, reconfiguring hub in place when nobody else uses it.
+hub_t *
+hub_update (hub_t *hub, const dsp_config_t *config);
+
+// Transforms the newest samples if hop new ones arrived since the last transform,
+// the first widget drawing a frame does the work and the others reuse it.
+void
+hub_fft (hub_t *hub, int hop);
+
+#endif
@@ -0,0 +1,159 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <gtk/gtk.h>
+
+#include "profiler.h"
+#include "hud.h"
+
+#define HUD_FIRST_CHAR 32
+#define HUD_LAST_CHAR 126
+#define HUD_NUM_CHARS (HUD_LAST_CHAR - HUD_FIRST_CHAR + 1)
+#define HUD_FONT_SIZE 10
+#define HUD_PADDING 4
+#define HUD_LINE_LEN 48
+#define HUD_NUM_LINES (NUM_STAGES + 2)
+// premultiplied ARGB background of the overlay
+#define HUD_BG_ALPHA 0xC0
+
+static void
+hud_create_atlas (hud_t *hud)
+{
+    // measure the monospace font with a scratch surface first
+    cairo_surface_t *tmp = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
+    cairo_t *cr = cairo_create (tmp);
+    cairo_select_font_face (cr, "monospace", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size (cr, HUD_FONT_SIZE);
+    cairo_font_extents_t fe;
+    cairo_font_extents (cr, &fe);
+    cairo_destroy (cr);
+    cairo_surface_destroy (tmp);
+
+    hud->cell_w = MAX ((int)ceil (fe.max_x_advance), 1);
+    hud->cell_h = MAX ((int)ceil (fe.height), 1);
+
+    hud->atlas = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, hud->cell_w * HUD_NUM_CHARS, hud->cell_h);
+    cr = cairo_create (hud->atlas);
+    cairo_select_font_face (cr, "monospace", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_size (cr, HUD_FONT_SIZE);
+    cairo_set_source_rgb (cr, 1, 1, 1);
+    char glyph[2] = {0, 0};
+    for (int i = 0; i < HUD_NUM_CHARS; i++) {
+        glyph[0] = (char)(HUD_FIRST_CHAR + i);
+        cairo_move_to (cr, i * hud->cell_w, fe.ascent);
+        cairo_show_text (cr, glyph);
+    }
+    cairo_destroy (cr);
+    cairo_surface_flush (hud->atlas);
+}
+
+static void
+hud_blit_text (hud_t *hud, uint8_t *data, int stride, int x0, int y0, const char *text)
+{
+    const uint8_t *atlas = cairo_image_surface_get_data (hud->atlas);
+    const int atlas_stride = cairo_image_surface_get_stride (hud->atlas);
+
+    for (int c = 0; text[c]; c++) {
+        int index = (unsigned char)text[c] - HUD_FIRST_CHAR;
+        if (index < 0 || index >= HUD_NUM_CHARS) {
+            index = '?' - HUD_FIRST_CHAR;
+        }
+        const int x = x0 + c * hud->cell_w;
+        for (int y = 0; y < hud->cell_h; y++) {
+            const uint32_t *src = (const uint32_t *)&atlas[y * atlas_stride + index * hud->cell_w * 4];
+            uint32_t *dst = (uint32_t *)&data[(y0 + y) * stride + x * 4];
+            for (int i = 0; i < hud->cell_w; i++) {
+                // white glyph over the dark background: color channels equal the glyph coverage
+                const uint32_t a = src[i] >> 24;
+                const uint32_t alpha = a + (255 - a) * HUD_BG_ALPHA / 255;
+                dst[i] = alpha << 24 | a << 16 | a << 8 | a;
+            }
+        }
+    }
+}
+
+void
+hud_draw (hud_t *hud, cairo_t *cr, const profiler_t *p, int x, int y)
+{
+    if (!hud->atlas) {
+        hud_create_atlas (hud);
+    }
+
+    const int width = HUD_LINE_LEN * hud->cell_w + 2 * HUD_PADDING;
+    const int height = HUD_NUM_LINES * hud->cell_h + 2 * HUD_PADDING;
+    if (!hud->surf) {
+        hud->surf = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+    }
+    cairo_surface_flush (hud->surf);
+
+    uint8_t *data = cairo_image_surface_get_data (hud->surf);
+    g_return_if_fail (data);
+    const int stride = cairo_image_surface_get_stride (hud->surf);
+
+    const uint32_t bg = (uint32_t)HUD_BG_ALPHA << 24;
+    for (int i = 0; i < height; i++) {
+        uint32_t *row = (uint32_t *)&data[i * stride];
+        for (int j = 0; j < width; j++) {
+            row[j] = bg;
+        }
+    }
+
+    char line[HUD_LINE_LEN + 1];
+    int ly = HUD_PADDING;
+    snprintf (line, sizeof (line), "%-10s %9s %9s", "stage", "avg ms", "p99 ms");
+    hud_blit_text (hud, data, stride, HUD_PADDING, ly, line);
+    ly += hud->cell_h;
+    for (int i = 0; i < NUM_STAGES; i++) {
+        double avg, p99;
+        profiler_get_stats (p, i, &avg, &p99);
+        snprintf (line, sizeof (line), "%-10s %9.3f %9.3f", profiler_stage_name (i), avg, p99);
+        hud_blit_text (hud, data, stride, HUD_PADDING, ly, line);
+        ly += hud->cell_h;
+    }
+    snprintf (line, sizeof (line), "%.1f fps, %d dropped", profiler_get_fps (p), p->dropped);
+    hud_blit_text (hud, data, stride, HUD_PADDING, ly, line);
+
+    cairo_surface_mark_dirty (hud->surf);
+    cairo_save (cr);
+    cairo_set_source_surface (cr, hud->surf, x, y);
+    cairo_paint (cr);
+    cairo_restore (cr);
+}
+
+void
+hud_free (hud_t *hud)
+{
+    if (hud->atlas) {
+        cairo_surface_destroy (hud->atlas);
+        hud->atlas = NULL;
+    }
+    if (hud->surf) {
+        cairo_surface_destroy (hud->surf);
+        hud->surf = NULL;
+    }
+}
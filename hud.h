@@ -0,0 +1,47 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef HUD_HEADER
+#define HUD_HEADER
+
+#include <gtk/gtk.h>
+
+#include "profiler.h"
+
+typedef struct {
+    // atlas: white glyphs of all printable ASCII characters, rendered once
+    cairo_surface_t *atlas;
+    int cell_w;
+    int cell_h;
+    // surf: overlay assembled from the atlas every frame
+    cairo_surface_t *surf;
+} hud_t;
+
+void
+hud_draw (hud_t *hud, cairo_t *cr, const profiler_t *p, int x, int y);
+
+void
+hud_free (hud_t *hud);
+
+#endif
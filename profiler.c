@@ -0,0 +1,156 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "profiler.h"
+
+// gaps between frames longer than this are pauses, not dropped frames (ns)
+#define MAX_FRAME_GAP 1000000000
+
+static const char *stage_names[] = {"fft", "bands", "falloff", "background", "bars", "paint"};
+
+int64_t
+profiler_now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+const char *
+profiler_stage_name (int stage)
+{
+    if (stage < 0 || stage >= NUM_STAGES) {
+        return NULL;
+    }
+    return stage_names[stage];
+}
+
+void
+profiler_reset (profiler_t *p)
+{
+    memset (p, 0, sizeof (profiler_t));
+    for (int i = 0; i < NUM_STAGES; i++) {
+        p->current[i] = -1;
+    }
+}
+
+void
+profiler_begin_frame (profiler_t *p, int64_t now, int interval)
+{
+    if (p->frame_count > 0) {
+        const int prev = (p->frame_pos + PROFILER_HISTORY - 1) % PROFILER_HISTORY;
+        const int64_t gap = now - p->frame_starts[prev];
+        const int64_t expected = (int64_t)interval * 1000000;
+        // a frame is dropped whenever the timer couldn't fire on time
+        if (expected > 0 && gap < MAX_FRAME_GAP && gap > expected + expected / 2) {
+            p->dropped += (gap + expected / 2) / expected - 1;
+        }
+    }
+    p->frame_starts[p->frame_pos] = now;
+    p->frame_pos = (p->frame_pos + 1) % PROFILER_HISTORY;
+    if (p->frame_count < PROFILER_HISTORY) {
+        p->frame_count++;
+    }
+    for (int i = 0; i < NUM_STAGES; i++) {
+        p->current[i] = -1;
+    }
+}
+
+// Adds the time elapsed since start to the given stage of the running frame.
+void
+profiler_add (profiler_t *p, int stage, int64_t start)
+{
+    const int64_t elapsed = profiler_now () - start;
+    if (p->current[stage] < 0) {
+        p->current[stage] = elapsed;
+    }
+    else {
+        p->current[stage] += elapsed;
+    }
+}
+
+void
+profiler_end_frame (profiler_t *p)
+{
+    for (int i = 0; i < NUM_STAGES; i++) {
+        if (p->current[i] < 0) {
+            continue;
+        }
+        p->history[i][p->pos[i]] = p->current[i];
+        p->pos[i] = (p->pos[i] + 1) % PROFILER_HISTORY;
+        if (p->count[i] < PROFILER_HISTORY) {
+            p->count[i]++;
+        }
+        p->current[i] = -1;
+    }
+}
+
+static int
+compare_int64 (const void *a, const void *b)
+{
+    const int64_t x = *(const int64_t *)a;
+    const int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Rolling average and 99th percentile of a stage over the last PROFILER_HISTORY frames, in ms.
+void
+profiler_get_stats (const profiler_t *p, int stage, double *avg, double *p99)
+{
+    *avg = 0;
+    *p99 = 0;
+    const int count = p->count[stage];
+    if (count == 0) {
+        return;
+    }
+    int64_t sorted[PROFILER_HISTORY];
+    int64_t sum = 0;
+    for (int i = 0; i < count; i++) {
+        sorted[i] = p->history[stage][i];
+        sum += sorted[i];
+    }
+    qsort (sorted, count, sizeof (int64_t), compare_int64);
+    *avg = sum / (double)count / 1000000.0;
+    *p99 = sorted[(count * 99 - 1) / 100] / 1000000.0;
+}
+
+double
+profiler_get_fps (const profiler_t *p)
+{
+    if (p->frame_count < 2) {
+        return 0;
+    }
+    const int last = (p->frame_pos + PROFILER_HISTORY - 1) % PROFILER_HISTORY;
+    const int first = (p->frame_pos + PROFILER_HISTORY - p->frame_count) % PROFILER_HISTORY;
+    const int64_t span = p->frame_starts[last] - p->frame_starts[first];
+    if (span <= 0) {
+        return 0;
+    }
+    return (p->frame_count - 1) * 1000000000.0 / span;
+}
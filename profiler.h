@@ -0,0 +1,71 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef PROFILER_HEADER
+#define PROFILER_HEADER
+
+#include <stdint.h>
+
+enum PROFILER_STAGE { STAGE_FFT = 0, STAGE_BANDS = 1, STAGE_FALLOFF = 2, STAGE_BACKGROUND = 3, STAGE_BARS = 4, STAGE_PAINT = 5, NUM_STAGES = 6 };
+
+#define PROFILER_HISTORY 128
+
+typedef struct {
+    // history: duration of each stage in ns, one entry per frame in which the stage ran
+    int64_t history[NUM_STAGES][PROFILER_HISTORY];
+    int pos[NUM_STAGES];
+    int count[NUM_STAGES];
+    // current: durations accumulated during the running frame, -1 if the stage didn't run
+    int64_t current[NUM_STAGES];
+    int64_t frame_starts[PROFILER_HISTORY];
+    int frame_pos;
+    int frame_count;
+    int dropped;
+} profiler_t;
+
+int64_t
+profiler_now (void);
+
+void
+profiler_reset (profiler_t *p);
+
+void
+profiler_begin_frame (profiler_t *p, int64_t now, int interval);
+
+void
+profiler_add (profiler_t *p, int stage, int64_t start);
+
+void
+profiler_end_frame (profiler_t *p);
+
+void
+profiler_get_stats (const profiler_t *p, int stage, double *avg, double *p99);
+
+double
+profiler_get_fps (const profiler_t *p);
+
+const char *
+profiler_stage_name (int stage);
+
+#endif
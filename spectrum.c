@@ -28,7 +28,6 @@
 #include <string.h>
 #include <math.h>
 #include <gtk/gtk.h>
-#include <fftw3.h>
 
 #include <deadbeef/deadbeef.h>
 #include <deadbeef/gtkui_api.h>
@@ -39,21 +38,17 @@
 #include "config_dialog.h"
 #include "utils.h"
 #include "draw_utils.h"
+#include "governor.h"
+#include "profiler.h"
+#include "hud.h"
+#include "trace.h"
+#include "dsp/dsp.h"
+#include "hub.h"
 #include "spectrum.h"
 
 DB_functions_t *deadbeef = NULL;
 ddb_gtkui_t *gtkui_plugin = NULL;
 
-struct motion_context {
-    uint8_t entered;
-    double x;
-};
-
-static struct motion_context motion_ctx;
-
-enum PLAYBACK_STATUS { STOPPED = 0, PLAYING = 1, PAUSED = 2 };
-static int playback_status = STOPPED;
-
 static char *notes[] = {"C0","C#0","D0","D#0","E0","F0","F#0","G0","G#0","A0","A#0","B0",
                  "C1","C#1","D1","D#1","E1","F1","F#1","G1","G#1","A1","A#1","B1",
                  "C2","C#2","D2","D#2","E2","F2","F#2","G2","G#2","A2","A#2","B2",
@@ -67,56 +62,22 @@ static char *notes[] = {"C0","C#0","D0","D#0","E0","F0","F#0","G0","G#0","A0","A
                  "C10","C#10","D10","D#10","E10","F10","F#10","G10","G#10","A10","A#10","B10"
                 };
 
-static int
-get_align_pos (int width, int bands, int bar_width)
-{
-    int left = 0;
-    switch (CONFIG_ALIGNMENT) {
-        case LEFT:
-            left = 0;
-            break;
-        case RIGHT:
-            left = MIN (width, width - (bar_width * bands));
-            break;
-        case CENTER:
-            left = MAX (0, (width - (bar_width * bands))/2);
-            break;
-        default:
-            left = 0;
-            break;
-    }
-    return left;
-}
-
 static void
 do_fft (w_spectrum_t *w)
 {
-    if (!w->samples || w->buffered < CONFIG_FFT_SIZE) {
+    if (!w->hub) {
         return;
     }
-
-    deadbeef->mutex_lock (w->mutex);
-
-    for (int i = 0; i < CONFIG_FFT_SIZE; i++) {
-        w->fft_in[i] = w->samples[i] * w->window[i];
-    }
-
-    fftw_execute (w->p_r2c);
-    for (int i = 0; i < CONFIG_FFT_SIZE/2; i++)
-    {
-        const double real = w->fft_out[i][0];
-        const double imag = w->fft_out[i][1];
-        w->spectrum_data[i] = (real*real + imag*imag);
-    }
-    deadbeef->mutex_unlock (w->mutex);
+    // keeps the previous spectrum until the governor allows the next transform
+    hub_fft (w->hub, dsp_context_get_config (w->dsp)->hop);
 }
 
-static int need_redraw = 0;
-
 static gboolean
 spectrum_draw_cb (void *data) {
     w_spectrum_t *s = data;
+    trace_begin ("timer");
     gtk_widget_queue_draw (s->drawarea);
+    trace_end ("timer");
     return TRUE;
 }
 
@@ -127,55 +88,157 @@ spectrum_redraw_cb (void *data) {
     return FALSE;
 }
 
+static gboolean
+spectrum_set_refresh_interval (gpointer user_data, int interval);
+
+// samplerates band tables are built for ahead of time
+static const int common_samplerates[] = { 44100, 48000, 88200, 96000, 192000 };
+
+// builds the band tables of the common samplerates after the current track started,
+// so switching between them on later tracks doesn't compute any tables
+static gboolean
+spectrum_prefetch_tables_cb (gpointer user_data)
+{
+    w_spectrum_t *w = user_data;
+    if (w->dsp) {
+        const dsp_config_t *config = dsp_context_get_config (w->dsp);
+        trace_begin ("table prefetch");
+        dsp_band_table_prefetch (common_samplerates, G_N_ELEMENTS (common_samplerates), config->fft_size, config->num_bars, config->min_freq, config->max_freq, config->zoom);
+        trace_end ("table prefetch");
+    }
+    w->prefetch_idle = 0;
+    return FALSE;
+}
+
+static void
+spectrum_configure_dsp (w_spectrum_t *w, const config_snapshot_t *conf)
+{
+    if (!w->dsp) {
+        // not prepared yet, spectrum_prepare uses the config of that moment
+        return;
+    }
+    dsp_config_t config;
+    create_dsp_config (w, conf, &config);
+    dsp_context_configure (w->dsp, &config);
+    w->hub = hub_update (w->hub, &config);
+}
+
+// Sets up the analysis on first playback, so a widget that never plays costs
+// nothing but its background.
+static int
+spectrum_prepare (w_spectrum_t *w)
+{
+    if (w->dsp) {
+        return 0;
+    }
+    const config_snapshot_t *conf = config_acquire ();
+    if (!conf) {
+        return -1;
+    }
+    trace_begin ("prepare");
+    dsp_config_t config;
+    create_dsp_config (w, conf, &config);
+    config_release (conf);
+    w->dsp = dsp_context_new (&config);
+    w->hub = w->dsp ? hub_acquire (&config) : NULL;
+    if (!w->hub) {
+        dsp_context_free (w->dsp);
+        w->dsp = NULL;
+    }
+    w->need_redraw = 1;
+    trace_end ("prepare");
+    return w->dsp ? 0 : -1;
+}
+
+static void
+spectrum_apply_governor (w_spectrum_t *w, const config_snapshot_t *conf)
+{
+    const int interval = governor_refresh_interval (&w->governor, conf->refresh_interval);
+    if (interval != w->refresh_interval) {
+        w->refresh_interval = interval;
+        if (w->drawtimer) {
+            spectrum_set_refresh_interval (w, w->refresh_interval);
+        }
+    }
+
+    spectrum_configure_dsp (w, conf);
+    w->need_redraw = 1;
+}
+
 static int
 on_config_changed (gpointer user_data, uintptr_t ctx)
 {
-    need_redraw = 1;
     w_spectrum_t *w = user_data;
-    load_config ();
-    deadbeef->mutex_lock (w->mutex);
-    if (w->p_r2c) {
-        fftw_destroy_plan (w->p_r2c);
+    const config_snapshot_t *conf = config_acquire ();
+    if (!conf) {
+        return 0;
     }
-    create_window_table (w);
-    create_frequency_table (w);
-    create_gradient_table (w->colors, CONFIG_GRADIENT_COLORS, CONFIG_NUM_COLORS);
-
-    w->p_r2c = fftw_plan_dft_r2c_1d (CLAMP (CONFIG_FFT_SIZE, 512, MAX_FFT_SIZE), w->fft_in, w->fft_out, FFTW_ESTIMATE);
-    memset (w->spectrum_data, 0, sizeof (double) * MAX_FFT_SIZE);
-    deadbeef->mutex_unlock (w->mutex);
+    // musical_spectrum_message reloaded the config, every widget compares to its own serial.
+    // Groups changed after the snapshot was taken are found again on the next event.
+    const uint32_t changes = config_changes_since (w->config_serial);
+    w->config_serial = conf->serial;
+    if (!changes) {
+        config_release (conf);
+        return 0;
+    }
+    trace_begin ("config");
+    if (changes & CONFIG_CHANGED_GOVERNOR && !conf->governor) {
+        governor_reset (&w->governor);
+    }
+    if (changes & (CONFIG_CHANGED_REFRESH | CONFIG_CHANGED_GOVERNOR)) {
+        w->refresh_interval = governor_refresh_interval (&w->governor, conf->refresh_interval);
+    }
+    // animation steps are scaled by the refresh interval
+    if (changes & (CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_REFRESH | CONFIG_CHANGED_GOVERNOR)) {
+        spectrum_configure_dsp (w, conf);
+    }
+    // the gradient table is part of the snapshot
+    if (changes & (CONFIG_CHANGED_ANALYSIS | CONFIG_CHANGED_GRADIENT | CONFIG_CHANGED_LAYOUT)) {
+        w->need_redraw = 1;
+    }
+    trace_end ("config");
+    config_release (conf);
     g_idle_add (spectrum_redraw_cb, w);
-    return 0;
+    return changes & (CONFIG_CHANGED_REFRESH | CONFIG_CHANGED_GOVERNOR) ? 1 : 0;
+}
+
+// widgets: all spectrum widgets, only used on the main thread
+static GList *widgets;
+
+// Applies a config change to every widget on the main thread, after the reload.
+static gboolean
+spectrum_config_changed_cb (gpointer user_data)
+{
+    for (GList *l = widgets; l; l = l->next) {
+        w_spectrum_t *w = l->data;
+        if (on_config_changed (w, 0) && deadbeef->get_output ()->state () == OUTPUT_STATE_PLAYING) {
+            spectrum_set_refresh_interval (w, w->refresh_interval);
+        }
+    }
+    return FALSE;
 }
 
 ///// spectrum vis
 static void
 w_spectrum_destroy (ddb_gtkui_widget_t *w) {
     w_spectrum_t *s = (w_spectrum_t *)w;
-    deadbeef->vis_waveform_unlisten (w);
-    if (s->spectrum_data) {
-        free (s->spectrum_data);
-        s->spectrum_data = NULL;
-    }
-    if (s->samples) {
-        free (s->samples);
-        s->samples = NULL;
-    }
-    if (s->p_r2c) {
-        fftw_destroy_plan (s->p_r2c);
+    widgets = g_list_remove (widgets, s);
+    if (s->hub) {
+        hub_release (s->hub);
+        s->hub = NULL;
     }
-    if (s->fft_in) {
-        fftw_free (s->fft_in);
-        s->fft_in = NULL;
-    }
-    if (s->fft_out) {
-        fftw_free (s->fft_out);
-        s->fft_out = NULL;
+    if (s->dsp) {
+        dsp_context_free (s->dsp);
+        s->dsp = NULL;
     }
     if (s->drawtimer) {
         g_source_remove (s->drawtimer);
         s->drawtimer = 0;
     }
+    if (s->prefetch_idle) {
+        g_source_remove (s->prefetch_idle);
+        s->prefetch_idle = 0;
+    }
     if (s->surf) {
         cairo_surface_destroy (s->surf);
         s->surf = NULL;
@@ -184,10 +247,7 @@ w_spectrum_destroy (ddb_gtkui_widget_t *w) {
         free (s->surf_data);
         s->surf_data = NULL;
     }
-    if (s->mutex) {
-        deadbeef->mutex_free (s->mutex);
-        s->mutex = 0;
-    }
+    hud_free (&s->hud);
 }
 
 static gboolean
@@ -213,330 +273,113 @@ spectrum_set_refresh_interval (gpointer user_data, int interval)
 }
 
 static void
-spectrum_wavedata_listener (void *ctx, ddb_audio_data_t *data) {
-    w_spectrum_t *w = ctx;
-    g_return_if_fail (w->samples);
-
-    deadbeef->mutex_lock (w->mutex);
-    const int nsamples = data->nframes;
-    const int sz = MIN (CONFIG_FFT_SIZE, nsamples);
-    const int n = CONFIG_FFT_SIZE - sz;
-    memmove (w->samples, w->samples + sz, n * sizeof (double));
-
-    const int channels = data->fmt->channels;
-    int data_index = 0;
-    int sample_index = n;
-    for (int i = 0; i < sz; i++, sample_index++, data_index += channels) {
-        w->samples[sample_index] = -1000.0;
-        for (int j = 0; j < channels; j++) {
-            w->samples[sample_index] = MAX (w->samples[sample_index], data->data[data_index + j]);
-        }
-    }
-    deadbeef->mutex_unlock (w->mutex);
-    if (w->buffered < CONFIG_FFT_SIZE) {
-        w->buffered += sz;
-    }
-}
-
-static inline float
-spectrum_get_value (gpointer user_data, int start, int end)
-{
-    w_spectrum_t *w = user_data;
-    if (start >= end) {
-        return w->spectrum_data[end];
-    }
-    float value = 0.0;
-    for (int i = start; i < end; i++) {
-        value = MAX (w->spectrum_data[i],value);
-    }
-    return value;
-}
-
-static float
-spectrum_interpolate (gpointer user_data, int bands, int index)
+spectrum_render (gpointer user_data)
 {
     w_spectrum_t *w = user_data;
-    float x = 0.0;
-    if (index <= w->low_res_end+1) {
-        const float v1 = log10f (w->spectrum_data[w->keys[index]]);
-
-        // find index of next value
-        int j = 0;
-        while (index+j < bands && w->keys[index+j] == w->keys[index]) {
-            j++;
-        }
-        const float v2 = log10f (w->spectrum_data[w->keys[index+j]]);
-
-        int l = j;
-        while (index+l < bands && w->keys[index+l] == w->keys[index+j]) {
-            l++;
-        }
-        const float v3 = log10f (w->spectrum_data[w->keys[index+l]]);
-
-        int k = 0;
-        while ((k+index) >= 0 && w->keys[k+index] == w->keys[index]) {
-            j++;
-            k--;
-        }
-        const float v0 = log10f (w->spectrum_data[w->keys[CLAMP(index+k,0,bands-1)]]);
-
-        //x = linear_interpolate (v1,v2,(1.0/(j-1)) * ((-1 * k) - 1));
-        x = 10 * lagrange_interpolate (v0,v1,v2,v3,1 + (1.0 / (j - 1)) * ((-1 * k) - 1));
-    }
-    else {
-        int start = 0;
-        int end = 0;
-        if (index > 0) {
-            start = (w->keys[index] - w->keys[index-1])/2 + w->keys[index-1];
-            if (start == w->keys[index-1]) start = w->keys[index];
-        }
-        else {
-            start = w->keys[index];
-        }
-        if (index < bands-1) {
-            end = (w->keys[index+1] - w->keys[index])/2 + w->keys[index];
-            if (end == w->keys[index+1]) end = w->keys[index];
-        }
-        else {
-            end = w->keys[index];
-        }
-        x = 10 * log10f (spectrum_get_value (w, start, end));
+    if (!w->dsp || !w->hub) {
+        return;
     }
-    return x;
-}
-
-static void
-spectrum_render (gpointer user_data, int bands)
-{
-    w_spectrum_t *w = user_data;
 
-    if (playback_status != STOPPED) {
-        if (playback_status == PAUSED) {
+    if (w->playback_status != STOPPED) {
+        if (w->playback_status == PAUSED) {
             spectrum_remove_refresh_interval (w);
         }
         else {
+            int64_t start = profiler_now ();
             do_fft (w);
-
-            const float bar_falloff = CONFIG_BAR_FALLOFF/1000.0 * CONFIG_REFRESH_INTERVAL;
-            const float peak_falloff = CONFIG_PEAK_FALLOFF/1000.0 * CONFIG_REFRESH_INTERVAL;
-            const int bar_delay = ftoi (CONFIG_BAR_DELAY/CONFIG_REFRESH_INTERVAL);
-            const int peak_delay = ftoi (CONFIG_PEAK_DELAY/CONFIG_REFRESH_INTERVAL);
-
-            for (int i = 0; i < bands; i++) {
-                // interpolate
-                float x = spectrum_interpolate (w, bands, i);
-
-                // TODO: get rid of hardcoding
-                x += CONFIG_DB_RANGE - 63;
-                x = CLAMP (x, 0, CONFIG_DB_RANGE);
-                w->bars[i] = CLAMP (w->bars[i], 0, CONFIG_DB_RANGE);
-                w->peaks[i] = CLAMP (w->peaks[i], 0, CONFIG_DB_RANGE);
-
-                if (CONFIG_BAR_FALLOFF != -1) {
-                    if (w->delay_bars[i] < 0) {
-                        w->bars[i] -= bar_falloff;
-                    }
-                    else {
-                        w->delay_bars[i]--;
-                    }
-                }
-                else {
-                    w->bars[i] = 0;
-                }
-                if (CONFIG_PEAK_FALLOFF != -1) {
-                    if (w->delay_peaks[i] < 0) {
-                        w->peaks[i] -= peak_falloff;
-                    }
-                    else {
-                        w->delay_peaks[i]--;
-                    }
-                }
-                else {
-                    w->peaks[i] = 0;
-                }
-
-                if (x > w->bars[i])
-                {
-                    w->bars[i] = x;
-                    w->delay_bars[i] = bar_delay;
-                }
-                if (x > w->peaks[i]) {
-                    w->peaks[i] = x;
-                    w->delay_peaks[i] = peak_delay;
-                }
-                if (w->peaks[i] < w->bars[i]) {
-                    w->peaks[i] = w->bars[i];
-                }
-            }
+            profiler_add (&w->profiler, STAGE_FFT, start);
+
+            trace_begin ("band mapping");
+            start = profiler_now ();
+            dsp_context_map_bands_from (w->dsp, w->hub->dsp);
+            profiler_add (&w->profiler, STAGE_BANDS, start);
+            trace_end ("band mapping");
+
+            trace_begin ("animation");
+            start = profiler_now ();
+            dsp_context_animate (w->dsp);
+            profiler_add (&w->profiler, STAGE_FALLOFF, start);
+            trace_end ("animation");
         }
     }
-    else if (playback_status == STOPPED) {
+    else if (w->playback_status == STOPPED) {
         spectrum_remove_refresh_interval (w);
-        for (int i = 0; i < bands; i++) {
-                w->bars[i] = 0;
-                w->delay_bars[i] = 0;
-                w->peaks[i] = 0;
-                w->delay_peaks[i] = 0;
-        }
+        dsp_context_clear_bars (w->dsp);
     }
 
 }
 
 static void
-draw_static_content (unsigned char *data, int stride, int bands, int width, int height)
+spectrum_draw_params (gpointer user_data, const config_snapshot_t *conf, draw_params_t *p, int bands, int width, int height)
 {
-    g_return_if_fail (data);
-
-    memset (data, 0, height * stride);
-
-    int barw;
-    if (CONFIG_GAPS || CONFIG_BAR_W > 1)
-        barw = CLAMP (width / bands, 2, 20);
-    else
-        barw = CLAMP (width / bands, 2, 20) - 1;
-
-    const int left = get_align_pos (width, bands, barw);
-
-    //draw background
-    _draw_background (data, width, height, CONFIG_COLOR_BG32);
-    // draw vertical grid
-    if (CONFIG_ENABLE_VGRID && CONFIG_GAPS) {
-        const int num_lines = MIN (width/barw, bands);
-        for (int i = 0; i < num_lines; i++) {
-            _draw_vline (data, stride, left + barw * i, 0, height-1, CONFIG_COLOR_VGRID32);
-        }
-    }
+    w_spectrum_t *w = user_data;
 
-    // draw octave grid
-    if (CONFIG_ENABLE_OCTAVE_GRID) {
-        const int spectrum_width = MIN (barw * bands, width);
-        const float octave_width = CLAMP (((float)spectrum_width / 11), 1, spectrum_width);
-        for (float i = left; i < spectrum_width - 1 && i < width - 1; i += octave_width) {
-            int x = ftoi (i) + (CONFIG_GAPS ? (ftoi (i) % barw) : 0);
-            _draw_vline (data, stride, x, 0, height-1, CONFIG_COLOR_OCTAVE_GRID32);
-        }
-    }
+    p->width = width;
+    p->height = height;
+    p->bands = bands;
+    p->db_range = conf->db_range;
+    p->alignment = conf->alignment;
+    p->gaps = conf->gaps;
+    p->bar_w = conf->bar_w;
+    p->bar_mode = conf->enable_bar_mode;
+    p->gradient_orientation = conf->gradient_orientation;
+    p->fill_spectrum = conf->fill_spectrum;
+    p->enable_hgrid = conf->enable_hgrid;
+    p->enable_vgrid = conf->enable_vgrid;
+    p->enable_octave_grid = conf->enable_octave_grid;
+    float min_freq, max_freq;
+    get_range (w, conf, &min_freq, &max_freq);
+    p->octaves = log2f (max_freq / min_freq);
+    const float c0_octaves = log2f (min_freq / DSP_DEFAULT_MIN_FREQ);
+    // a range starting on a C within rounding draws its first line at the left edge
+    p->octave_start = MAX (ceilf (c0_octaves - 1e-4f) - c0_octaves, 0);
+
+    p->colors = conf->colors;
+    p->color_bg32 = conf->color_bg32;
+    p->color_vgrid32 = conf->color_vgrid32;
+    p->color_hgrid32 = conf->color_hgrid32;
+    p->color_octave_grid32 = conf->color_octave_grid32;
+
+    p->gradient_colors = conf->gradient_colors;
+    p->num_colors = conf->num_colors;
+    p->color_bg = conf->color_bg;
+    p->color_hgrid = conf->color_hgrid;
+    p->color_octave_grid = conf->color_octave_grid;
+
+    p->highlight_octaves = conf->display_octaves && w->motion_ctx.entered;
+    p->highlight_x = w->motion_ctx.x;
+    p->overlay = 0;
+}
 
-    const int hgrid_num = CONFIG_DB_RANGE/10;
-    // draw horizontal grid
-    if (CONFIG_ENABLE_HGRID && height > 2*hgrid_num && width > 1) {
-        for (int i = 1; i < hgrid_num; i++) {
-            _draw_hline (data, stride, 0, ftoi (i/(float)hgrid_num * height), width-1, CONFIG_COLOR_HGRID32);
-        }
+// Stacked and mirrored layouts give every channel its own horizontal strip.
+static int
+spectrum_num_strips (const config_snapshot_t *conf)
+{
+    if (conf->channel_layout == CHANNELS_STACKED || conf->channel_layout == CHANNELS_MIRRORED) {
+        return conf->channels;
     }
+    return 1;
 }
 
+// Params of one strip, strips split the height evenly and the last one takes the rest.
 static void
-spectrum_draw_cairo (gpointer user_data, cairo_t *cr, int bands, int width, int height)
+spectrum_strip_params (const draw_params_t *p, int strip, int strips, draw_params_t *sp, int *y)
 {
-    w_spectrum_t *w = user_data;
-
-    const float base_s = (height / (float)CONFIG_DB_RANGE);
-    const int barw = CLAMP (width / bands, 2, 20) - 1;
-    const int left = get_align_pos (width, bands, barw);
-
-    // draw background
-    cairo_set_source_rgb (cr, CONFIG_COLOR_BG.red/65535.f, CONFIG_COLOR_BG.green/65535.f, CONFIG_COLOR_BG.blue/65535.f);
-    cairo_rectangle (cr, 0, 0, width, height);
-    cairo_fill (cr);
-
-    // create gradient
-    cairo_pattern_t *pat;
-    if (CONFIG_GRADIENT_ORIENTATION == 0) {
-        pat = cairo_pattern_create_linear (0, 0, 0, height);
-    }
-    else {
-        pat = cairo_pattern_create_linear (0, 0, width, 0);
-    }
-
-    if (CONFIG_NUM_COLORS > 1) {
-        const float step = 1.0/(CONFIG_NUM_COLORS - 1);
-        float grad_pos = 0;
-        for (int i = 0; i < CONFIG_NUM_COLORS; i++) {
-            cairo_pattern_add_color_stop_rgb (pat, grad_pos, CONFIG_GRADIENT_COLORS[i].red/65535.f, CONFIG_GRADIENT_COLORS[i].green/65535.f, CONFIG_GRADIENT_COLORS[i].blue/65535.f);
-            grad_pos += step;
-        }
-        cairo_set_source (cr, pat);
-    }
-    else {
-        cairo_set_source_rgb (cr, CONFIG_GRADIENT_COLORS[0].red/65535.f, CONFIG_GRADIENT_COLORS[0].green/65535.f, CONFIG_GRADIENT_COLORS[0].blue/65535.f);
-    }
-
-    // draw spectrum
-    cairo_set_line_width (cr, 1);
-    cairo_line_to (cr, 0, height);
-    float py = height - base_s * w->bars[0];
-    cairo_line_to (cr, 0, py);
-    for (gint i = 0; i < bands; i++)
-    {
-        const float x = left + barw * i;
-        const float y = height - base_s * w->bars[i];
-
-        if (!CONFIG_FILL_SPECTRUM) {
-            cairo_move_to (cr, x - 0.5, py);
-        }
-        cairo_line_to (cr, x + 0.5, y);
-        py = y;
-    }
-    if (CONFIG_FILL_SPECTRUM) {
-        cairo_move_to (cr, left + barw * bands, 0);
-        cairo_line_to (cr, 0, height);
-
-        cairo_close_path (cr);
-        cairo_fill (cr);
-    }
-    else {
-        cairo_stroke (cr);
-    }
-    cairo_pattern_destroy(pat);
-
-    // draw octave grid
-    if (CONFIG_ENABLE_OCTAVE_GRID) {
-        cairo_set_source_rgba (cr, CONFIG_COLOR_OCTAVE_GRID.red/65535.f, CONFIG_COLOR_OCTAVE_GRID.green/65535.f, CONFIG_COLOR_OCTAVE_GRID.blue/65535.f, 0.2);
-        const int spectrum_width = MIN (barw * bands, width);
-        const float octave_width = CLAMP (((float)spectrum_width / 11), 1, spectrum_width);
-        for (float i = left; i < spectrum_width - 1 && i < width - 1; i += octave_width) {
-            cairo_move_to (cr, i, 0);
-            cairo_line_to (cr, i, height);
-            cairo_stroke (cr);
-        }
-    }
-
-    // draw horizontal grid
-    const int hgrid_num = CONFIG_DB_RANGE/10;
-    if (CONFIG_ENABLE_HGRID && height > 2*hgrid_num && width > 1) {
-        cairo_set_source_rgba (cr, CONFIG_COLOR_HGRID.red/65535.f, CONFIG_COLOR_HGRID.green/65535.f, CONFIG_COLOR_HGRID.blue/65535.f, 0.2);
-        for (int i = 1; i < hgrid_num; i++) {
-            cairo_move_to (cr, 0, i/(float)hgrid_num * height);
-            cairo_line_to (cr, width, i/(float)hgrid_num * height);
-            cairo_stroke (cr);
-        }
-    }
-
-    // draw octave grid on hover
-    if (CONFIG_DISPLAY_OCTAVES && motion_ctx.entered) {
-        const int band_offset = (((int)motion_ctx.x % ((barw * bands) / 11)))/barw;
-        cairo_set_source_rgba (cr, 1, 0, 0, 0.5);
-        for (gint i = 0; i < bands; i++) {
-            const int octave_enabled  = (motion_ctx.entered && (i % (bands / 11)) == band_offset) ? 1 : 0;
-            const float x = left + barw * i;
-            if (octave_enabled) {
-                cairo_move_to (cr, x, 0);
-                cairo_line_to (cr, x, height);
-                cairo_stroke (cr);
-            }
-        }
-    }
+    *sp = *p;
+    *y = strip * p->height / strips;
+    sp->height = (strip + 1) * p->height / strips - *y;
 }
 
 static void
-spectrum_draw_custom (gpointer user_data, cairo_t *cr, int bands, int width, int height)
+spectrum_draw_custom (gpointer user_data, cairo_t *cr, const config_snapshot_t *conf, const draw_params_t *p)
 {
     w_spectrum_t *w = user_data;
+    const int width = p->width;
+    const int height = p->height;
     // start drawing
     int stride = 0;
     if (!w->surf || !w->surf_data || cairo_image_surface_get_width (w->surf) != width || cairo_image_surface_get_height (w->surf) != height) {
-        need_redraw = 1;
+        w->need_redraw = 1;
         if (w->surf) {
             cairo_surface_destroy (w->surf);
             w->surf = NULL;
@@ -549,7 +392,6 @@ spectrum_draw_custom (gpointer user_data, cairo_t *cr, int bands, int width, int
         stride = cairo_image_surface_get_stride (w->surf);
         w->surf_data = malloc (stride * height);
     }
-    const float base_s = (height / (float)CONFIG_DB_RANGE);
 
     cairo_surface_flush (w->surf);
 
@@ -557,116 +399,140 @@ spectrum_draw_custom (gpointer user_data, cairo_t *cr, int bands, int width, int
     g_return_if_fail (data);
 
     stride = cairo_image_surface_get_stride (w->surf);
-    if (need_redraw) {
+    int64_t start = profiler_now ();
+    if (w->need_redraw) {
         // widget size or config changed, background needs to be redrawn
-        draw_static_content (data, stride, bands, width, height);
+        const int strips = spectrum_num_strips (conf);
+        for (int i = 0; i < strips; i++) {
+            draw_params_t sp;
+            int y;
+            spectrum_strip_params (p, i, strips, &sp, &y);
+            draw_static_content (data + y * stride, stride, &sp);
+        }
         memcpy (w->surf_data, data, stride * height);
-        need_redraw = 0;
+        w->need_redraw = 0;
     }
     else {
         // just copy pre-rendered background to surface
         memcpy (data, w->surf_data, stride * height);
     }
-
-    int barw;
-    if (CONFIG_GAPS || CONFIG_BAR_W > 1)
-        barw = CLAMP (width / bands, 2, 20);
-    else
-        barw = CLAMP (width / bands, 2, 20) - 1;
-
-    const int left = get_align_pos (width, bands, barw);
-
-    const int band_offset = (((int)motion_ctx.x % ((barw * bands) / 11)))/barw;
-    for (gint i = 0; i < bands; i++)
-    {
-        int x = left + barw * i;
-        int octave_enabled = 0;
-        if (CONFIG_DISPLAY_OCTAVES && motion_ctx.entered) {
-            octave_enabled = (motion_ctx.entered && (i % (bands / 11)) == band_offset) ? 1 : 0;
-        }
-        int y = CLAMP (height - ftoi (w->bars[i] * base_s), 0, height);
-        int bw;
-
-        if (CONFIG_GAPS) {
-            bw = barw -1;
-            x += 1;
-        }
-        else {
-            bw = barw;
-        }
-
-        if (x + bw >= width) {
-            bw = width-x-1;
-        }
-
-        if ((y >= 0 && y < height - 1) || octave_enabled) {
-            if (CONFIG_GRADIENT_ORIENTATION == 0) {
-                if (CONFIG_ENABLE_BAR_MODE == 0) {
-                    _draw_bar_gradient_v (w->colors, data, stride, x, y, bw, height-y, height);
-                }
-                else {
-                    _draw_bar_gradient_bar_mode_v (w->colors, data, stride, x, y, bw, height-y, height);
-                }
-            }
-            else {
-                if (CONFIG_ENABLE_BAR_MODE == 0) {
-                    _draw_bar_gradient_h (w->colors, data, stride, x, y, bw, height-y, width);
-                }
-                else {
-                    _draw_bar_gradient_bar_mode_h (w->colors, data, stride, x, y, bw, height-y, width);
-                }
-            }
-            if (octave_enabled) {
-                _draw_bar (data, stride, x, y, bw, height - y, 0xFF0000);
-                _draw_bar (data, stride, x, 0, bw, y, 0x888888);
-            }
-        }
-        y = height - w->peaks[i] * base_s;
-        if (y > 0 && y < height-1) {
-            if (CONFIG_GRADIENT_ORIENTATION == 0) {
-                _draw_bar_gradient_v (w->colors, data, stride, x, y, bw, 1, height);
-            }
-            else {
-                _draw_bar_gradient_h (w->colors, data, stride, x, y, bw, 1, width);
-            }
-            if (octave_enabled) {
-                _draw_bar (data, stride, x, y, bw, 1, 0xFF0000);
+    profiler_add (&w->profiler, STAGE_BACKGROUND, start);
+
+    start = profiler_now ();
+    if (w->dsp) {
+        const int strips = spectrum_num_strips (conf);
+        for (int c = 0; c < conf->channels; c++) {
+            // overlaid channels are drawn over each other in channel order
+            draw_params_t sp;
+            int y;
+            spectrum_strip_params (p, MIN (c, strips - 1), strips, &sp, &y);
+            draw_bars (data + y * stride, stride, dsp_context_get_channel_bars (w->dsp, c), dsp_context_get_channel_peaks (w->dsp, c), &sp);
+            if (conf->channel_layout == CHANNELS_MIRRORED && c == 1) {
+                draw_flip_rows (data + y * stride, stride, sp.height);
             }
         }
     }
+    profiler_add (&w->profiler, STAGE_BARS, start);
 
+    start = profiler_now ();
     cairo_surface_mark_dirty (w->surf);
     cairo_set_source_surface (cr, w->surf, 0, 0);
     cairo_paint (cr);
+    profiler_add (&w->profiler, STAGE_PAINT, start);
+}
+
+static void
+spectrum_draw_cairo (gpointer user_data, cairo_t *cr, const config_snapshot_t *conf, const draw_params_t *p)
+{
+    w_spectrum_t *w = user_data;
+    const int strips = spectrum_num_strips (conf);
+    for (int c = 0; c < conf->channels; c++) {
+        draw_params_t sp;
+        int y;
+        spectrum_strip_params (p, MIN (c, strips - 1), strips, &sp, &y);
+        sp.overlay = conf->channel_layout == CHANNELS_OVERLAID && c > 0;
+        cairo_save (cr);
+        if (conf->channel_layout == CHANNELS_MIRRORED && c == 1) {
+            cairo_translate (cr, 0, y + sp.height);
+            cairo_scale (cr, 1, -1);
+        }
+        else {
+            cairo_translate (cr, 0, y);
+        }
+        draw_spectrum_cairo (cr, w->dsp ? dsp_context_get_channel_bars (w->dsp, c) : NULL, &sp);
+        cairo_restore (cr);
+    }
 }
 
 static gboolean
 spectrum_draw (GtkWidget *widget, cairo_t *cr, gpointer user_data) {
     w_spectrum_t *w = user_data;
-    g_return_val_if_fail (w->samples, FALSE);
+
+    // the settings of this frame, a config change publishes a new snapshot
+    const config_snapshot_t *conf = config_acquire ();
+    g_return_val_if_fail (conf, FALSE);
 
     GtkAllocation a;
     gtk_widget_get_allocation (w->drawarea, &a);
 
-    static int last_bar_w = -1;
-    if (a.width != last_bar_w || need_redraw) {
-        create_frequency_table(w);
+    if (a.width != w->last_bar_w || w->need_redraw) {
+        spectrum_configure_dsp (w, conf);
     }
-    last_bar_w = a.width;
+    w->last_bar_w = a.width;
 
-    const int bands = get_num_bars ();
+    int bands;
+    if (w->dsp) {
+        bands = dsp_context_get_config (w->dsp)->num_bars;
+    }
+    else {
+        // nothing played yet, only the background is drawn
+        update_num_bars (w, conf);
+        bands = get_num_bars (w, conf);
+    }
     const int width = a.width;
     const int height = a.height;
 
-    spectrum_render (w, bands);
+    trace_begin ("draw");
+    const int64_t frame_start = profiler_now ();
+    profiler_begin_frame (&w->profiler, frame_start, w->refresh_interval);
+    spectrum_render (w);
 
-    if (!CONFIG_DRAW_STYLE) {
-        spectrum_draw_custom (w, cr, bands, width, height);
+    draw_params_t params;
+    spectrum_draw_params (w, conf, &params, bands, width, height);
+
+    trace_begin ("rasterization");
+    if (!conf->draw_style) {
+        spectrum_draw_custom (w, cr, conf, &params);
     }
     else {
-        spectrum_draw_cairo (w, cr, bands, width, height);
+        const int64_t start = profiler_now ();
+        spectrum_draw_cairo (w, cr, conf, &params);
+        profiler_add (&w->profiler, STAGE_BARS, start);
+    }
+    trace_end ("rasterization");
+    profiler_end_frame (&w->profiler);
+
+    if (conf->governor && w->playback_status == PLAYING) {
+        const int64_t now = profiler_now ();
+        if (governor_update (&w->governor, now / 1000, (now - frame_start) / 1000, conf->refresh_interval, conf->governor_budget, conf->governor_order)) {
+            spectrum_apply_governor (w, conf);
+        }
     }
 
+    if (w->motion_ctx.dragging) {
+        // band selected for zooming
+        const double x0 = MIN (w->motion_ctx.drag_x, w->motion_ctx.x + 1);
+        const double x1 = MAX (w->motion_ctx.drag_x, w->motion_ctx.x + 1);
+        cairo_set_source_rgba (cr, 1, 1, 1, 0.2);
+        cairo_rectangle (cr, x0, 0, x1 - x0, height);
+        cairo_fill (cr);
+    }
+    if (w->show_hud) {
+        hud_draw (&w->hud, cr, &w->profiler, 0, 0);
+    }
+    config_release (conf);
+    trace_end ("draw");
+
     return FALSE;
 }
 
@@ -680,10 +546,76 @@ spectrum_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer user_d
 }
 
 
+// Returns the bar at x. Outside of the bars that is -1, or the nearest bar if clamp is set.
+static int
+spectrum_bar_at (w_spectrum_t *w, const config_snapshot_t *conf, int width, double x, int clamp)
+{
+    const int num_bars = dsp_context_get_config (w->dsp)->num_bars;
+    int barw;
+
+    if (conf->gaps && !conf->draw_style) {
+        barw = CLAMP (width / num_bars, 2, 20);
+    }
+    else {
+        barw = CLAMP (width / num_bars, 2, 20) - 1;
+    }
+
+    const int left = draw_get_align_pos (conf->alignment, width, num_bars, barw);
+    if (!clamp && (x <= left || x >= left + barw * num_bars)) {
+        return -1;
+    }
+    return CLAMP ((int)((x-1-left)/barw),0,num_bars-1);
+}
+
+// Reconfigures the analysis of this widget after its zoom changed.
+static void
+spectrum_update_zoom (w_spectrum_t *w)
+{
+    const config_snapshot_t *conf = config_acquire ();
+    if (!conf) {
+        return;
+    }
+    spectrum_configure_dsp (w, conf);
+    config_release (conf);
+    w->need_redraw = 1;
+    gtk_widget_queue_draw (w->drawarea);
+}
+
+// Zooms into the band between the bars at x0 and x1.
+static void
+spectrum_zoom_to (w_spectrum_t *w, double x0, double x1)
+{
+    GtkAllocation a;
+    gtk_widget_get_allocation (w->drawarea, &a);
+    const config_snapshot_t *conf = config_acquire ();
+    g_return_if_fail (conf);
+    // drags starting or ending in the margins select up to the outer bars
+    const int first = spectrum_bar_at (w, conf, a.width, MIN (x0, x1), 1);
+    const int last = spectrum_bar_at (w, conf, a.width, MAX (x0, x1), 1);
+    float min_freq, max_freq;
+    get_range (w, conf, &min_freq, &max_freq);
+    config_release (conf);
+
+    const float *freq = dsp_context_get_frequencies (w->dsp);
+    const int num_bars = dsp_context_get_config (w->dsp)->num_bars;
+    if (!freq) {
+        return;
+    }
+    // the band ends where the next bar starts
+    w->zoom_min_freq = freq[first];
+    w->zoom_max_freq = last + 1 < num_bars ? freq[last + 1] : max_freq;
+    w->zoom = 1;
+    spectrum_update_zoom (w);
+}
+
 static gboolean
 spectrum_button_press_event (GtkWidget *widget, GdkEventButton *event, gpointer user_data)
 {
-    //w_spectrum_t *w = user_data;
+    w_spectrum_t *w = user_data;
+    if (event->button == 1 && w->dsp) {
+        w->motion_ctx.dragging = 1;
+        w->motion_ctx.drag_x = event->x;
+    }
     return TRUE;
 }
 
@@ -691,16 +623,84 @@ static gboolean
 spectrum_button_release_event (GtkWidget *widget, GdkEventButton *event, gpointer user_data)
 {
     w_spectrum_t *w = user_data;
+    if (event->button == 1 && w->motion_ctx.dragging) {
+        w->motion_ctx.dragging = 0;
+        // a click doesn't select anything
+        if (w->dsp && fabs (event->x - w->motion_ctx.drag_x) >= DRAG_THRESHOLD) {
+            spectrum_zoom_to (w, w->motion_ctx.drag_x, event->x);
+        }
+        gtk_widget_queue_draw (w->drawarea);
+    }
     if (event->button == 3) {
+      gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (w->popup_zoom_item), w->zoom);
+      // recording is process-wide, another widget may have toggled it
+      gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (w->popup_trace_item), __atomic_load_n (&trace_enabled, __ATOMIC_RELAXED));
       gtk_menu_popup (GTK_MENU (w->popup), NULL, NULL, NULL, w->drawarea, 0, gtk_get_current_event_time ());
     }
     return TRUE;
 }
 
+static void
+on_popup_zoom_toggled (GtkCheckMenuItem *menuitem, gpointer user_data)
+{
+    w_spectrum_t *w = user_data;
+    const int zoom = gtk_check_menu_item_get_active (menuitem);
+    if (zoom != w->zoom) {
+        w->zoom = zoom;
+        spectrum_update_zoom (w);
+    }
+}
+
+static void
+on_popup_hud_toggled (GtkCheckMenuItem *menuitem, gpointer user_data)
+{
+    w_spectrum_t *w = user_data;
+    w->show_hud = gtk_check_menu_item_get_active (menuitem);
+    if (w->show_hud) {
+        profiler_reset (&w->profiler);
+    }
+    gtk_widget_queue_draw (w->drawarea);
+}
+
+static void
+on_popup_trace_toggled (GtkCheckMenuItem *menuitem, gpointer user_data)
+{
+    trace_set_enabled (gtk_check_menu_item_get_active (menuitem));
+}
+
+static void
+on_popup_save_trace_activate (GtkMenuItem *menuitem, gpointer user_data)
+{
+    GtkWidget *dialog = gtk_file_chooser_dialog_new ("Save trace", NULL, GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                     "gtk-cancel", GTK_RESPONSE_CANCEL,
+                                                     "gtk-save", GTK_RESPONSE_ACCEPT,
+                                                     NULL);
+    gtk_file_chooser_set_do_overwrite_confirmation (GTK_FILE_CHOOSER (dialog), TRUE);
+    gtk_file_chooser_set_current_name (GTK_FILE_CHOOSER (dialog), "musical_spectrum_trace.json");
+
+    if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_ACCEPT) {
+        char *fname = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (dialog));
+        // pause recording so the ring isn't overwritten while it's being saved
+        const int enabled = __atomic_load_n (&trace_enabled, __ATOMIC_RELAXED);
+        trace_set_enabled (0);
+        const int failed = trace_save (fname) != 0;
+        trace_set_enabled (enabled);
+        if (failed) {
+            GtkWidget *error = gtk_message_dialog_new (GTK_WINDOW (dialog), GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
+                                                       "Failed to save the trace to %s", fname);
+            gtk_dialog_run (GTK_DIALOG (error));
+            gtk_widget_destroy (error);
+        }
+        g_free (fname);
+    }
+    gtk_widget_destroy (dialog);
+}
+
 static gboolean
 spectrum_enter_notify_event (GtkWidget *widget, GdkEventMotion *event, gpointer user_data)
 {
-    motion_ctx.entered = 1;
+    w_spectrum_t *w = user_data;
+    w->motion_ctx.entered = 1;
     return FALSE;
 }
 
@@ -708,7 +708,7 @@ static gboolean
 spectrum_leave_notify_event (GtkWidget *widget, GdkEventMotion *event, gpointer user_data)
 {
     w_spectrum_t *w = user_data;
-    motion_ctx.entered = 0;
+    w->motion_ctx.entered = 0;
     gtk_widget_queue_draw (w->drawarea);
     return FALSE;
 }
@@ -717,31 +717,29 @@ static gboolean
 spectrum_motion_notify_event (GtkWidget *widget, GdkEventMotion *event, gpointer user_data)
 {
     w_spectrum_t *w = user_data;
+    if (!w->dsp) {
+        return FALSE;
+    }
     GtkAllocation a;
     gtk_widget_get_allocation (widget, &a);
-    if (CONFIG_DISPLAY_OCTAVES) {
+
+    const config_snapshot_t *conf = config_acquire ();
+    g_return_val_if_fail (conf, FALSE);
+    if (conf->display_octaves || w->motion_ctx.dragging) {
         gtk_widget_queue_draw (w->drawarea);
     }
 
-    motion_ctx.x = event->x - 1;
+    w->motion_ctx.x = event->x - 1;
 
-    const int num_bars = get_num_bars ();
-    int barw;
+    const int pos = spectrum_bar_at (w, conf, a.width, event->x, 0);
+    config_release (conf);
 
-    if (CONFIG_GAPS && !CONFIG_DRAW_STYLE) {
-        barw = CLAMP (a.width / num_bars, 2, 20);
-    }
-    else {
-        barw = CLAMP (a.width / num_bars, 2, 20) - 1;
-    }
-
-    const int left = get_align_pos (a.width, num_bars, barw);
-
-    if (event->x > left && event->x < left + barw * num_bars) {
-        const int pos = CLAMP ((int)((event->x-1-left)/barw),0,num_bars-1);
-        const int npos = ftoi( pos * 132 / num_bars );
+    const float *freq = dsp_context_get_frequencies (w->dsp);
+    if (freq && pos >= 0) {
+        // nearest note, notes start at C0
+        const int npos = CLAMP (ftoi (12 * log2f (freq[pos] / DSP_DEFAULT_MIN_FREQ)), 0, (int)G_N_ELEMENTS (notes) - 1);
         char tooltip_text[20];
-        snprintf (tooltip_text, sizeof (tooltip_text), "%5.0f Hz (%s)", w->freq[pos], notes[npos]);
+        snprintf (tooltip_text, sizeof (tooltip_text), "%5.0f Hz (%s)", freq[pos], notes[npos]);
         gtk_widget_set_tooltip_text (widget, tooltip_text);
         return TRUE;
     }
@@ -756,69 +754,108 @@ spectrum_message (ddb_gtkui_widget_t *widget, uint32_t id, uintptr_t ctx, uint32
     const int samplerate_temp = w->samplerate;
     switch (id) {
         case DB_EV_SONGSTARTED:
-            playback_status = PLAYING;
+            w->playback_status = PLAYING;
             w->samplerate = deadbeef->get_output ()->fmt.samplerate;
             if (w->samplerate == 0) w->samplerate = 44100;
-            if (samplerate_temp != w->samplerate) {
-                create_frequency_table (w);
+            if (!w->dsp) {
+                spectrum_prepare (w);
             }
-            spectrum_set_refresh_interval (w, CONFIG_REFRESH_INTERVAL);
-            break;
-        case DB_EV_CONFIGCHANGED:
-            on_config_changed (w, ctx);
-            if (deadbeef->get_output ()->state () == OUTPUT_STATE_PLAYING) {
-                spectrum_set_refresh_interval (w, CONFIG_REFRESH_INTERVAL);
+            else if (samplerate_temp != w->samplerate) {
+                const config_snapshot_t *conf = config_acquire ();
+                if (conf) {
+                    spectrum_configure_dsp (w, conf);
+                    config_release (conf);
+                }
+            }
+            if (!w->prefetch_idle) {
+                w->prefetch_idle = g_idle_add (spectrum_prefetch_tables_cb, w);
             }
+            spectrum_set_refresh_interval (w, w->refresh_interval);
             break;
         case DB_EV_PAUSED:
             if (deadbeef->get_output ()->state () == OUTPUT_STATE_PLAYING) {
-                playback_status = PLAYING;
-                spectrum_set_refresh_interval (w, CONFIG_REFRESH_INTERVAL);
+                w->playback_status = PLAYING;
+                spectrum_prepare (w);
+                spectrum_set_refresh_interval (w, w->refresh_interval);
             }
             else {
-                playback_status = PAUSED;
+                w->playback_status = PAUSED;
             }
             break;
         case DB_EV_STOP:
-            playback_status = STOPPED;
+            w->playback_status = STOPPED;
             g_idle_add (spectrum_redraw_cb, w);
             break;
     }
     return 0;
 }
 
+// Layout parameters of the widget, its zoom band.
+static void
+w_spectrum_save (ddb_gtkui_widget_t *widget, char *s, int sz)
+{
+    w_spectrum_t *w = (w_spectrum_t *)widget;
+    char min_freq[G_ASCII_DTOSTR_BUF_SIZE];
+    char max_freq[G_ASCII_DTOSTR_BUF_SIZE];
+    g_ascii_formatd (min_freq, sizeof (min_freq), "%g", w->zoom_min_freq);
+    g_ascii_formatd (max_freq, sizeof (max_freq), "%g", w->zoom_max_freq);
+    snprintf (s, sz, " zoom=%d zoom_min_freq=%s zoom_max_freq=%s", w->zoom, min_freq, max_freq);
+}
+
+static const char *
+w_spectrum_load (ddb_gtkui_widget_t *widget, const char *type, const char *s)
+{
+    if (strcmp (type, "musical_spectrum")) {
+        return NULL;
+    }
+    w_spectrum_t *w = (w_spectrum_t *)widget;
+    char key[64], val[64];
+    int n;
+    // key=value pairs, values may be quoted, up to the children in braces
+    while (sscanf (s, " %63[^= \t\n{}]=\"%63[^\"]\"%n", key, val, &n) == 2
+            || sscanf (s, " %63[^= \t\n{}]=%63[^ \t\n{}]%n", key, val, &n) == 2) {
+        s += n;
+        if (!strcmp (key, "zoom")) {
+            w->zoom = atoi (val);
+        }
+        else if (!strcmp (key, "zoom_min_freq")) {
+            w->zoom_min_freq = g_ascii_strtod (val, NULL);
+        }
+        else if (!strcmp (key, "zoom_max_freq")) {
+            w->zoom_max_freq = g_ascii_strtod (val, NULL);
+        }
+    }
+    if (!(w->zoom_min_freq >= 1 && w->zoom_max_freq > w->zoom_min_freq)) {
+        w->zoom = 0;
+        w->zoom_min_freq = 40;
+        w->zoom_max_freq = 120;
+    }
+    // the widget may have been prepared for playback already
+    spectrum_update_zoom (w);
+    return s;
+}
+
 static void
 spectrum_init (w_spectrum_t *w) {
     w_spectrum_t *s = (w_spectrum_t *)w;
     load_config ();
-    deadbeef->mutex_lock (s->mutex);
-    s->samples = malloc (sizeof (double) * MAX_FFT_SIZE);
-    memset (s->samples, 0, sizeof (double) * MAX_FFT_SIZE);
-    s->spectrum_data = malloc (sizeof (double) * MAX_FFT_SIZE);
-    memset (s->spectrum_data, 0, sizeof (double) * MAX_FFT_SIZE);
-
-    s->fft_in = fftw_malloc (sizeof (double) * MAX_FFT_SIZE);
-    memset (s->fft_in, 0, sizeof (double) * MAX_FFT_SIZE);
-    s->fft_out = fftw_malloc (sizeof (fftw_complex) * MAX_FFT_SIZE);
-    memset (s->fft_out, 0, sizeof (double) * MAX_FFT_SIZE);
-
-    s->p_r2c = fftw_plan_dft_r2c_1d (CONFIG_FFT_SIZE, s->fft_in, s->fft_out, FFTW_ESTIMATE);
-
-    s->buffered = 0;
+    const config_snapshot_t *conf = config_acquire ();
+    if (!conf) {
+        return;
+    }
+    s->config_serial = conf->serial;
+    s->refresh_interval = conf->refresh_interval;
+    config_release (conf);
     s->samplerate = deadbeef->get_output ()->fmt.samplerate;
     if (s->samplerate == 0) s->samplerate = 44100;
 
-    create_window_table (s);
-    create_frequency_table (s);
-    create_gradient_table (s->colors, CONFIG_GRADIENT_COLORS, CONFIG_NUM_COLORS);
-
+    // analysis buffers and the fft plan are set up by the first song, unless one is playing already
     if (deadbeef->get_output ()->state () == OUTPUT_STATE_PLAYING) {
-        playback_status = PLAYING;
-        spectrum_set_refresh_interval (w, CONFIG_REFRESH_INTERVAL);
+        w->playback_status = PLAYING;
+        spectrum_prepare (w);
+        spectrum_set_refresh_interval (w, w->refresh_interval);
     }
-    deadbeef->vis_waveform_listen (w, spectrum_wavedata_listener);
-    deadbeef->mutex_unlock (s->mutex);
-    need_redraw = 1;
+    w->need_redraw = 1;
 }
 
 static ddb_gtkui_widget_t *
@@ -829,16 +866,34 @@ w_musical_spectrum_create (void) {
     w->base.widget = gtk_event_box_new ();
     w->base.destroy  = w_spectrum_destroy;
     w->base.message = spectrum_message;
+    w->base.save = w_spectrum_save;
+    w->base.load = w_spectrum_load;
     w->drawarea = gtk_drawing_area_new ();
     w->popup = gtk_menu_new ();
     w->popup_item = gtk_menu_item_new_with_mnemonic ("Configure");
-    w->mutex = deadbeef->mutex_create ();
+    w->popup_zoom_item = gtk_check_menu_item_new_with_mnemonic ("Zoom");
+    w->popup_hud_item = gtk_check_menu_item_new_with_mnemonic ("Show timings");
+    w->popup_trace_item = gtk_check_menu_item_new_with_mnemonic ("Record trace");
+    w->popup_save_trace_item = gtk_menu_item_new_with_mnemonic ("Save trace...");
+    w->last_bar_w = -1;
+    w->calculated_num_bars = 136;
+    w->zoom_min_freq = 40;
+    w->zoom_max_freq = 120;
+    profiler_reset (&w->profiler);
 
     gtk_container_add (GTK_CONTAINER (w->base.widget), w->drawarea);
     gtk_container_add (GTK_CONTAINER (w->popup), w->popup_item);
+    gtk_container_add (GTK_CONTAINER (w->popup), w->popup_zoom_item);
+    gtk_container_add (GTK_CONTAINER (w->popup), w->popup_hud_item);
+    gtk_container_add (GTK_CONTAINER (w->popup), w->popup_trace_item);
+    gtk_container_add (GTK_CONTAINER (w->popup), w->popup_save_trace_item);
     gtk_widget_show (w->drawarea);
     gtk_widget_show (w->popup);
     gtk_widget_show (w->popup_item);
+    gtk_widget_show (w->popup_zoom_item);
+    gtk_widget_show (w->popup_hud_item);
+    gtk_widget_show (w->popup_trace_item);
+    gtk_widget_show (w->popup_save_trace_item);
 
     gtk_widget_add_events (w->drawarea,
             GDK_EXPOSURE_MASK | GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK | GDK_POINTER_MOTION_MASK | GDK_ENTER_NOTIFY_MASK | GDK_LEAVE_NOTIFY_MASK );
@@ -854,9 +909,14 @@ w_musical_spectrum_create (void) {
     g_signal_connect_after ((gpointer) w->drawarea, "enter_notify_event", G_CALLBACK (spectrum_enter_notify_event), w);
     g_signal_connect_after ((gpointer) w->drawarea, "leave_notify_event", G_CALLBACK (spectrum_leave_notify_event), w);
     g_signal_connect_after ((gpointer) w->popup_item, "activate", G_CALLBACK (on_button_config), w);
+    g_signal_connect_after ((gpointer) w->popup_zoom_item, "toggled", G_CALLBACK (on_popup_zoom_toggled), w);
+    g_signal_connect_after ((gpointer) w->popup_hud_item, "toggled", G_CALLBACK (on_popup_hud_toggled), w);
+    g_signal_connect_after ((gpointer) w->popup_trace_item, "toggled", G_CALLBACK (on_popup_trace_toggled), w);
+    g_signal_connect_after ((gpointer) w->popup_save_trace_item, "activate", G_CALLBACK (on_popup_save_trace_activate), w);
     gtkui_plugin->w_override_signals (w->base.widget, w);
 
     spectrum_init (w);
+    widgets = g_list_prepend (widgets, w);
     return (ddb_gtkui_widget_t *)w;
 }
 
@@ -868,7 +928,7 @@ musical_spectrum_connect (void)
         //trace("using '%s' plugin %d.%d\n", DDB_GTKUI_PLUGIN_ID, gtkui_plugin->gui.plugin.version_major, gtkui_plugin->gui.plugin.version_minor );
         if (gtkui_plugin->gui.plugin.version_major == 2) {
             // 0.6+, use the new widget API
-            gtkui_plugin->w_reg_widget ("Musical Spectrum", DDB_WF_SINGLE_INSTANCE, w_musical_spectrum_create, "musical_spectrum", NULL);
+            gtkui_plugin->w_reg_widget ("Musical Spectrum", 0, w_musical_spectrum_create, "musical_spectrum", NULL);
             return 0;
         }
     }
@@ -889,6 +949,17 @@ musical_spectrum_stop (void)
     return 0;
 }
 
+static int
+musical_spectrum_message (uint32_t id, uintptr_t ctx, uint32_t p1, uint32_t p2)
+{
+    if (id == DB_EV_CONFIGCHANGED) {
+        // reloads once for all widgets, they pick up the changes by CONFIG_SERIAL
+        load_config ();
+        g_idle_add (spectrum_config_changed_cb, NULL);
+    }
+    return 0;
+}
+
 static int
 musical_spectrum_disconnect (void)
 {
@@ -942,6 +1013,7 @@ DB_misc_t plugin = {
     .plugin.stop            = musical_spectrum_stop,
     .plugin.connect         = musical_spectrum_connect,
     .plugin.disconnect      = musical_spectrum_disconnect,
+    .plugin.message         = musical_spectrum_message,
     .plugin.configdialog    = settings_dlg,
 };
 
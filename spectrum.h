@@ -27,49 +27,74 @@
 
 #include <gtk/gtk.h>
 #include <stdint.h>
-#include <fftw3.h>
 
 #include <deadbeef/deadbeef.h>
 #include <deadbeef/gtkui_api.h>
 
-#define MAX_BARS 2000
+#include "governor.h"
+#include "profiler.h"
+#include "hud.h"
+#include "draw_utils.h"
+#include "dsp/dsp.h"
+#include "hub.h"
+
 #define REFRESH_INTERVAL 25
-#define GRADIENT_TABLE_SIZE 1024
-#define MAX_FFT_SIZE 32768
+#define MAX_FFT_SIZE DSP_MAX_FFT_SIZE
+// pixels the mouse has to move with button 1 held to select a band
+#define DRAG_THRESHOLD 4
 
 /* Global variables */
 extern DB_misc_t plugin;
 extern DB_functions_t *deadbeef;
 extern ddb_gtkui_t *gtkui_plugin;
 
+enum PLAYBACK_STATUS { STOPPED = 0, PLAYING = 1, PAUSED = 2 };
+
+struct motion_context {
+    uint8_t entered;
+    double x;
+    // dragging: button 1 is held since drag_x, the selected band is zoomed into on release
+    uint8_t dragging;
+    double drag_x;
+};
+
 typedef struct {
     ddb_gtkui_widget_t base;
     GtkWidget *drawarea;
     GtkWidget *popup;
     GtkWidget *popup_item;
+    GtkWidget *popup_hud_item;
+    GtkWidget *popup_zoom_item;
+    GtkWidget *popup_trace_item;
+    GtkWidget *popup_save_trace_item;
     cairo_surface_t *surf;
     unsigned char *surf_data;
     guint drawtimer;
-    // spectrum_data: holds amplitude of frequency bins (result of fft)
-    double *spectrum_data;
-    double window[MAX_FFT_SIZE];
-    // keys: index of frequencies of musical notes (c0;d0;...;f10) in data
-    int keys[MAX_BARS + 1];
-    // freq: hold frequency values
-    float freq[MAX_BARS + 1];
-    uint32_t colors[GRADIENT_TABLE_SIZE];
+    guint prefetch_idle;
+    // hub: shared audio tap and transform, dsp: band mapping and bars of this widget
+    hub_t *hub;
+    dsp_context_t *dsp;
     int samplerate;
-    double *samples;
-    double *fft_in;
-    fftw_complex *fft_out;
-    fftw_plan p_r2c;
-    int buffered;
-    int low_res_end;
-    float bars[MAX_BARS + 1];
-    float peaks[MAX_BARS + 1];
-    int delay_bars[MAX_BARS + 1];
-    int delay_peaks[MAX_BARS + 1];
-    intptr_t mutex;
+    // refresh_interval: configured value after the governor stepped it down
+    int refresh_interval;
+    governor_t governor;
+    profiler_t profiler;
+    hud_t hud;
+    int show_hud;
+    struct motion_context motion_ctx;
+    // zoom: analyse and show [zoom_min_freq, zoom_max_freq) instead of the configured
+    // range, kept in the layout of this widget
+    int zoom;
+    float zoom_min_freq;
+    float zoom_max_freq;
+    int playback_status;
+    // need_redraw: widget size or config changed, background needs to be redrawn
+    int need_redraw;
+    int last_bar_w;
+    // calculated_num_bars: number of bars fitting the widget width
+    int calculated_num_bars;
+    // config_serial: CONFIG_SERIAL at the last applied config change
+    uint32_t config_serial;
 } w_spectrum_t;
 
 #endif
@@ -0,0 +1,127 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "profiler.h"
+#include "trace.h"
+
+typedef struct {
+    // seq: index + 1 of the event stored in this slot, 0 while it is being written
+    uint64_t seq;
+    const char *name;
+    int64_t ts;
+    int32_t tid;
+    char phase;
+} trace_event_t;
+
+int trace_enabled = 0;
+
+static trace_event_t *trace_ring = NULL;
+static uint64_t trace_head = 0;
+
+static __thread int32_t trace_tid = 0;
+
+void
+trace_set_enabled (int enabled)
+{
+    if (enabled && !__atomic_load_n (&trace_ring, __ATOMIC_ACQUIRE)) {
+        // only allocated once, and only if someone actually wants to record
+        trace_event_t *ring = calloc (TRACE_RING_SIZE, sizeof (trace_event_t));
+        if (!ring) {
+            return;
+        }
+        trace_event_t *expected = NULL;
+        if (!__atomic_compare_exchange_n (&trace_ring, &expected, ring, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+            free (ring);
+        }
+    }
+    __atomic_store_n (&trace_enabled, enabled ? 1 : 0, __ATOMIC_RELEASE);
+}
+
+void
+trace_event (const char *name, char phase)
+{
+    trace_event_t *ring = __atomic_load_n (&trace_ring, __ATOMIC_ACQUIRE);
+    if (!ring) {
+        return;
+    }
+    if (!trace_tid) {
+        trace_tid = (int32_t)syscall (SYS_gettid);
+    }
+    const uint64_t index = __atomic_fetch_add (&trace_head, 1, __ATOMIC_RELAXED);
+    trace_event_t *e = &ring[index & (TRACE_RING_SIZE - 1)];
+
+    __atomic_store_n (&e->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+    e->name = name;
+    e->ts = profiler_now ();
+    e->tid = trace_tid;
+    e->phase = phase;
+    __atomic_store_n (&e->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+// Writes the recorded events as Chrome trace_event JSON, which Perfetto and
+// chrome://tracing can open. Returns 0 on success.
+int
+trace_save (const char *fname)
+{
+    trace_event_t *ring = __atomic_load_n (&trace_ring, __ATOMIC_ACQUIRE);
+    if (!ring) {
+        return -1;
+    }
+    FILE *fp = fopen (fname, "w");
+    if (!fp) {
+        return -1;
+    }
+
+    const uint64_t head = __atomic_load_n (&trace_head, __ATOMIC_ACQUIRE);
+    const uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+    const int pid = getpid ();
+    int written = 0;
+
+    fprintf (fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (uint64_t i = first; i < head; i++) {
+        const trace_event_t *e = &ring[i & (TRACE_RING_SIZE - 1)];
+        // skip slots that are being rewritten by a concurrent writer
+        if (__atomic_load_n (&e->seq, __ATOMIC_ACQUIRE) != i + 1) {
+            continue;
+        }
+        const trace_event_t copy = *e;
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);
+        if (__atomic_load_n (&e->seq, __ATOMIC_RELAXED) != i + 1) {
+            continue;
+        }
+        fprintf (fp, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+                 written ? ",\n" : "", copy.name, copy.phase, copy.ts / 1000.0, pid, copy.tid);
+        written++;
+    }
+    fprintf (fp, "\n]}\n");
+    return fclose (fp) == 0 ? 0 : -1;
+}
@@ -0,0 +1,61 @@
+/*
+    Musical Spectrum plugin for the DeaDBeeF audio player
+
+    Copyright (C) 2015 Christian Boxdörfer <christian.boxdoerfer@posteo.de>
+
+    Based on DeaDBeeFs stock spectrum.
+    Copyright (c) 2009-2015 Alexey Yakovenko <waker@users.sourceforge.net>
+    Copyright (c) 2011 William Pitcock <nenolod@dereferenced.org>
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef TRACE_HEADER
+#define TRACE_HEADER
+
+#include <stdint.h>
+
+// number of events kept in memory, must be a power of two
+#define TRACE_RING_SIZE 65536
+
+extern int trace_enabled;
+
+void
+trace_event (const char *name, char phase);
+
+// Recording is off by default; the checks below are all a disabled trace costs.
+static inline void
+trace_begin (const char *name)
+{
+    if (__builtin_expect (__atomic_load_n (&trace_enabled, __ATOMIC_RELAXED), 0)) {
+        trace_event (name, 'B');
+    }
+}
+
+static inline void
+trace_end (const char *name)
+{
+    if (__builtin_expect (__atomic_load_n (&trace_enabled, __ATOMIC_RELAXED), 0)) {
+        trace_event (name, 'E');
+    }
+}
+
+void
+trace_set_enabled (int enabled);
+
+int
+trace_save (const char *fname);
+
+#endif
@@ -36,40 +36,25 @@
 #include "config.h"
 #include "spectrum.h"
 #include "utils.h"
-
-int CALCULATED_NUM_BARS = 136;
+#include "dsp/dsp.h"
 
 int
-get_num_bars ()
+get_num_bars (gpointer user_data, const config_snapshot_t *conf)
 {
-    int bar_num = CALCULATED_NUM_BARS;
-    if (CONFIG_DRAW_STYLE == 1) {
-        bar_num = CALCULATED_NUM_BARS;
+    w_spectrum_t *w = user_data;
+    int bar_num = w->calculated_num_bars;
+    if (conf->draw_style == 1) {
+        bar_num = w->calculated_num_bars;
     }
-    else if (CONFIG_BAR_W > 0) {
-        bar_num = CALCULATED_NUM_BARS;
+    else if (conf->bar_w > 0) {
+        bar_num = w->calculated_num_bars;
     }
     else {
-        bar_num = CONFIG_NUM_BARS;
+        bar_num = conf->num_bars;
     }
     return bar_num;
 }
 
-void
-_memset_pattern (char *data, const void* pattern, size_t data_len, size_t pattern_len)
-{
-    memmove ((char *)data, pattern, pattern_len);
-    char *start = (char *)data;
-    char *current = (char *)data + pattern_len;
-    char *end = start + data_len;
-    while(current + pattern_len < end) {
-        memmove (current, start, pattern_len);
-        current += pattern_len;
-        pattern_len *= 2;
-    }
-    memmove (current, start, end-current);
-}
-
 void
 create_gradient_table (uint32_t *dest, GdkColor *colors, int num_colors)
 {
@@ -118,80 +103,70 @@ create_gradient_table (uint32_t *dest, GdkColor *colors, int num_colors)
 }
 
 void
-create_window_table (gpointer user_data)
-{
-    w_spectrum_t *w = user_data;
-
-    switch (CONFIG_WINDOW) {
-        case BLACKMAN_HARRIS:
-            for (int i = 0; i < CONFIG_FFT_SIZE; i++) {
-                // Blackman-Harris
-                w->window[i] = 0.35875 - 0.48829 * cos(2 * M_PI * i / CONFIG_FFT_SIZE) + 0.14128 * cos(4 * M_PI * i / CONFIG_FFT_SIZE) - 0.01168 * cos(6 * M_PI * i / CONFIG_FFT_SIZE);
-            }
-            break;
-        case HANNING:
-            for (int i = 0; i < CONFIG_FFT_SIZE; i++) {
-                // Hanning
-                w->window[i] = (0.5 * (1 - cos (2 * M_PI * i / CONFIG_FFT_SIZE)));
-            }
-            break;
-        default:
-            break;
-    }
-}
-
-void
-update_num_bars (gpointer user_data)
+update_num_bars (gpointer user_data, const config_snapshot_t *conf)
 {
     w_spectrum_t *w = user_data;
 
     GtkAllocation a;
     gtk_widget_get_allocation (w->drawarea, &a);
 
-    CALCULATED_NUM_BARS = 136;
-    if (CONFIG_DRAW_STYLE == 1) {
-        CALCULATED_NUM_BARS = CLAMP (a.width, 1, MAX_BARS);
+    w->calculated_num_bars = 136;
+    if (conf->draw_style == 1) {
+        w->calculated_num_bars = MAX (a.width, 1);
     }
-    else if (CONFIG_BAR_W > 0) {
-        int added_bar_w = CONFIG_BAR_W;
-        if (CONFIG_GAPS)
-            added_bar_w += 1;
-        CALCULATED_NUM_BARS = CLAMP (a.width/added_bar_w, 1, MAX_BARS);
+    else if (conf->bar_step > 0) {
+        w->calculated_num_bars = MAX (a.width/conf->bar_step, 1);
     }
 }
 
 void
-create_frequency_table (gpointer user_data)
+get_range (gpointer user_data, const config_snapshot_t *conf, float *min_freq, float *max_freq)
 {
     w_spectrum_t *w = user_data;
-    w->low_res_end = 0;
-
-    update_num_bars (w);
-    const int num_bars = get_num_bars ();
-    const double ratio = num_bars / 132.0;
-    const double a4pos = 57.0 * ratio;
-    const double octave = 12.0 * ratio;
-
-    for (int i = 0; i < num_bars; i++) {
-        w->freq[i] = 440.0 * pow (2.0, (double)(i-a4pos)/octave);
-        w->keys[i] = ftoi (w->freq[i] * CONFIG_FFT_SIZE/(float)w->samplerate);
-        if (i > 0 && w->keys[i-1] == w->keys[i])
-            w->low_res_end = i;
+
+    if (w->zoom) {
+        *min_freq = w->zoom_min_freq;
+        *max_freq = w->zoom_max_freq;
+    }
+    else {
+        *min_freq = conf->min_freq;
+        *max_freq = conf->max_freq;
     }
 }
 
-float
-linear_interpolate (float y1, float y2, float mu)
+// Fills config from the settings, the widget size and zoom and the governor state.
+void
+create_dsp_config (gpointer user_data, const config_snapshot_t *conf, dsp_config_t *config)
 {
-       return (y1 * (1 - mu) + y2 * mu);
-}
+    w_spectrum_t *w = user_data;
 
-float
-lagrange_interpolate (float y0, float y1, float y2, float y3, float x)
-{
-    const float a0 = ((x - 1) * (x - 2) * (x - 3)) / -6 * y0;
-    const float a1 = ((x - 0) * (x - 2) * (x - 3)) /  2 * y1;
-    const float a2 = ((x - 0) * (x - 1) * (x - 3)) / -2 * y2;
-    const float a3 = ((x - 0) * (x - 1) * (x - 2)) /  6 * y3;
-    return (a0 + a1 + a2 + a3);
+    update_num_bars (w, conf);
+    dsp_config_default (config);
+    config->fft_size = governor_fft_size (&w->governor, CLAMP (conf->fft_size, 512, MAX_FFT_SIZE));
+    config->num_bars = governor_num_bars (&w->governor, get_num_bars (w, conf));
+    config->samplerate = w->samplerate;
+    config->window = conf->window;
+    config->window_param = conf->window_param;
+    get_range (w, conf, &config->min_freq, &config->max_freq);
+    config->zoom = w->zoom;
+    config->engine = conf->engine;
+    config->bands_per_octave = conf->bands_per_octave;
+    config->detector = conf->detector;
+    config->resolutions = conf->resolutions;
+    config->reassign = conf->reassign;
+    config->tapers = conf->tapers;
+    config->time_bandwidth = conf->time_bandwidth;
+    config->averaging = conf->averaging;
+    config->average_time = conf->average_time;
+    config->average_frames = conf->average_frames;
+    config->channels = conf->channels;
+    config->downmix = conf->downmix;
+    config->hop = governor_hop (&w->governor, config->fft_size);
+    config->amplitude_offset = conf->amplitude_offset;
+    config->db_range = conf->db_range;
+    config->animation.bar_falloff = conf->bar_falloff_per_ms != -1 ? conf->bar_falloff_per_ms * w->refresh_interval : -1;
+    config->animation.peak_falloff = conf->peak_falloff_per_ms != -1 ? conf->peak_falloff_per_ms * w->refresh_interval : -1;
+    config->animation.bar_delay = ftoi (conf->bar_delay/w->refresh_interval);
+    config->animation.peak_delay = ftoi (conf->peak_delay/w->refresh_interval);
+    config->animation.db_range = conf->db_range;
 }
@@ -27,29 +27,23 @@
 
 #include <gtk/gtk.h>
 
-extern int CALCULATED_NUM_BARS;
+#include "dsp/dsp.h"
 
-void
-_memset_pattern (char *data, const void* pattern, size_t data_len, size_t pattern_len);
+struct config_snapshot_s;
 
 void
-update_num_bars (gpointer user_data);
+update_num_bars (gpointer user_data, const struct config_snapshot_s *conf);
 
 int
-get_num_bars ();
+get_num_bars (gpointer user_data, const struct config_snapshot_s *conf);
 
+// Range shown by the widget, its zoom band if it is zoomed in.
 void
-create_gradient_table (uint32_t *dest, GdkColor *colors, int num_colors);
+get_range (gpointer user_data, const struct config_snapshot_s *conf, float *min_freq, float *max_freq);
 
 void
-create_window_table (gpointer user_data);
+create_gradient_table (uint32_t *dest, GdkColor *colors, int num_colors);
 
 void
-create_frequency_table (gpointer user_data);
-
-float
-linear_interpolate (float y1, float y2, float mu);
-
-float
-lagrange_interpolate (float y0, float y1, float y2, float y3, float x);
+create_dsp_config (gpointer user_data, const struct config_snapshot_s *conf, dsp_config_t *config);
 #endif